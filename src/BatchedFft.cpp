@@ -0,0 +1,266 @@
+/*
+  ==============================================================================
+
+    BatchedFft.cpp
+    - Radix-2 FFT over 'lanes' interleaved frames (one frame per SIMD lane)
+    - Batched real-cepstrum minimum-phase reconstruction
+    - Polynomial log / exp / sincos over lane blocks (vectorised, no libm calls)
+
+  ==============================================================================
+*/
+
+#include "BatchedFft.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    // log / exp / sincos en polinomio, sin branches ni llamadas a libm: los loops
+    // sobre el bloque de lanes se vectorizan como los butterflies. Error relativo
+    // ~1e-7 (float), de sobra para la reconstrucción de fase.
+
+    static inline std::int32_t floatBits (float x) noexcept
+    {
+        std::int32_t i;
+        std::memcpy (&i, &x, sizeof (i));
+        return i;
+    }
+
+    static inline float bitsToFloat (std::int32_t i) noexcept
+    {
+        float x;
+        std::memcpy (&x, &i, sizeof (x));
+        return x;
+    }
+
+    // x > 0 (normal). x = m * 2^e, m en [sqrt(1/2), sqrt(2)); log m = 2 atanh (s)
+    static void logBlock (float* x, int n) noexcept
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            const std::int32_t bits = floatBits (x[i]);
+            const std::int32_t e = ((bits - 0x3f3504f3) >> 23);       // exponente respecto a sqrt(1/2)
+            const float m = bitsToFloat (bits - e * (1 << 23));       // [sqrt(1/2), sqrt(2)); e < 0 es lo normal: sin <<
+
+            const float s = (m - 1.0f) / (m + 1.0f);
+            const float s2 = s * s;
+            const float p = 2.0f + s2 * (2.0f / 3.0f + s2 * (2.0f / 5.0f + s2 * (2.0f / 7.0f + s2 * (2.0f / 9.0f))));
+
+            x[i] = (float) e * 0.693147180559945f + s * p;
+        }
+    }
+
+    // Redondeo al entero más cercano sin libm (|x| < 2^22, modo de redondeo por defecto)
+    static inline float roundNearest (float x) noexcept
+    {
+        constexpr float magic = 12582912.0f; // 1.5 * 2^23
+        return (x + magic) - magic;
+    }
+
+    // re + i im -> exp (re) * (cos (im) + i sin (im)). re en [-87, 88] (sin clamp: en la
+    // fase mínima es log |X|, acotado al rellenar el espectro)
+    static void expSinCosBlock (float* re, float* im, int n) noexcept
+    {
+        constexpr float log2e = 1.44269504088896f;
+        constexpr float ln2Hi = 0.693145751953125f, ln2Lo = 1.42860682030941723e-6f;
+        constexpr float twoOverPi = 0.636619772367581f;
+        constexpr float piOver2Hi = 1.5707962513f, piOver2Lo = 7.5497894159e-8f;
+
+        for (int i = 0; i < n; ++i)
+        {
+            // exp: 2^k * e^r, |r| <= ln2 / 2
+            const float a = re[i];
+            const float k = roundNearest (a * log2e);
+            const float r = (a - k * ln2Hi) - k * ln2Lo;
+            const float er = 1.0f + r * (1.0f + r * (0.5f + r * (1.0f / 6.0f + r * (1.0f / 24.0f
+                           + r * (1.0f / 120.0f + r * (1.0f / 720.0f + r * (1.0f / 5040.0f)))))));
+            const float mag = er * bitsToFloat (((std::int32_t) k + 127) * (1 << 23));
+
+            // sincos: cuadrante q = round (b * 2/pi), resto en [-pi/4, pi/4]
+            const float b = im[i];
+            const float qf = roundNearest (b * twoOverPi);
+            const float t = (b - qf * piOver2Hi) - qf * piOver2Lo;
+            const float t2 = t * t;
+
+            const float sn = t * (1.0f + t2 * (-1.0f / 6.0f + t2 * (1.0f / 120.0f
+                           + t2 * (-1.0f / 5040.0f + t2 * (1.0f / 362880.0f)))));
+            const float cs = 1.0f + t2 * (-0.5f + t2 * (1.0f / 24.0f + t2 * (-1.0f / 720.0f
+                           + t2 * (1.0f / 40320.0f + t2 * (-1.0f / 3628800.0f)))));
+
+            // Cuadrante q = qf mod 4, todo en float (sin selects ni enteros estrechos):
+            // q impar intercambia sin y cos, q = 2, 3 niega el seno, q = 1, 2 el coseno
+            const float q = qf - 4.0f * roundNearest (qf * 0.25f - 0.375f);
+            const float hi = roundNearest (q * 0.5f - 0.25f);  // q >= 2
+            const float swap = q - 2.0f * hi;                   // q impar
+            const float sinSign = 1.0f - 2.0f * hi;
+            const float cosSign = 1.0f - 2.0f * (hi + swap - 2.0f * hi * swap);
+
+            re[i] = mag * cosSign * (cs + swap * (sn - cs));
+            im[i] = mag * sinSign * (sn + swap * (cs - sn));
+        }
+    }
+}
+
+namespace batched
+{
+    FrameBatchFft::FrameBatchFft (int order)
+        : size (1 << order)
+    {
+        bitReversed.resize ((size_t) size);
+        for (int i = 0; i < size; ++i)
+        {
+            int r = 0;
+            for (int b = 0; b < order; ++b)
+                if ((i >> b) & 1)
+                    r |= 1 << (order - 1 - b);
+            bitReversed[(size_t) i] = r;
+        }
+
+        const int half = juce::jmax (1, size / 2);
+        twiddleRe.resize ((size_t) half);
+        twiddleIm.resize ((size_t) half);
+        for (int k = 0; k < half; ++k)
+        {
+            const double w = juce::MathConstants<double>::twoPi * (double) k / (double) size;
+            twiddleRe[(size_t) k] = (float) std::cos (w);
+            twiddleIm[(size_t) k] = (float) -std::sin (w);
+        }
+    }
+
+    void FrameBatchFft::perform (float* re, float* im, bool inverse) const noexcept
+    {
+        constexpr int L = lanes;
+        const int N = size;
+
+        // Bit reversal (bloques de L floats)
+        for (int i = 0; i < N; ++i)
+        {
+            const int j = bitReversed[(size_t) i];
+            if (j <= i)
+                continue;
+
+            float* ri = re + i * L; float* rj = re + j * L;
+            float* ii = im + i * L; float* ij = im + j * L;
+            for (int l = 0; l < L; ++l)
+            {
+                std::swap (ri[l], rj[l]);
+                std::swap (ii[l], ij[l]);
+            }
+        }
+
+        // Butterflies
+        const float sign = inverse ? -1.0f : 1.0f;
+        for (int len = 2; len <= N; len <<= 1)
+        {
+            const int half = len >> 1;
+            const int step = N / len;
+
+            for (int start = 0; start < N; start += len)
+            {
+                for (int k = 0; k < half; ++k)
+                {
+                    const float wr = twiddleRe[(size_t) (k * step)];
+                    const float wi = sign * twiddleIm[(size_t) (k * step)];
+
+                    float* ar = re + (start + k) * L;
+                    float* ai = im + (start + k) * L;
+                    float* br = re + (start + k + half) * L;
+                    float* bi = im + (start + k + half) * L;
+
+                    for (int l = 0; l < L; ++l)
+                    {
+                        const float tr = br[l] * wr - bi[l] * wi;
+                        const float ti = br[l] * wi + bi[l] * wr;
+                        br[l] = ar[l] - tr;
+                        bi[l] = ai[l] - ti;
+                        ar[l] += tr;
+                        ai[l] += ti;
+                    }
+                }
+            }
+        }
+
+        if (inverse)
+        {
+            const float invN = 1.0f / (float) N;
+            for (int i = 0; i < N * L; ++i)
+            {
+                re[i] *= invN;
+                im[i] *= invN;
+            }
+        }
+    }
+
+    //==============================================================================
+    void minimumPhase (const FrameBatchFft& fft,
+                       const float* const* mags,
+                       float* const* outFrames,
+                       int count,
+                       Scratch& scratch)
+    {
+        constexpr int L = lanes;
+        const int N = fft.getSize();
+        const float eps = 1.0e-12f;
+        const float maxMag = 1.0e30f; // log = 69: exp cabe en float tras la ventana cepstral
+
+        count = juce::jlimit (0, L, count);
+        if (count == 0)
+            return;
+
+        scratch.re.assign ((size_t) N * L, 0.0f);
+        scratch.im.assign ((size_t) N * L, 0.0f);
+        float* re = scratch.re.data();
+        float* im = scratch.im.data();
+
+        // Full even log-magnitude spectrum; lanes sin frame quedan en log(eps).
+        // El log se hace sobre el bloque de lanes de los N/2 + 1 bins únicos
+        for (int k = 0; k <= N / 2; ++k)
+        {
+            float* r = re + k * L;
+
+            for (int l = 0; l < count; ++l)
+                r[l] = juce::jlimit (eps, maxMag, mags[l][k]);
+            for (int l = count; l < L; ++l)
+                r[l] = eps;
+        }
+
+        logBlock (re, (N / 2 + 1) * L);
+
+        for (int k = N / 2 + 1; k < N; ++k)
+            std::memcpy (re + k * L, re + (N - k) * L, (size_t) L * sizeof (float));
+
+        // Real cepstrum: c = IFFT(log|X|)
+        fft.perform (re, im, true);
+
+        // Minimum-phase cepstral window: 1, 2 ... 2, 1, 0 ... 0
+        for (int n = 1; n < N; ++n)
+        {
+            const float w = (n < N / 2) ? 2.0f : (n == N / 2 ? 1.0f : 0.0f);
+            float* r = re + n * L;
+            float* i = im + n * L;
+            for (int l = 0; l < L; ++l)
+            {
+                r[l] *= w;
+                i[l] *= w;
+            }
+        }
+
+        // Back to frequency domain: L = FFT(c_min)
+        fft.perform (re, im, false);
+
+        // Exponentiate: H = exp(L)
+        expSinCosBlock (re, im, N * L);
+
+        // IFFT to get time-domain minimum-phase frames
+        fft.perform (re, im, true);
+
+        for (int l = 0; l < count; ++l)
+        {
+            float* dst = outFrames[l];
+            for (int n = 0; n < N; ++n)
+                dst[n] = re[n * L + l];
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <JuceHeader.h>
+
+#include <vector>
+
+//==============================================================================
+// FFT por lotes: 'lanes' frames del mismo tamaño transformados a la vez, un frame
+// por lane SIMD. Layout split-complex intercalado por lane:
+//
+//     re[n * lanes + l], im[n * lanes + l]    (n = bin/sample, l = frame)
+//
+// El loop interior de cada butterfly recorre las lanes con longitud constante,
+// así que el compilador lo vectoriza al ancho disponible (SSE/AVX/NEON).
+namespace batched
+{
+    static constexpr int lanes = 8;
+
+    class FrameBatchFft
+    {
+    public:
+        explicit FrameBatchFft (int order);
+
+        int getSize() const noexcept { return size; }
+
+        // Misma convención que juce::dsp::FFT: la inversa queda escalada por 1/N
+        void perform (float* re, float* im, bool inverse) const noexcept;
+
+    private:
+        int size = 0;
+        std::vector<int>   bitReversed;
+        std::vector<float> twiddleRe; // cos (2*pi*k/N), k < N/2
+        std::vector<float> twiddleIm; // -sin (2*pi*k/N)
+
+        JUCE_DECLARE_NON_COPYABLE (FrameBatchFft)
+    };
+
+    // Scratch reutilizable por hilo (2 * N * lanes floats)
+    struct Scratch
+    {
+        std::vector<float> re, im;
+    };
+
+    // Reconstrucción de fase mínima (real-cepstrum) de hasta 'lanes' frames a la vez.
+    // mags[i]: nBins = N/2 + 1 magnitudes; outFrames[i]: N samples.
+    void minimumPhase (const FrameBatchFft& fft,
+                       const float* const* mags,
+                       float* const* outFrames,
+                       int count,
+                       Scratch& scratch);
+}
@@ -0,0 +1,272 @@
+/*
+  ==============================================================================
+
+    BuiltinWavetables.cpp
+    - Band-limited basic shapes, generated once per process
+    - Mip level m keeps harmonics up to min (N/2 - 1, 1024 >> m)
+    - Minimum-phase BLEP residual table for hard sync
+
+  ==============================================================================
+*/
+
+#include "BuiltinWavetables.h"
+#include "WtgenDecoder.h"
+#include "FftBackend.h"
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    using builtin::Shape;
+
+    static int maxHarmonicForLevel (int level)
+    {
+        return juce::jmin (builtin::tableSize / 2 - 1, 1024 >> level);
+    }
+
+    // Serie de Fourier (en senos) de cada forma, pico ~1
+    static double harmonicAmp (Shape shape, int h)
+    {
+        const double pi = juce::MathConstants<double>::pi;
+
+        switch (shape)
+        {
+            case Shape::sine:
+                return h == 1 ? 1.0 : 0.0;
+
+            case Shape::saw:
+                return (2.0 / pi) * ((h & 1) ? 1.0 : -1.0) / (double) h;
+
+            case Shape::square:
+                return (h & 1) ? (4.0 / pi) / (double) h : 0.0;
+
+            case Shape::triangle:
+            {
+                if ((h & 1) == 0)
+                    return 0.0;
+
+                const double sign = (((h - 1) / 2) & 1) ? -1.0 : 1.0;
+                return sign * (8.0 / (pi * pi)) / ((double) h * (double) h);
+            }
+        }
+
+        return 0.0;
+    }
+
+    struct Bank
+    {
+        Bank()
+        {
+            constexpr int N = builtin::tableSize;
+
+            std::vector<double> sine ((size_t) N);
+            for (int i = 0; i < N; ++i)
+                sine[(size_t) i] = std::sin (juce::MathConstants<double>::twoPi * (double) i / (double) N);
+
+            const auto names = builtin::getShapeNames();
+
+            for (int s = 0; s < builtin::numShapes; ++s)
+            {
+                const auto shape = (Shape) s;
+
+                // Del nivel más alto (menos armónicos) al 0, acumulando
+                std::array<std::vector<double>, builtin::numMipLevels> levels;
+                std::vector<double> acc ((size_t) N, 0.0);
+                int hDone = 0;
+
+                for (int m = builtin::numMipLevels - 1; m >= 0; --m)
+                {
+                    const int hMax = maxHarmonicForLevel (m);
+                    for (int h = hDone + 1; h <= hMax; ++h)
+                    {
+                        const double a = harmonicAmp (shape, h);
+                        if (a == 0.0)
+                            continue;
+
+                        // sin(2*pi*h*i/N) == sine[(h*i) mod N]
+                        for (int i = 0; i < N; ++i)
+                            acc[(size_t) i] += a * sine[(size_t) ((h * i) & (N - 1))];
+                    }
+                    hDone = juce::jmax (hDone, hMax);
+                    levels[(size_t) m] = acc;
+                }
+
+                // Misma ganancia para todos los niveles (sin saltos de volumen entre mips)
+                double peak = 0.0;
+                for (auto v : levels[0])
+                    peak = juce::jmax (peak, std::abs (v));
+                const double gain = peak > 0.0 ? 0.999 / peak : 1.0;
+
+                Wavetable::Ptr shared;
+                for (int m = 0; m < builtin::numMipLevels; ++m)
+                {
+                    // Seno: un solo armónico, todos los niveles son idénticos
+                    if (shape == Shape::sine && shared != nullptr)
+                    {
+                        tables[(size_t) s][(size_t) m] = shared;
+                        continue;
+                    }
+
+                    auto wt = Wavetable::Ptr (new Wavetable());
+                    wt->tableSize = N;
+                    wt->frames = 1;
+                    wt->name = names[s];
+                    wt->table.setSize (1, N);
+
+                    auto* dst = wt->table.getWritePointer (0);
+                    for (int i = 0; i < N; ++i)
+                        dst[i] = (float) (levels[(size_t) m][(size_t) i] * gain);
+
+                    wt->contentHash = wtgen::hashBytes (dst, (size_t) N * sizeof (float));
+
+                    // Mips: nunca pasan de Nyquist con el nivel que elige getMipLevelForDelta
+                    wt->maxBandwidth = shape == Shape::sine ? 1 : maxHarmonicForLevel (m);
+                    wt->frameBandwidth = { wt->maxBandwidth };
+
+                    bytes += wt->getMemoryBytes();
+                    tables[(size_t) s][(size_t) m] = wt;
+                    shared = wt;
+                }
+            }
+        }
+
+        std::array<std::array<Wavetable::Ptr, builtin::numMipLevels>, builtin::numShapes> tables;
+        size_t bytes = 0;
+    };
+
+    static Bank& getBank()
+    {
+        static Bank bank;
+        return bank;
+    }
+
+    //==============================================================================
+    // minBLEP (Brandt): sinc con ventana Blackman -> fase mínima vía cepstrum real ->
+    // integral. Residual = minBLEP - 1, muestreado a blepPhases posiciones por sample
+    struct MinBlep
+    {
+        MinBlep()
+        {
+            constexpr int os = builtin::blepPhases;
+            constexpr int n  = builtin::blepTaps * os + 1; // blepTaps/2 cruces por cero a cada lado
+            constexpr int fftOrder = 13;                   // >> n: poco aliasing del cepstrum
+            constexpr int N = 1 << fftOrder;
+
+            const double pi = juce::MathConstants<double>::pi;
+            auto engine = fft::create (fftOrder);
+            std::vector<fft::Complex> buf ((size_t) N);
+
+            for (int i = 0; i < n; ++i)
+            {
+                const double t = (double) (i - (n - 1) / 2) / (double) os;
+                const double sinc = t == 0.0 ? 1.0 : std::sin (pi * t) / (pi * t);
+                const double w = 0.42 - 0.5 * std::cos (2.0 * pi * i / (n - 1))
+                                      + 0.08 * std::cos (4.0 * pi * i / (n - 1));
+                buf[(size_t) i] = { (float) (sinc * w), 0.0f };
+            }
+
+            // Cepstrum real: log |X| -> tiempo
+            engine->perform (buf.data(), false);
+            for (auto& x : buf)
+                x = { std::log (juce::jmax (std::abs (x), 1.0e-7f)), 0.0f };
+            engine->perform (buf.data(), true);
+
+            // Plegado a la parte causal => fase mínima
+            for (int i = 1; i < N / 2; ++i)
+                buf[(size_t) i] = { 2.0f * buf[(size_t) i].real(), 0.0f };
+            buf[0] = { buf[0].real(), 0.0f };
+            buf[(size_t) N / 2] = { buf[(size_t) N / 2].real(), 0.0f };
+            for (int i = N / 2 + 1; i < N; ++i)
+                buf[(size_t) i] = {};
+
+            engine->perform (buf.data(), false);
+            for (auto& x : buf)
+                x = std::exp (x);
+            engine->perform (buf.data(), true);
+
+            // Integral del impulso de fase mínima, normalizada a 1 al final
+            std::vector<double> step ((size_t) n);
+            double acc = 0.0;
+            for (int i = 0; i < n; ++i)
+            {
+                acc += buf[(size_t) i].real();
+                step[(size_t) i] = acc;
+            }
+
+            const double norm = acc != 0.0 ? 1.0 / acc : 1.0;
+
+            // Fila p: salto p/os samples antes del primer sample corregido
+            for (int p = 0; p <= os; ++p)
+                for (int k = 0; k < builtin::blepTaps; ++k)
+                    residual[(size_t) p][(size_t) k] = (float) (step[(size_t) (k * os + p)] * norm - 1.0);
+        }
+
+        std::array<std::array<float, builtin::blepTaps>, builtin::blepPhases + 1> residual {};
+    };
+
+    static MinBlep& getMinBlep()
+    {
+        static MinBlep blep;
+        return blep;
+    }
+}
+
+//==============================================================================
+namespace builtin
+{
+    juce::StringArray getShapeNames()
+    {
+        return { "Sine", "Saw", "Square", "Triangle" };
+    }
+
+    void prepare()
+    {
+        (void) getBank();
+        (void) getMinBlep();
+    }
+
+    int getMipLevelForDelta (float phaseDelta) noexcept
+    {
+        // nivel m sin aliasing si (1024 >> m) * delta <= 0.5  <=>  delta <= 2^m / 2048
+        int m = 0;
+        float limit = 1.0f / 2048.0f;
+        const float d = std::abs (phaseDelta);
+
+        while (m < numMipLevels - 1 && d > limit)
+        {
+            limit *= 2.0f;
+            ++m;
+        }
+        return m;
+    }
+
+    const Wavetable& get (Shape shape, int mipLevel) noexcept
+    {
+        const auto s = (size_t) juce::jlimit (0, numShapes - 1, (int) shape);
+        const auto m = (size_t) juce::jlimit (0, numMipLevels - 1, mipLevel);
+        return *getBank().tables[s][m];
+    }
+
+    size_t getMemoryBytes() noexcept
+    {
+        return getBank().bytes + sizeof (MinBlep);
+    }
+
+    void addBlepResidual (float* dst, float fraction, float height) noexcept
+    {
+        const auto& table = getMinBlep().residual;
+
+        // Interpolación lineal entre las dos filas vecinas
+        const float pos = juce::jlimit (0.0f, 1.0f, fraction) * (float) blepPhases;
+        const int p = juce::jmin ((int) pos, blepPhases - 1);
+        const float f = pos - (float) p;
+
+        const auto& a = table[(size_t) p];
+        const auto& b = table[(size_t) p + 1];
+
+        for (int k = 0; k < blepTaps; ++k)
+            dst[k] += height * (a[(size_t) k] + f * (b[(size_t) k] - a[(size_t) k]));
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <JuceHeader.h>
+
+#include "PluginProcessor.h"
+
+//==============================================================================
+// Factory set de formas básicas band-limited (sine/saw/square/triangle) con mips.
+//
+// Se generan una sola vez por proceso en memoria compartida e inmutable; los
+// slots vacíos las usan por el mismo camino de tabla que un .wtgen cargado.
+namespace builtin
+{
+    using Wavetable = BasicInstrumentAudioProcessor::Wavetable;
+
+    enum class Shape
+    {
+        sine = 0,
+        saw,
+        square,
+        triangle
+    };
+
+    static constexpr int numShapes    = 4;
+    static constexpr int tableSize    = 2048;
+    static constexpr int numMipLevels = 11; // nivel m: armónicos hasta min (N/2 - 1, 1024 >> m)
+
+    // Nombres para el parámetro de elección (mismo orden que Shape)
+    juce::StringArray getShapeNames();
+
+    // Genera las tablas si aún no existen. Llamar fuera del audio thread
+    // (constructor del processor) para que get() nunca reserve memoria.
+    void prepare();
+
+    // Nivel de mip sin aliasing para un phaseDelta en ciclos/sample
+    int getMipLevelForDelta (float phaseDelta) noexcept;
+
+    // Tabla de 1 frame para la forma y el nivel dados (requiere prepare())
+    const Wavetable& get (Shape shape, int mipLevel) noexcept;
+
+    // Memoria total retenida por el factory set (compartida por todas las instancias)
+    size_t getMemoryBytes() noexcept;
+
+    //==============================================================================
+    // Residual minBLEP para hard sync: escalón band-limited de fase mínima menos el
+    // escalón ideal. Causal: solo corrige samples posteriores al salto, así que nunca
+    // hay que tocar audio ya escrito. Se genera en prepare() junto a las tablas.
+    static constexpr int blepTaps   = 16; // samples corregidos tras cada salto
+    static constexpr int blepPhases = 32; // resolución de la posición fraccional
+
+    // dst[0 .. blepTaps) += height * residual. fraction (0..1): tiempo entre el salto
+    // y dst[0], en samples; height: valor tras el salto menos valor antes
+    void addBlepResidual (float* dst, float fraction, float height) noexcept;
+}
@@ -0,0 +1,207 @@
+/*
+  ==============================================================================
+
+    FftBackend.cpp
+    - juce::dsp::FFT backend (default)
+    - Optional pocketfft backend (header-only, fetched at configure time)
+
+  ==============================================================================
+*/
+
+#include "FftBackend.h"
+
+#include <vector>
+
+#if BASICINSTRUMENT_HAS_POCKETFFT
+ #define POCKETFFT_NO_MULTITHREADING 1 // el paralelismo lo ponemos nosotros (por tabla / lote)
+ #include <pocketfft_hdronly.h>
+#endif
+
+namespace
+{
+    using fft::Complex;
+
+    //==============================================================================
+    // juce::dsp::FFT ya escala la inversa por 1/N: el contrato se cumple tal cual
+    class JuceEngine final : public fft::Engine
+    {
+    public:
+        explicit JuceEngine (int order)
+            : Engine (order),
+              impl (order),
+              scratch ((size_t) (1 << order) * 2, 0.0f)
+        {
+        }
+
+        void perform (Complex* data, bool inverse) noexcept override
+        {
+            impl.perform (data, data, inverse);
+        }
+
+        void forwardReal (const float* time, Complex* bins) noexcept override
+        {
+            const int N = getSize();
+            std::copy (time, time + N, scratch.begin());
+            std::fill (scratch.begin() + N, scratch.end(), 0.0f);
+
+            impl.performRealOnlyForwardTransform (scratch.data(), true);
+
+            for (int k = 0; k <= N / 2; ++k)
+                bins[k] = Complex (scratch[(size_t) (2 * k)], scratch[(size_t) (2 * k + 1)]);
+        }
+
+        void inverseReal (const Complex* bins, float* time) noexcept override
+        {
+            const int N = getSize();
+            std::fill (scratch.begin(), scratch.end(), 0.0f);
+
+            for (int k = 0; k <= N / 2; ++k)
+            {
+                scratch[(size_t) (2 * k)] = bins[k].real();
+                if (k > 0 && k < N / 2)
+                    scratch[(size_t) (2 * k + 1)] = bins[k].imag();
+            }
+
+            impl.performRealOnlyInverseTransform (scratch.data());
+            std::copy (scratch.begin(), scratch.begin() + N, time);
+        }
+
+    private:
+        juce::dsp::FFT impl;
+        std::vector<float> scratch; // 2N floats (formato performRealOnly*)
+    };
+
+   #if BASICINSTRUMENT_HAS_POCKETFFT
+    //==============================================================================
+    // pocketfft: planes precalculados; el real usa el formato halfcomplex de FFTPACK
+    // (r0, r1, i1, r2, i2, ..., r(N/2))
+    class PocketEngine final : public fft::Engine
+    {
+    public:
+        explicit PocketEngine (int order)
+            : Engine (order),
+              complexPlan ((size_t) (1 << order)),
+              realPlan ((size_t) (1 << order)),
+              scratch ((size_t) (1 << order), 0.0f)
+        {
+        }
+
+        void perform (Complex* data, bool inverse) noexcept override
+        {
+            const float scale = inverse ? 1.0f / (float) getSize() : 1.0f;
+            complexPlan.exec (reinterpret_cast<pocketfft::detail::cmplx<float>*> (data), scale, ! inverse);
+        }
+
+        void forwardReal (const float* time, Complex* bins) noexcept override
+        {
+            const int N = getSize();
+            std::copy (time, time + N, scratch.begin());
+
+            realPlan.exec (scratch.data(), 1.0f, true);
+
+            bins[0] = Complex (scratch[0], 0.0f);
+            for (int k = 1; k < N / 2; ++k)
+                bins[k] = Complex (scratch[(size_t) (2 * k - 1)], scratch[(size_t) (2 * k)]);
+            bins[N / 2] = Complex (scratch[(size_t) (N - 1)], 0.0f);
+        }
+
+        void inverseReal (const Complex* bins, float* time) noexcept override
+        {
+            const int N = getSize();
+
+            scratch[0] = bins[0].real();
+            for (int k = 1; k < N / 2; ++k)
+            {
+                scratch[(size_t) (2 * k - 1)] = bins[k].real();
+                scratch[(size_t) (2 * k)]     = bins[k].imag();
+            }
+            scratch[(size_t) (N - 1)] = bins[N / 2].real();
+
+            realPlan.exec (scratch.data(), 1.0f / (float) N, false);
+            std::copy (scratch.begin(), scratch.end(), time);
+        }
+
+    private:
+        pocketfft::detail::pocketfft_c<float> complexPlan;
+        pocketfft::detail::pocketfft_r<float> realPlan;
+        std::vector<float> scratch; // N floats (halfcomplex)
+    };
+   #endif
+
+    static constexpr fft::Backend configuredBackend =
+       #if BASICINSTRUMENT_DEFAULT_FFT_POCKETFFT && BASICINSTRUMENT_HAS_POCKETFFT
+        fft::Backend::pocketfft;
+       #else
+        fft::Backend::juce;
+       #endif
+}
+
+//==============================================================================
+namespace fft
+{
+    juce::String getBackendName (Backend backend)
+    {
+        switch (backend)
+        {
+            case Backend::pocketfft: return "pocketfft";
+            case Backend::juce:      break;
+        }
+        return "juce";
+    }
+
+    bool isBackendAvailable (Backend backend)
+    {
+        switch (backend)
+        {
+            case Backend::juce:
+                return true;
+
+            case Backend::pocketfft:
+               #if BASICINSTRUMENT_HAS_POCKETFFT
+                return true;
+               #else
+                return false;
+               #endif
+        }
+        return false;
+    }
+
+    juce::Array<Backend> getAvailableBackends()
+    {
+        juce::Array<Backend> result;
+        for (auto b : { Backend::juce, Backend::pocketfft })
+            if (isBackendAvailable (b))
+                result.add (b);
+        return result;
+    }
+
+    Backend getDefaultBackend() noexcept
+    {
+        return configuredBackend;
+    }
+
+    std::unique_ptr<Engine> create (int order, Backend backend)
+    {
+        if (order < 1)
+            return nullptr;
+
+        switch (backend)
+        {
+            case Backend::juce:
+                return std::make_unique<JuceEngine> (order);
+
+            case Backend::pocketfft:
+               #if BASICINSTRUMENT_HAS_POCKETFFT
+                return std::make_unique<PocketEngine> (order);
+               #else
+                break;
+               #endif
+        }
+        return nullptr;
+    }
+
+    std::unique_ptr<Engine> create (int order)
+    {
+        return create (order, getDefaultBackend());
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <JuceHeader.h>
+
+#include <complex>
+#include <memory>
+
+//==============================================================================
+// Backend de FFT para el decoder y los analizadores
+//
+// Contrato de escala (igual para todos los backends):
+//   - forward: sin escalar,  X[k] = sum x[n] e^(-2*pi*i*k*n/N)
+//   - inverse: escalada por 1/N (inverse (forward (x)) == x)
+//
+// Un Engine tiene scratch propio: uno por hilo, no compartir entre hilos.
+namespace fft
+{
+    enum class Backend
+    {
+        juce = 0,   // juce::dsp::FFT (siempre disponible)
+        pocketfft   // pocketfft header-only (BASICINSTRUMENT_FFT_BACKEND=pocketfft)
+    };
+
+    using Complex = std::complex<float>;
+
+    class Engine
+    {
+    public:
+        explicit Engine (int orderIn) : order (orderIn), size (1 << orderIn) {}
+        virtual ~Engine() = default;
+
+        int getOrder() const noexcept { return order; }
+        int getSize() const noexcept  { return size; }
+
+        // Complejo in-place, N valores
+        virtual void perform (Complex* data, bool inverse) noexcept = 0;
+
+        // Real -> medio espectro: time[N] -> bins[N/2 + 1]
+        virtual void forwardReal (const float* time, Complex* bins) noexcept = 0;
+
+        // Medio espectro -> real: bins[N/2 + 1] -> time[N]
+        // (la parte imaginaria de DC y Nyquist se ignora)
+        virtual void inverseReal (const Complex* bins, float* time) noexcept = 0;
+
+    private:
+        const int order;
+        const int size;
+
+        JUCE_DECLARE_NON_COPYABLE (Engine)
+    };
+
+    //==============================================================================
+    juce::String getBackendName (Backend backend);
+    bool isBackendAvailable (Backend backend);
+    juce::Array<Backend> getAvailableBackends();
+
+    // Backend usado por create() sin argumento: el elegido en configure
+    // (BASICINSTRUMENT_FFT_BACKEND). Otro backend se pide por llamada (create, o
+    // DecodeLimits::fftBackend en el decoder), nunca cambiando estado global.
+    Backend getDefaultBackend() noexcept;
+
+    // nullptr si el backend no está compilado
+    std::unique_ptr<Engine> create (int order, Backend backend);
+    std::unique_ptr<Engine> create (int order);
+}
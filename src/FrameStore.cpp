@@ -0,0 +1,163 @@
+/*
+  ==============================================================================
+
+    FrameStore.cpp
+    - Content-addressed frame store shared by slots and instances
+    - Identical frames are kept once; tables hold an indirection table
+    - Mip levels of loaded tables are interned the same way
+
+  ==============================================================================
+*/
+
+#include "FrameStore.h"
+#include "WtgenDecoder.h"
+
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    using framestore::SharedFrame;
+
+    struct Store
+    {
+        juce::CriticalSection lock;
+        std::unordered_multimap<juce::uint64, SharedFrame::Ptr> frames;
+    };
+
+    static Store& getStore()
+    {
+        static Store store;
+        return store;
+    }
+
+    static bool sameSamples (const SharedFrame& frame, const float* samples, int size) noexcept
+    {
+        return frame.size == size
+            && std::memcmp (frame.data.get(), samples, (size_t) size * sizeof (float)) == 0;
+    }
+
+    // Con el lock tomado: el frame del store con estas muestras, o nullptr
+    static SharedFrame::Ptr findLocked (Store& store, juce::uint64 hash, const float* samples, int size)
+    {
+        const auto range = store.frames.equal_range (hash);
+        for (auto it = range.first; it != range.second; ++it)
+            if (sameSamples (*it->second, samples, size))
+                return it->second;
+
+        return nullptr;
+    }
+
+    // Con el lock tomado. Referencia 1 = solo el store: nadie más puede obtenerla
+    // sin pasar por aquí, así que soltarla es seguro
+    static void purgeLocked (Store& store)
+    {
+        for (auto it = store.frames.begin(); it != store.frames.end();)
+        {
+            if (it->second->getReferenceCount() == 1)
+                it = store.frames.erase (it);
+            else
+                ++it;
+        }
+    }
+}
+
+//==============================================================================
+namespace framestore
+{
+    void intern (Wavetable& wt)
+    {
+        const int N = wt.tableSize;
+        const int F = wt.frames;
+
+        if (! wt.sharedFrames.empty() || N <= 0 || F <= 0
+             || wt.table.getNumChannels() != F || wt.table.getNumSamples() != N)
+            return;
+
+        // Hash fuera del lock (es lo caro). Los mips aún son solo de esta tabla
+        std::vector<juce::uint64> hashes ((size_t) F);
+        for (int f = 0; f < F; ++f)
+            hashes[(size_t) f] = wtgen::hashBytes (wt.table.getReadPointer (f), (size_t) N * sizeof (float));
+
+        for (auto& mip : wt.mipFrames)
+            if (mip != nullptr)
+                mip->hash = wtgen::hashBytes (mip->data.get(), (size_t) mip->size * sizeof (float));
+
+        std::vector<SharedFrame::Ptr> shared;
+        shared.reserve ((size_t) F);
+
+        auto& store = getStore();
+        {
+            const juce::ScopedLock sl (store.lock);
+            purgeLocked (store);
+
+            for (int f = 0; f < F; ++f)
+            {
+                const auto h = hashes[(size_t) f];
+                const auto* samples = wt.table.getReadPointer (f);
+
+                SharedFrame::Ptr match;
+
+                // Tramo estático: igual al frame anterior, sin buscar en el store
+                if (f > 0 && shared.back()->hash == h && sameSamples (*shared.back(), samples, N))
+                    match = shared.back();
+
+                if (match == nullptr)
+                    match = findLocked (store, h, samples, N);
+
+                if (match == nullptr)
+                {
+                    match = new SharedFrame();
+                    match->hash = h;
+                    match->size = N;
+                    match->data.allocate ((size_t) N, false);
+                    std::memcpy (match->data.get(), samples, (size_t) N * sizeof (float));
+
+                    store.frames.emplace (h, match);
+                }
+
+                shared.push_back (match);
+            }
+
+            // Mips: mismo contenido -> mismo SharedFrame (frames repetidos de la tabla
+            // ya comparten el suyo)
+            for (auto& mip : wt.mipFrames)
+            {
+                if (mip == nullptr)
+                    continue;
+
+                if (auto match = findLocked (store, mip->hash, mip->data.get(), mip->size))
+                    mip = match;
+                else
+                    store.frames.emplace (mip->hash, mip);
+            }
+        }
+
+        wt.sharedFrames = std::move (shared);
+        wt.table = juce::AudioBuffer<float>();
+    }
+
+    void purgeUnused()
+    {
+        auto& store = getStore();
+        const juce::ScopedLock sl (store.lock);
+        purgeLocked (store);
+    }
+
+    Stats getStats()
+    {
+        Stats stats;
+
+        auto& store = getStore();
+        const juce::ScopedLock sl (store.lock);
+
+        for (auto& entry : store.frames)
+        {
+            ++stats.frames;
+            stats.bytes += entry.second->getMemoryBytes();
+        }
+
+        return stats;
+    }
+}
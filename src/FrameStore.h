@@ -0,0 +1,39 @@
+#pragma once
+#include <JuceHeader.h>
+
+#include "PluginProcessor.h"
+
+//==============================================================================
+// Store de frames direccionado por contenido, compartido por todo el proceso.
+//
+// Los frames de una tabla reconstruida se identifican por el hash de sus
+// muestras; frames idénticos (tramos estáticos, la misma tabla en varios slots
+// o instancias) quedan como un solo SharedFrame y la tabla solo guarda la
+// indirección. Dos frames con el mismo hash se comparan muestra a muestra
+// antes de compartirse.
+//
+// El store retiene una referencia a cada frame: el último release nunca ocurre
+// en el audio thread. Los frames que ya nadie usa se sueltan al internar otra
+// tabla o con purgeUnused().
+namespace framestore
+{
+    using Wavetable   = BasicInstrumentAudioProcessor::Wavetable;
+    using SharedFrame = Wavetable::SharedFrame;
+
+    // Mueve los frames de wt.table al store (wt.table queda vacío; usar
+    // wt.getFrame) e interna sus mips. Llamar antes de publicar la tabla, fuera
+    // del audio thread.
+    void intern (Wavetable& wt);
+
+    // Suelta los frames que solo retiene el store. El processor y el banco la llaman
+    // (fuera del audio thread) al soltar slots, programas o la instancia
+    void purgeUnused();
+
+    struct Stats
+    {
+        int    frames = 0; // frames únicos retenidos (en uso o pendientes de purga)
+        size_t bytes  = 0;
+    };
+
+    Stats getStats();
+}
@@ -10,13 +10,23 @@
 */
 
 #include "PluginProcessor.h"
-
+#include "WtgenDecoder.h"
+#include "BuiltinWavetables.h"
+#include "FrameStore.h"
+#include "WtgenLoader.h"
+#include "ProgramBank.h"
+#include "VoiceKernels.h"
+#include "Waveshaper.h"
+
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <vector>
 #include <cstring>
 #include <memory>
 #include <array>
 #include <atomic>          // <-- NECESARIO por std::atomic
+#include <set>
 #include "BinaryData.h"    // <-- NECESARIO por BinaryData::mi_fuente_ttf
 
 //==============================================================================
@@ -27,364 +37,12 @@ struct SineSound : public juce::SynthesiserSound
     bool appliesToChannel (int) override   { return true; }
 };
 
-//==============================================================================
-// Helpers (static, only inside this TU)
 namespace
 {
-    // ------------------------------
-    // Little-endian readers
-    static inline bool canRead (const juce::uint8* ptr, size_t size, size_t offset, size_t bytes)
-    {
-        return (offset + bytes) <= size && ptr != nullptr;
-    }
-
-    static inline juce::uint16 readLEU16 (const juce::uint8* ptr, size_t size, size_t& off)
-    {
-        if (! canRead (ptr, size, off, 2))
-            return 0;
-
-        const auto lo = (juce::uint16) ptr[off + 0];
-        const auto hi = (juce::uint16) ptr[off + 1];
-        off += 2;
-        return (juce::uint16) (lo | (hi << 8));
-    }
-
-    static inline juce::int16 readLEI16 (const juce::uint8* ptr, size_t size, size_t& off)
-    {
-        const auto u = readLEU16 (ptr, size, off);
-        return (juce::int16) u;
-    }
-
-    // ------------------------------
-    // JUCE var JSON navigation helpers
-    static juce::String varToString (const juce::var& v)
-    {
-        if (v.isString())
-            return v.toString();
-        return {};
-    }
-
-    static juce::var getProp (const juce::var& objVar, const juce::Identifier& key)
-    {
-        if (auto* obj = objVar.getDynamicObject())
-            return obj->getProperty (key);
-        return {};
-    }
-
-    static const juce::Array<juce::var>* getArray (const juce::var& v)
-    {
-        return v.getArray();
-    }
-
-    static juce::var arrayAt (const juce::var& arrVar, int index)
-    {
-        if (auto* arr = getArray (arrVar))
-            if (juce::isPositiveAndBelow (index, arr->size()))
-                return arr->getReference (index);
-        return {};
-    }
-
-    // ------------------------------
-    // Band edges helper (must match exporter)
-    static std::vector<int> linearBandEdges (int loBin, int hiBin, int bands)
-    {
-        bands = juce::jmax (1, bands);
-        loBin = juce::jmax (0, loBin);
-        hiBin = juce::jmax (loBin, hiBin);
-
-        const int total = hiBin - loBin;
-        std::vector<int> edges;
-        edges.reserve ((size_t) bands + 1);
-
-        edges.push_back (loBin);
-        for (int i = 1; i < bands; ++i)
-        {
-            // floor(lo + i * total / bands)
-            const double t = (double) i / (double) bands;
-            const int edge = loBin + (int) std::floor (t * (double) total);
-            edges.push_back (edge);
-        }
-        edges.push_back (hiBin);
-        return edges;
-    }
-
-    // ------------------------------
-    // Minimum-phase reconstruction from magnitude spectrum (real signal)
-    // Implements the standard real-cepstrum method.
-    static bool minimumPhaseFromMagRfft (const std::vector<float>& magRfft, int N, std::vector<float>& outTime)
-    {
-        if (N <= 0)
-            return false;
-
-        const int nBins = (N / 2) + 1;
-        if ((int) magRfft.size() != nBins)
-            return false;
-
-        const float eps = 1.0e-12f;
-        const int order = (int) std::round (std::log2 ((double) N));
-        if ((1 << order) != N)
-            return false;
-
-        juce::dsp::FFT fft (order);
-        using Complex = juce::dsp::Complex<float>;
-
-        // Build full even log-magnitude spectrum (length N)
-        std::vector<Complex> X ((size_t) N);
-        for (int k = 0; k < N; ++k)
-        {
-            const int rk = (k <= N / 2) ? k : (N - k);
-            const float m = juce::jmax (magRfft[(size_t) rk], eps);
-            X[(size_t) k] = Complex (std::log (m), 0.0f);
-        }
-
-        // Real cepstrum: c = IFFT(log|X|)
-        fft.perform (X.data(), X.data(), true);
-        const float invN = 1.0f / (float) N;
-        for (int n = 0; n < N; ++n)
-            X[(size_t) n] *= invN;
-
-        // Minimum-phase cepstrum shaping
-        for (int n = 1; n < N; ++n)
-        {
-            if (n < N / 2)
-                X[(size_t) n] *= 2.0f;
-            else if (n > N / 2)
-                X[(size_t) n] = Complex (0.0f, 0.0f);
-        }
-
-        // Back to frequency domain: L = FFT(c_min)
-        fft.perform (X.data(), X.data(), false);
-
-        // Exponentiate: H = exp(L)
-        for (int k = 0; k < N; ++k)
-        {
-            const float a = X[(size_t) k].real();
-            const float b = X[(size_t) k].imag();
-            const float ea = std::exp (a);
-            X[(size_t) k] = Complex (ea * std::cos (b), ea * std::sin (b));
-        }
-
-        // IFFT to get time-domain minimum-phase frame
-        fft.perform (X.data(), X.data(), true);
-        for (int n = 0; n < N; ++n)
-            X[(size_t) n] *= invN;
-
-        outTime.resize ((size_t) N);
-        for (int n = 0; n < N; ++n)
-            outTime[(size_t) n] = X[(size_t) n].real();
-
-        return true;
-    }
-
-    // ------------------------------
-    // Parse a wtgen-1 JSON and return a constructed wavetable
-    static bool buildWavetableFromWtgenJson (const juce::String& jsonText,
-                                             const juce::String& nameHint,
-                                             BasicInstrumentAudioProcessor::Wavetable::Ptr& outWt,
-                                             juce::String& err)
+    // "pm_<modulador>_<portadora>", numerados desde 1 como los osc de la UI
+    static juce::String getPmParamId (int modulator, int carrier)
     {
-        outWt = nullptr;
-
-        juce::var root;
-        const auto parseRes = juce::JSON::parse (jsonText, root);
-        if (parseRes.failed())
-        {
-            err = "JSON parse failed: " + parseRes.getErrorMessage();
-            return false;
-        }
-
-        const auto schema = varToString (getProp (root, "schema"));
-        if (schema != "wtgen-1")
-        {
-            err = "Invalid schema (expected wtgen-1)";
-            return false;
-        }
-
-        const auto program = getProp (root, "program");
-        const auto nodes = getProp (program, "nodes");
-        const auto node0 = arrayAt (nodes, 0);
-
-        const auto op = varToString (getProp (node0, "op"));
-        if (op != "spectralData")
-        {
-            err = "Unsupported program.nodes[0].op (expected spectralData)";
-            return false;
-        }
-
-        const auto p = getProp (node0, "p");
-        const auto codec = varToString (getProp (p, "codec"));
-        if (codec != "harm-noise-framepack-v1")
-        {
-            err = "Unsupported codec (expected harm-noise-framepack-v1)";
-            return false;
-        }
-
-        const auto dataB64 = varToString (getProp (p, "data"));
-        if (dataB64.isEmpty())
-        {
-            err = "Missing program.nodes[0].p.data";
-            return false;
-        }
-
-        // Optional banding info (needed to spread noise bands)
-        int loBin = 0;
-        int hiBin = 0;
-        {
-            const auto noise = getProp (p, "noise");
-            const auto banding = getProp (noise, "banding");
-            loBin = (int) getProp (banding, "loBin");
-            hiBin = (int) getProp (banding, "hiBin");
-        }
-
-        // Base64 decode into MemoryBlock
-        juce::MemoryOutputStream mo;
-        if (! juce::Base64::convertFromBase64 (mo, dataB64))
-        {
-            err = "Base64 decode failed";
-            return false;
-        }
-
-        const auto mb = mo.getMemoryBlock();
-        const auto* bytes = (const juce::uint8*) mb.getData();
-        const auto size = (size_t) mb.getSize();
-
-        // Decode header
-        size_t off = 0;
-        static constexpr juce::uint8 magic[7] = { 'H','N','F','P','v','1','\0' };
-        if (! canRead (bytes, size, off, sizeof (magic)))
-        {
-            err = "Corrupt data (too small)";
-            return false;
-        }
-
-        if (std::memcmp (bytes + off, magic, sizeof (magic)) != 0)
-        {
-            err = "Invalid magic (expected HNFPv1\\0)";
-            return false;
-        }
-        off += sizeof (magic);
-
-        const int tableSize = (int) readLEU16 (bytes, size, off);
-        const int F = (int) readLEU16 (bytes, size, off);
-        const int H = (int) readLEU16 (bytes, size, off);
-        const int B = (int) readLEU16 (bytes, size, off);
-
-        if (tableSize <= 0 || F <= 0)
-        {
-            err = "Invalid header (tableSize/frames)";
-            return false;
-        }
-        if (H < 0 || B < 0)
-        {
-            err = "Invalid header (H/B)";
-            return false;
-        }
-        if (tableSize != (1 << (int) std::round (std::log2 ((double) tableSize))))
-        {
-            err = "tableSize must be power-of-two (for FFT)";
-            return false;
-        }
-
-        const int N = tableSize;
-        const int nBins = (N / 2) + 1;
-
-        if (hiBin <= 0)
-            hiBin = nBins - 1;
-        if (loBin <= 0)
-            loBin = juce::jlimit (0, nBins - 1, H + 1);
-
-        const auto edges = linearBandEdges (loBin, hiBin, juce::jmax (1, B));
-
-        // Validate size expectation (best-effort)
-        const size_t perFrameBytes = (size_t) H * 2 + (size_t) B * 2 + 3 * 2;
-        const size_t expectedMin = sizeof (magic) + 4 * 2 + (size_t) F * perFrameBytes;
-        if (size < expectedMin)
-        {
-            err = "Corrupt data (truncated framepack)";
-            return false;
-        }
-
-        auto wt = BasicInstrumentAudioProcessor::Wavetable::Ptr (new BasicInstrumentAudioProcessor::Wavetable());
-        wt->tableSize = tableSize;
-        wt->frames = F;
-        wt->name = nameHint.isNotEmpty() ? nameHint : "Wavetable";
-        wt->table.setSize (F, tableSize);
-        wt->table.clear();
-
-        std::vector<float> mag ((size_t) nBins, 0.0f);
-        std::vector<float> time;
-
-        for (int f = 0; f < F; ++f)
-        {
-            std::fill (mag.begin(), mag.end(), 0.0f);
-
-            // Harmonics (u16)
-            for (int h = 0; h < H; ++h)
-            {
-                const auto q = (float) readLEU16 (bytes, size, off);
-                const float harmAmpScaled = q / 4096.0f;                 // (mag * (2/N))
-                const float binMag = harmAmpScaled * ((float) N * 0.5f); // back to rfft magnitude
-                const int bin = 1 + h;
-                if (bin >= 0 && bin < nBins)
-                    mag[(size_t) bin] = binMag;
-            }
-
-            // Noise bands (i16 dB*2)
-            for (int b = 0; b < B; ++b)
-            {
-                const auto qdb = (float) readLEI16 (bytes, size, off);
-                const float db = qdb * 0.5f;
-                const float rmsScaled = std::pow (10.0f, db / 20.0f);
-                const float binMag = rmsScaled * ((float) N * 0.5f);
-
-                const int a = edges[(size_t) b];
-                const int c = edges[(size_t) b + 1];
-                for (int k = a; k < c && k < nBins; ++k)
-                    mag[(size_t) k] = binMag;
-            }
-
-            // 3*u16 tilt params (ignored for now)
-            (void) readLEU16 (bytes, size, off);
-            (void) readLEU16 (bytes, size, off);
-            (void) readLEU16 (bytes, size, off);
-
-            // Safety: DC and Nyquist to zero
-            if (! mag.empty()) mag[0] = 0.0f;
-            if (nBins > 1) mag[(size_t) (nBins - 1)] = 0.0f;
-
-            if (! minimumPhaseFromMagRfft (mag, N, time))
-            {
-                err = "Minimum-phase reconstruction failed";
-                return false;
-            }
-
-            auto* dst = wt->table.getWritePointer (f);
-            for (int i = 0; i < N; ++i)
-                dst[i] = time[(size_t) i];
-        }
-
-        // DC remove per frame
-        for (int f = 0; f < F; ++f)
-        {
-            auto* dst = wt->table.getWritePointer (f);
-            double sum = 0.0;
-            for (int i = 0; i < N; ++i)
-                sum += dst[i];
-            const float mean = (float) (sum / (double) N);
-            for (int i = 0; i < N; ++i)
-                dst[i] -= mean;
-        }
-
-        // Normalize global peak
-        float peak = 0.0f;
-        for (int f = 0; f < F; ++f)
-            peak = juce::jmax (peak, wt->table.getMagnitude (f, 0, N));
-
-        if (peak > 0.0f)
-            wt->table.applyGain (0.999f / peak);
-
-        outWt = wt;
-        return true;
+        return "pm_" + juce::String (modulator + 1) + "_" + juce::String (carrier + 1);
     }
 }
 
@@ -409,6 +67,37 @@ struct WavetableVoice : public juce::SynthesiserVoice
         oscLevelParam[1] = apvts->getRawParameterValue ("osc2_level");
         oscLevelParam[2] = apvts->getRawParameterValue ("osc3_level");
         oscLevelParam[3] = apvts->getRawParameterValue ("osc4_level");
+
+        oscShapeParam[0] = apvts->getRawParameterValue ("osc1_shape");
+        oscShapeParam[1] = apvts->getRawParameterValue ("osc2_shape");
+        oscShapeParam[2] = apvts->getRawParameterValue ("osc3_shape");
+        oscShapeParam[3] = apvts->getRawParameterValue ("osc4_shape");
+
+        interpParam = apvts->getRawParameterValue ("wt_interp");
+
+        modeParam      = apvts->getRawParameterValue ("wt_mode");
+        playSpeedParam = apvts->getRawParameterValue ("play_speed");
+        playStartParam = apvts->getRawParameterValue ("play_start");
+        playEndParam   = apvts->getRawParameterValue ("play_end");
+        playLoopParam  = apvts->getRawParameterValue ("play_loop");
+
+        syncParam[1]   = apvts->getRawParameterValue ("osc2_sync");
+        syncParam[2]   = apvts->getRawParameterValue ("osc3_sync");
+        syncParam[3]   = apvts->getRawParameterValue ("osc4_sync");
+        syncRatioParam = apvts->getRawParameterValue ("sync_ratio");
+
+        for (int m = 0; m < 4; ++m)
+            for (int c = 0; c < 4; ++c)
+                pmParam[m][c] = apvts->getRawParameterValue (getPmParamId (m, c));
+
+        pmOversamplingParam = apvts->getRawParameterValue ("pm_oversampling");
+
+        vectorModeParam     = apvts->getRawParameterValue ("vector_mode");
+        vectorXParam        = apvts->getRawParameterValue ("vector_x");
+        vectorYParam        = apvts->getRawParameterValue ("vector_y");
+        vectorEnvParam      = apvts->getRawParameterValue ("vector_env");
+        vectorLfoRateParam  = apvts->getRawParameterValue ("vector_lfo_rate");
+        vectorLfoDepthParam = apvts->getRawParameterValue ("vector_lfo_depth");
     }
 
     bool canPlaySound (juce::SynthesiserSound* s) override
@@ -417,20 +106,30 @@ struct WavetableVoice : public juce::SynthesiserVoice
     }
 
     void startNote (int midiNoteNumber, float velocity,
-                    juce::SynthesiserSound*, int) override
+                    juce::SynthesiserSound*, int currentPitchWheelPosition) override
     {
         level = juce::jlimit (0.0f, 1.0f, velocity);
 
         const auto freq = (float) juce::MidiMessage::getMidiNoteInHertz (midiNoteNumber);
         const float sr = (float) getSampleRate();
-        const float delta = (sr > 0.0f ? (freq / sr) : 0.0f); // cycles/sample
+        noteDelta = (sr > 0.0f ? (freq / sr) : 0.0f); // cycles/sample
+        pitchBend = getPitchBendRatio (currentPitchWheelPosition);
 
         for (int i = 0; i < 4; ++i)
         {
             phase[i] = 0.0f;
-            phaseDelta[i] = delta;
+            phaseDelta[i] = noteDelta * pitchBend;
+            playFrames[i] = 0; // el playback empieza en play_start
         }
 
+        clearSyncCorrection();
+        osFactor = 0; // se elige en el primer bloque de la nota (tablas + pitch)
+
+        // Trayectoria XY propia de la voz: arranca con la nota
+        vectorEnvPos = 0.0f;
+        vectorLfoPhase = 0.0f;
+        advanceVector (0);
+
         updateADSR();
         adsr.noteOn();
     }
@@ -447,7 +146,16 @@ struct WavetableVoice : public juce::SynthesiserVoice
         }
     }
 
-    void pitchWheelMoved (int) override {}
+    void pitchWheelMoved (int newValue) override
+    {
+        pitchBend = getPitchBendRatio (newValue);
+
+        // Sin nota sonando solo se recuerda; el sobremuestreo se revisa en el siguiente bloque
+        if (phaseDelta[0] != 0.0f)
+            for (int i = 0; i < 4; ++i)
+                phaseDelta[i] = noteDelta * pitchBend;
+    }
+
     void controllerMoved (int, int) override {}
 
     void renderNextBlock (juce::AudioBuffer<float>& out, int startSample, int numSamples) override
@@ -463,123 +171,847 @@ struct WavetableVoice : public juce::SynthesiserVoice
         const float masterGain = (gainParam ? gainParam->load() : 0.8f);
         const float morph = (morphParam ? juce::jlimit (0.0f, 1.0f, morphParam->load()) : 0.0f);
 
+        // Playback: la posición de frame avanza en el tiempo (play_speed frames/s) entre
+        // play_start y play_end; wt_morph no se usa
+        const bool playback = (modeParam != nullptr && modeParam->load() >= 0.5f);
+        const bool loop = (playLoopParam == nullptr || playLoopParam->load() >= 0.5f);
+        const float sr = (float) getSampleRate();
+        const float frameDelta = (playback && playSpeedParam != nullptr && sr > 0.0f)
+                                   ? juce::jmax (0.0f, playSpeedParam->load()) / sr : 0.0f;
+
+        float playStart = (playStartParam ? juce::jlimit (0.0f, 1.0f, playStartParam->load()) : 0.0f);
+        float playEnd   = (playEndParam   ? juce::jlimit (0.0f, 1.0f, playEndParam->load())   : 1.0f);
+        if (playEnd < playStart)
+            std::swap (playStart, playEnd);
+
         float oscLevels[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
         for (int i = 0; i < 4; ++i)
             if (oscLevelParam[i] != nullptr)
                 oscLevels[i] = juce::jlimit (0.0f, 1.0f, oscLevelParam[i]->load());
 
+        // Modo vector: los niveles de los 4 slots salen del punto XY de la voz (por
+        // chunk, ver advanceVector), no de los knobs de nivel
+        const bool vector = (vectorModeParam != nullptr && vectorModeParam->load() >= 0.5f);
+        if (vector)
+            for (int i = 0; i < 4; ++i)
+                oscLevels[i] = vectorWeights[i];
+
+        // Hard sync: osc 2..4 (slaves) a sync_ratio veces el pitch del osc 1 (master),
+        // reiniciados en cada wrap del master
+        const float syncRatio = (syncRatioParam ? juce::jlimit (1.0f, 16.0f, syncRatioParam->load()) : 1.0f);
+        bool synced[4] = { false, false, false, false };
+        for (int i = 1; i < 4; ++i)
+            synced[i] = (syncParam[i] != nullptr && syncParam[i]->load() >= 0.5f);
+
         // Copy wavetables ONCE per block (no per-sample locks)
         std::array<BasicInstrumentAudioProcessor::Wavetable::Ptr, 4> wts;
         proc->getWtSlotsSnapshot (wts);
 
-        while (numSamples-- > 0)
+        // Resolver cada oscilador una vez por bloque: tabla, frames del morph, nivel
+        kernels::Args args;
+        int oscMask = 0;
+        int syncMask = 0; // slaves activos
+        bool morphing = false; // algún osc activo mezcla dos frames distintos
+        const BasicInstrumentAudioProcessor::Wavetable* tables[4] = { nullptr, nullptr, nullptr, nullptr };
+        float topCycles[4] = { 0, 0, 0, 0 }; // armónico más alto en ciclos/sample
+
+        for (int k = 0; k < 4; ++k)
         {
-            const float env = adsr.getNextSample();
+            const BasicInstrumentAudioProcessor::Wavetable* wt = nullptr;
+            const float delta = synced[k] ? phaseDelta[0] * syncRatio : phaseDelta[k];
+
+            if (wts[(size_t) k] != nullptr && wts[(size_t) k]->tableSize > 0 && wts[(size_t) k]->frames > 0)
+            {
+                wt = wts[(size_t) k].get();
+            }
+            else
+            {
+                // Slots vacíos: forma built-in band-limited (mip según el pitch de la voz)
+                const int shape = (oscShapeParam[k] != nullptr ? (int) oscShapeParam[k]->load() : 0);
+                wt = &builtin::get ((builtin::Shape) shape, builtin::getMipLevelForDelta (delta));
+            }
+
+            tables[k] = wt;
+
+            // Tablas cargadas: nivel de la mip chain dispersa (cada frame lo resuelve a
+            // su mip o, si ya cabe, a sí mismo)
+            mipLevel[k] = wt->getMipLevelForDelta (delta);
+
+            auto& o = args.osc[(size_t) k];
+            o.phase = phase[k];
+            o.delta = delta;
+            o.level = oscLevels[k];
+
+            const int F = wt->frames;
+
+            if (playback)
+            {
+                beginPlayback (k, *wt, playStart, playEnd);
+                setPlaybackFrames (k, o, *wt, frameDelta, loop);
 
-            float mix = 0.0f;
-            for (int k = 0; k < 4; ++k)
+                // Los frames cambian dentro del bloque: el más brillante de la tabla
+                topCycles[k] = (float) getBandwidth (*wt, -1, -1, mipLevel[k]) * delta;
+            }
+            else
             {
-                const float lvl = oscLevels[k];
-                if (lvl <= 0.0001f)
+                const float framePos = morph * (float) (F - 1);
+                const int a = juce::jlimit (0, F - 1, (int) framePos);
+                const int b = juce::jmin (a + 1, F - 1);
+
+                setFrames (o, *wt, a, b, mipLevel[k]);
+                o.frameMix = framePos - (float) a;
+                o.mixDelta = 0.0f;
+
+                // Sin mezcla real el frame b no hace falta
+                if (o.frameMix == 0.0f)
                 {
-                    phase[k] = phaseWrap (phase[k] + phaseDelta[k]);
-                    continue;
+                    o.frameB = o.frameA;
+                    o.maskB  = o.mask;
+                    o.sizeB  = o.size;
                 }
 
-                float s = 0.0f;
-                if (wts[(size_t) k] != nullptr && wts[(size_t) k]->tableSize > 0 && wts[(size_t) k]->frames > 0)
-                    s = sampleWavetable (*wts[(size_t) k], phase[k], morph);
-                else
-                    s = std::sin (phase[k] * juce::MathConstants<float>::twoPi);
+                topCycles[k] = (float) getBandwidth (*wt, a, b, mipLevel[k]) * delta;
+            }
+
+            // En modo vector los 4 slots suenan siempre (el peso cambia dentro del bloque)
+            if (vector || o.level > 0.0001f)
+            {
+                oscMask |= (1 << k);
 
-                mix += s * lvl;
-                phase[k] = phaseWrap (phase[k] + phaseDelta[k]);
+                if (synced[k])
+                    syncMask |= (1 << k);
+
+                // Frames internados: iguales => mismo puntero. En playback los frames
+                // cambian dentro del bloque
+                if (o.frameA != o.frameB || (playback && F > 1))
+                    morphing = true;
+            }
+        }
+
+        // Matriz PM: se evalúan los osc audibles y, en cadena, sus moduladores
+        int runMask = oscMask;
+        bool pmActive = false;
+
+        for (int pass = 0; pass < 4; ++pass)
+        {
+            for (int m = 0; m < 4; ++m)
+            {
+                for (int c = 0; c < 4; ++c)
+                {
+                    const float amount = (pmParam[m][c] != nullptr ? pmParam[m][c]->load() : 0.0f);
+                    pm.amount[(size_t) m][(size_t) c] = amount;
+
+                    if (amount > 0.0001f && (runMask & (1 << c)) != 0)
+                    {
+                        runMask |= (1 << m);
+                        pmActive = true;
+                    }
+                }
             }
+        }
+
+        // Sobremuestreo de la voz: el mínimo que deja sin aliasing el armónico más alto
+        // de los frames en uso a este pitch (el PM pide además pm_oversampling). Se elige
+        // en el primer bloque de la nota y después solo sube: la latencia del decimador
+        // no puede ir y venir a mitad de nota
+        int wanted = 1;
+        for (int k = 0; k < 4; ++k)
+            if ((runMask & (1 << k)) != 0)
+                wanted = juce::jmax (wanted, getOversamplingFor (topCycles[k]));
+
+        if (pmActive)
+            wanted = juce::jmax (wanted, (pmOversamplingParam != nullptr && pmOversamplingParam->load() >= 0.5f) ? 4 : 2);
+
+        if (wanted > osFactor)
+        {
+            pm.reset();
+            osFactor = wanted;
+        }
+
+        pm.runMask  = runMask;
+        pm.syncMask = syncMask;
+        args.pm = &pm;
 
-            const float s = mix * (level * env * masterGain);
+        const auto interp = (interpParam != nullptr && interpParam->load() >= 0.5f) ? kernels::Interp::cubic
+                                                                                    : kernels::Interp::linear;
+        const int numCh = out.getNumChannels();
+        if (numCh <= 0)
+            return;
+
+        // 1x: kernel a la tasa del host. Sobremuestreada: kernel normal (mono) + decimación,
+        // o el kernel PM si hay PM o sync (resuelve el sync a la tasa sobremuestreada)
+        const bool usePm = osFactor > 1 && (pmActive || syncMask != 0);
+        const bool oversampled = osFactor > 1 && ! usePm;
+        const bool stereoKernel = numCh > 1 && ! oversampled;
+        const auto render = usePm  ? kernels::selectPm (interp, numCh > 1, osFactor)
+                          : vector ? kernels::selectVector (interp, stereoKernel, morphing)
+                                   : kernels::select (oscMask, interp, stereoKernel, morphing);
+        const int activeMask = usePm ? runMask : oscMask;
+        const bool splitAtWrap = syncMask != 0 && osFactor == 1;
+
+        auto* outL = out.getWritePointer (0, startSample);
+        auto* outR = numCh > 1 ? out.getWritePointer (1, startSample) : nullptr;
+
+        const float voiceGain = level * masterGain;
+        float gain[kernels::maxChunk];
+        bool finished = false;
+
+        while (numSamples > 0 && ! finished)
+        {
+            // Envolvente por chunk (ADSR fuera del kernel: el loop de osciladores queda sin branches)
+            const int chunk = juce::jmin (numSamples, kernels::maxChunk);
+            int count = chunk;
 
-            for (int ch = 0; ch < out.getNumChannels(); ++ch)
-                out.addSample (ch, startSample, s);
+            for (int j = 0; j < chunk; ++j)
+            {
+                gain[j] = adsr.getNextSample() * voiceGain;
 
-            ++startSample;
+                if (! adsr.isActive())
+                {
+                    count = j + 1;
+                    finished = true;
+                    break;
+                }
+            }
 
-            if (! adsr.isActive())
+            // Pesos XY: rampa lineal desde los del final del chunk anterior (el kernel PM
+            // usa el del inicio del chunk)
+            if (vector)
             {
-                clearCurrentNote();
-                for (int i = 0; i < 4; ++i)
-                    phaseDelta[i] = 0.0f;
-                break;
+                float from[4];
+                std::copy (std::begin (vectorWeights), std::end (vectorWeights), from);
+                advanceVector (count);
+
+                for (int k = 0; k < 4; ++k)
+                {
+                    auto& o = args.osc[(size_t) k];
+                    o.level      = from[k];
+                    o.levelDelta = (vectorWeights[k] - from[k]) / (float) count;
+                }
+            }
+
+            if (! playback && ! splitAtWrap)
+            {
+                renderRun (render, oversampled, args, gain, outL, outR, count);
+            }
+            else
+            {
+                // Tramos sin cambio de frame ni wrap del master: frameMix avanza por sample
+                // dentro del kernel y los frames solo se vuelven a resolver al cruzar una
+                // fila (o el loop); el sync solo se aplica en el límite de un tramo
+                for (int done = 0; done < count;)
+                {
+                    int run = count - done;
+
+                    if (playback)
+                        for (int k = 0; k < 4; ++k)
+                            if ((activeMask & (1 << k)) != 0)
+                                run = juce::jmin (run, samplesToFrameBoundary (k, frameDelta, loop));
+
+                    const int toWrap = splitAtWrap ? samplesToMasterWrap (args.osc[0])
+                                                   : std::numeric_limits<int>::max();
+                    run = juce::jmin (run, toWrap);
+
+                    const float masterPhase = args.osc[0].phase;
+                    renderRun (render, oversampled, args, gain + done, outL + done,
+                               outR != nullptr ? outR + done : nullptr, run);
+                    done += run;
+
+                    if (playback)
+                    {
+                        for (int k = 0; k < 4; ++k)
+                        {
+                            advancePlayback (k, run, frameDelta, loop);
+                            setPlaybackFrames (k, args.osc[(size_t) k], *tables[k], frameDelta, loop);
+                        }
+                    }
+
+                    if (run == toWrap)
+                        hardSync (args, interp, syncMask, masterPhase, run, done);
+                }
             }
+
+            // Corrección minBLEP pendiente: solo los samples tras un reset
+            applySyncCorrection (gain, outL, outR, count);
+
+            outL += count;
+            if (outR != nullptr)
+                outR += count;
+
+            numSamples -= count;
+        }
+
+        for (int k = 0; k < 4; ++k)
+            phase[k] = args.osc[(size_t) k].phase;
+
+        if (finished)
+        {
+            clearCurrentNote();
+            clearSyncCorrection();
+            for (int i = 0; i < 4; ++i)
+                phaseDelta[i] = 0.0f;
         }
     }
 
 private:
-    static inline float phaseWrap (float x)
-    {
-        x -= std::floor (x);
-        return x;
-    }
+    //==============================================================================
+    static constexpr float pitchBendSemitones = 2.0f;
 
-    static float sampleWavetable (const BasicInstrumentAudioProcessor::Wavetable& wt,
-                                  float phase01,
-                                  float morph)
+    static float getPitchBendRatio (int wheel) noexcept
     {
-        const int N = wt.tableSize;
-        const int F = wt.frames;
-        if (N <= 1 || F <= 0)
-            return 0.0f;
-
-        const float framePos = morph * (float) (F - 1);
-        const int a = (int) std::floor (framePos);
-        const int b = juce::jmin (a + 1, F - 1);
-        const float tf = framePos - (float) a;
+        const float semitones = (float) (wheel - 8192) / 8192.0f * pitchBendSemitones;
+        return std::pow (2.0f, semitones / 12.0f);
+    }
 
-        const float idx = phase01 * (float) N;
-        const int i0 = (int) std::floor (idx) % N;
-        const int i1 = (i0 + 1) % N;
-        const float sf = idx - (float) std::floor (idx);
+    //==============================================================================
+    // Mips de las tablas cargadas y sobremuestreo automático
+    using Wavetable = BasicInstrumentAudioProcessor::Wavetable;
 
-        const auto* pa = wt.table.getReadPointer (a);
-        const auto* pb = wt.table.getReadPointer (b);
+    // Armónico más alto de los frames a y b (a < 0: de toda la tabla) tal como se leen
+    // al nivel de mip dado
+    static int getBandwidth (const Wavetable& wt, int a, int b, int level) noexcept
+    {
+        if (wt.frameBandwidth.empty())
+            return wt.tableSize / 2; // sin medir: lo peor
 
-        const float sa = juce::jmap (sf, pa[i0], pa[i1]);
-        const float sb = juce::jmap (sf, pb[i0], pb[i1]);
-        return juce::jmap (tf, sa, sb);
+        const int measured = a < 0 ? wt.maxBandwidth
+                                   : juce::jmax (wt.frameBandwidth[(size_t) a], wt.frameBandwidth[(size_t) b]);
+        return juce::jmin (measured, wt.getMipBandwidth (level));
     }
 
-    void updateADSR()
+    // Frames a y b al nivel de mip (pueden quedar de tamaños distintos)
+    static void setFrames (kernels::Osc& o, const Wavetable& wt, int a, int b, int level) noexcept
     {
-        if (apvts == nullptr) return;
+        int sizeA = 0, sizeB = 0;
+        o.frameA = wt.getMipFrame (a, level, sizeA);
+        o.frameB = wt.getMipFrame (b, level, sizeB);
+        o.mask   = sizeA - 1;
+        o.size   = (float) sizeA;
+        o.maskB  = sizeB - 1;
+        o.sizeB  = (float) sizeB;
+    }
 
-        juce::ADSR::Parameters p;
-        p.attack  = (attackParam  ? attackParam->load()  : 0.01f);
-        p.decay   = (decayParam   ? decayParam->load()   : 0.10f);
-        p.sustain = (sustainParam ? sustainParam->load() : 0.80f);
-        p.release = (releaseParam ? releaseParam->load() : 0.20f);
-        adsr.setParameters (p);
+    // top: armónico más alto en ciclos/sample del host. A 1x no puede pasar de Nyquist;
+    // a 2x/4x lo que se pliega en la tasa sobremuestreada tiene que caer por encima de
+    // 0.6 (banda que quitan los half-band): hasta 1.4 con 2x y 3.4 con 4x
+    static int getOversamplingFor (float top) noexcept
+    {
+        if (top <= 0.5f) return 1;
+        if (top <= 1.4f) return 2;
+        return 4;
     }
 
-    BasicInstrumentAudioProcessor* proc = nullptr;
-    juce::AudioProcessorValueTreeState* apvts = nullptr;
+    //==============================================================================
+    // Modo vector. Posición XY de la voz: de la esquina del osc 1 (0, 0) al punto
+    // (vector_x, vector_y) en vector_env segundos, más una órbita circular del LFO de
+    // radio vector_lfo_depth / 2. Pesos bilineales: osc1 (0, 0), osc2 (1, 0),
+    // osc3 (0, 1), osc4 (1, 1); suman siempre 1
+    void advanceVector (int numSamples) noexcept
+    {
+        const float sr = (float) getSampleRate();
+        const float envTime = (vectorEnvParam != nullptr ? vectorEnvParam->load() : 0.0f);
+        const float rate    = (vectorLfoRateParam != nullptr ? vectorLfoRateParam->load() : 0.0f);
+        const float depth   = (vectorLfoDepthParam != nullptr ? vectorLfoDepthParam->load() : 0.0f);
 
-    std::atomic<float>* gainParam    = nullptr;
-    std::atomic<float>* attackParam  = nullptr;
-    std::atomic<float>* decayParam   = nullptr;
-    std::atomic<float>* sustainParam = nullptr;
-    std::atomic<float>* releaseParam = nullptr;
+        if (sr <= 0.0f || envTime <= 0.0f)
+            vectorEnvPos = 1.0f;
+        else
+            vectorEnvPos = juce::jmin (1.0f, vectorEnvPos + (float) numSamples / (envTime * sr));
 
-    std::atomic<float>* morphParam = nullptr;
-    std::atomic<float>* oscLevelParam[4] = { nullptr, nullptr, nullptr, nullptr };
+        if (sr > 0.0f)
+            vectorLfoPhase = kernels::frac (vectorLfoPhase + (float) numSamples * rate / sr);
 
-    juce::ADSR adsr;
+        const float angle = juce::MathConstants<float>::twoPi * vectorLfoPhase;
+        const float radius = 0.5f * depth;
 
-    float phase[4]      = { 0, 0, 0, 0 };
-    float phaseDelta[4] = { 0, 0, 0, 0 };
-    float level         = 0.0f;
-};
+        const float x0 = (vectorXParam != nullptr ? vectorXParam->load() : 0.5f);
+        const float y0 = (vectorYParam != nullptr ? vectorYParam->load() : 0.5f);
+        const float x = juce::jlimit (0.0f, 1.0f, x0 * vectorEnvPos + radius * std::cos (angle));
+        const float y = juce::jlimit (0.0f, 1.0f, y0 * vectorEnvPos + radius * std::sin (angle));
 
-//==============================================================================
-// Parameters
+        vectorWeights[0] = (1.0f - x) * (1.0f - y);
+        vectorWeights[1] = x * (1.0f - y);
+        vectorWeights[2] = (1.0f - x) * y;
+        vectorWeights[3] = x * y;
+    }
+
+    void renderRun (kernels::RenderFn render, bool oversampled, kernels::Args& args,
+                    const float* gain, float* outL, float* outR, int n) noexcept
+    {
+        if (oversampled)
+            kernels::renderOversampled (render, osFactor, args, gain, outL, outR, n);
+        else
+            render (args, gain, outL, outR, n);
+    }
+
+    //==============================================================================
+    // Hard sync. El wrap del master cae entre dos samples; el tramo se corta justo
+    // después, de modo que solo hace falta reajustar las fases aquí y no en el kernel
+    static int samplesToMasterWrap (const kernels::Osc& master) noexcept
+    {
+        if (master.delta <= 0.0f)
+            return std::numeric_limits<int>::max();
+
+        return juce::jmax (1, (int) std::ceil ((1.0f - master.phase) / master.delta));
+    }
+
+    // pos: primer sample (relativo al chunk) después del wrap. Cada slave vuelve a fase 0
+    // en el instante exacto del wrap; su salto se corrige con el residual minBLEP desde pos.
+    // El salto se mide con la misma interpolación que usa el kernel (wt_interp)
+    void hardSync (kernels::Args& args, kernels::Interp interp, int syncMask, float masterPhase, int run, int pos) noexcept
+    {
+        auto& master = args.osc[0];
+        const float past  = juce::jlimit (0.0f, master.delta, masterPhase + (float) run * master.delta - 1.0f);
+        const float since = past / master.delta; // samples entre el wrap y pos, [0, 1]
+        master.phase = past;
+
+        for (int k = 1; k < 4; ++k)
+        {
+            if ((syncMask & (1 << k)) == 0)
+                continue;
+
+            auto& o = args.osc[(size_t) k];
+
+            // Fase del slave en el instante del wrap: la que traía en pos, 'since' samples atrás
+            const float atWrap = kernels::frac (o.phase + 1.0f - std::fmod (since * o.delta, 1.0f));
+            const auto read = [&o, interp] (float phase01)
+            {
+                return interp == kernels::Interp::cubic ? kernels::readMorph<kernels::Interp::cubic, true> (o, phase01, o.frameMix)
+                                                        : kernels::readMorph<kernels::Interp::linear, true> (o, phase01, o.frameMix);
+            };
+            const float before = read (atWrap);
+            const float after  = read (0.0f);
+
+            o.phase = kernels::frac (since * o.delta);
+
+            builtin::addBlepResidual (syncCorrection + pos, since, (after - before) * o.level);
+            syncPending = juce::jmax (syncPending, pos + builtin::blepTaps);
+        }
+    }
+
+    // Suma la corrección a los samples del chunk (antes del gain, como el kernel) y
+    // desplaza lo que cae en el chunk siguiente
+    void applySyncCorrection (const float* gain, float* outL, float* outR, int count) noexcept
+    {
+        if (syncPending == 0)
+            return;
+
+        const int n = juce::jmin (count, syncPending);
+        for (int j = 0; j < n; ++j)
+        {
+            const float s = syncCorrection[j] * gain[j];
+            outL[j] += s;
+
+            if (outR != nullptr)
+                outR[j] += s;
+        }
+
+        const int rest = syncPending - n;
+        std::memmove (syncCorrection, syncCorrection + n, (size_t) rest * sizeof (float));
+        std::fill (syncCorrection + rest, syncCorrection + syncPending, 0.0f);
+        syncPending = rest;
+    }
+
+    void clearSyncCorrection() noexcept
+    {
+        std::fill (syncCorrection, syncCorrection + syncPending, 0.0f);
+        syncPending = 0;
+    }
+
+    //==============================================================================
+    // Playback por osc: posición en frames de su propia tabla, rango [playLo, playHi]
+    void beginPlayback (int k, const BasicInstrumentAudioProcessor::Wavetable& wt, float start, float end)
+    {
+        const int F = wt.frames;
+        const float lo = start * (float) (F - 1);
+        const float hi = end * (float) (F - 1);
+
+        // Nota nueva: desde el inicio. Otra tabla en el slot: misma posición relativa
+        if (playFrames[k] != F)
+        {
+            framePos[k] = (playFrames[k] > 1 && F > 1) ? framePos[k] / (float) (playFrames[k] - 1) * (float) (F - 1)
+                                                       : lo;
+            playFrames[k] = F;
+        }
+
+        framePos[k] = juce::jlimit (lo, hi, framePos[k]);
+        playLo[k] = lo;
+        playHi[k] = hi;
+    }
+
+    bool isPlaybackMoving (int k, float frameDelta, bool loop) const noexcept
+    {
+        if (frameDelta <= 0.0f)
+            return false;
+
+        // Sin loop se queda quieta en el final
+        return loop ? playHi[k] > playLo[k] : framePos[k] < playHi[k];
+    }
+
+    void setPlaybackFrames (int k, kernels::Osc& o, const BasicInstrumentAudioProcessor::Wavetable& wt,
+                            float frameDelta, bool loop) const noexcept
+    {
+        const int F = wt.frames;
+        const float pos = framePos[k];
+        const int a = juce::jlimit (0, F - 1, (int) pos);
+        const int b = juce::jmin (a + 1, F - 1);
+        const bool moving = isPlaybackMoving (k, frameDelta, loop);
+
+        setFrames (o, wt, a, b, mipLevel[k]);
+        o.frameMix = b > a ? pos - (float) a : 0.0f;
+        o.mixDelta = (b > a && moving) ? frameDelta : 0.0f;
+
+        // La fila que entra al cruzar el siguiente frame
+        if (moving && b + 1 < F)
+        {
+            int size = 0;
+            const float* next = wt.getMipFrame (b + 1, mipLevel[k], size);
+            kernels::prefetchRow (next, size);
+        }
+    }
+
+    // Samples hasta el siguiente frame entero (o el final del rango)
+    int samplesToFrameBoundary (int k, float frameDelta, bool loop) const noexcept
+    {
+        if (! isPlaybackMoving (k, frameDelta, loop))
+            return std::numeric_limits<int>::max();
+
+        const float pos = framePos[k];
+        const float next = juce::jmin (std::floor (pos) + 1.0f, playHi[k]);
+
+        // En el final con loop: un sample y vuelve a playLo
+        if (next <= pos)
+            return 1;
+
+        return juce::jmax (1, (int) std::ceil ((next - pos) / frameDelta));
+    }
+
+    void advancePlayback (int k, int numSamples, float frameDelta, bool loop) noexcept
+    {
+        if (! isPlaybackMoving (k, frameDelta, loop))
+            return;
+
+        float pos = framePos[k] + (float) numSamples * frameDelta;
+        const float lo = playLo[k];
+        const float hi = playHi[k];
+
+        if (pos >= hi)
+            pos = loop ? lo + std::fmod (pos - lo, hi - lo) : hi;
+
+        framePos[k] = pos;
+    }
+
+    void updateADSR()
+    {
+        if (apvts == nullptr) return;
+
+        juce::ADSR::Parameters p;
+        p.attack  = (attackParam  ? attackParam->load()  : 0.01f);
+        p.decay   = (decayParam   ? decayParam->load()   : 0.10f);
+        p.sustain = (sustainParam ? sustainParam->load() : 0.80f);
+        p.release = (releaseParam ? releaseParam->load() : 0.20f);
+        adsr.setParameters (p);
+    }
+
+    BasicInstrumentAudioProcessor* proc = nullptr;
+    juce::AudioProcessorValueTreeState* apvts = nullptr;
+
+    std::atomic<float>* gainParam    = nullptr;
+    std::atomic<float>* attackParam  = nullptr;
+    std::atomic<float>* decayParam   = nullptr;
+    std::atomic<float>* sustainParam = nullptr;
+    std::atomic<float>* releaseParam = nullptr;
+
+    std::atomic<float>* morphParam = nullptr;
+    std::atomic<float>* oscLevelParam[4] = { nullptr, nullptr, nullptr, nullptr };
+    std::atomic<float>* oscShapeParam[4] = { nullptr, nullptr, nullptr, nullptr };
+    std::atomic<float>* interpParam = nullptr;
+
+    std::atomic<float>* modeParam      = nullptr;
+    std::atomic<float>* playSpeedParam = nullptr;
+    std::atomic<float>* playStartParam = nullptr;
+    std::atomic<float>* playEndParam   = nullptr;
+    std::atomic<float>* playLoopParam  = nullptr;
+
+    std::atomic<float>* syncParam[4] = { nullptr, nullptr, nullptr, nullptr }; // [0]: master, sin sync
+    std::atomic<float>* syncRatioParam = nullptr;
+
+    std::atomic<float>* pmParam[4][4] = {}; // [modulador][portadora]
+    std::atomic<float>* pmOversamplingParam = nullptr;
+
+    std::atomic<float>* vectorModeParam     = nullptr;
+    std::atomic<float>* vectorXParam        = nullptr;
+    std::atomic<float>* vectorYParam        = nullptr;
+    std::atomic<float>* vectorEnvParam      = nullptr;
+    std::atomic<float>* vectorLfoRateParam  = nullptr;
+    std::atomic<float>* vectorLfoDepthParam = nullptr;
+
+    juce::ADSR adsr;
+
+    float phase[4]      = { 0, 0, 0, 0 };
+    float phaseDelta[4] = { 0, 0, 0, 0 };
+    float level         = 0.0f;
+    float noteDelta     = 0.0f; // sin pitch bend
+    float pitchBend     = 1.0f;
+    int   mipLevel[4]   = { 0, 0, 0, 0 }; // nivel de mip del bloque actual, por osc
+
+    // Playback (frames de cada tabla)
+    float framePos[4]   = { 0, 0, 0, 0 };
+    float playLo[4]     = { 0, 0, 0, 0 };
+    float playHi[4]     = { 0, 0, 0, 0 };
+    int   playFrames[4] = { 0, 0, 0, 0 }; // frames de la tabla al avanzar (0 = nota nueva)
+
+    // Hard sync: corrección pendiente desde el inicio del chunk actual; [syncPending, end) == 0
+    float syncCorrection[kernels::maxChunk + builtin::blepTaps] = {};
+    int   syncPending = 0;
+
+    // Caminos sobremuestreados (PM o automático): decimadores por voz. osFactor 1 = a
+    // la tasa del host; 0 = nota nueva, aún sin elegir
+    kernels::PmState pm;
+    int osFactor = 0;
+
+    // Modo vector: trayectoria XY de la voz y pesos de los 4 slots al final del último chunk
+    float vectorEnvPos   = 0.0f; // 0 = esquina del osc 1, 1 = punto XY
+    float vectorLfoPhase = 0.0f;
+    float vectorWeights[4] = { 1, 0, 0, 0 };
+};
+
+//==============================================================================
+// Synthesiser con drive por voz. Con drive 0 es el Synthesiser de siempre (las voces
+// suman directamente en la salida); si no, cada voz se renderiza en mono en su
+// lane y el waveshaper procesa todas las lanes a la vez antes de sumarlas.
+struct BasicInstrumentAudioProcessor::VoiceSynth : public juce::Synthesiser
+{
+    void setDriveParameter (std::atomic<float>* p) { driveParam = p; }
+
+protected:
+    void renderVoices (juce::AudioBuffer<float>& out, int startSample, int numSamples) override
+    {
+        const float drive = (driveParam != nullptr ? driveParam->load() : 0.0f);
+        const int numVoices = getNumVoices();
+
+        if (drive <= 0.0f || numVoices > shaper::numLanes)
+        {
+            bypassed = true;
+            juce::Synthesiser::renderVoices (out, startSample, numSamples);
+            return;
+        }
+
+        // Al salir del bypass el estado ADAA es de otro momento
+        if (bypassed)
+        {
+            state = {};
+            bypassed = false;
+        }
+
+        const float gain = shaper::getDriveGain (drive);
+        const float mix = shaper::getDriveMix (drive);
+        const int numCh = out.getNumChannels();
+
+        while (numSamples > 0)
+        {
+            const int n = juce::jmin (numSamples, maxFrames);
+
+            for (int v = 0; v < shaper::numLanes; ++v)
+            {
+                float* lane = voiceLanes[v];
+                std::fill (lane, lane + n, 0.0f);
+
+                if (v < numVoices)
+                {
+                    juce::AudioBuffer<float> view (&lane, 1, n);
+                    getVoice (v)->renderNextBlock (view, 0, n);
+                }
+            }
+
+            // [voz][sample] -> [sample][voz]
+            for (int j = 0; j < n; ++j)
+                for (int v = 0; v < shaper::numLanes; ++v)
+                    interleaved[j * shaper::numLanes + v] = voiceLanes[v][j];
+
+            shaper::process (interleaved, n, gain, mix, state);
+
+            for (int j = 0; j < n; ++j)
+            {
+                const float* frame = interleaved + j * shaper::numLanes;
+                float s = 0.0f;
+                for (int v = 0; v < shaper::numLanes; ++v)
+                    s += frame[v];
+
+                for (int ch = 0; ch < numCh; ++ch)
+                    out.getWritePointer (ch)[startSample + j] += s;
+            }
+
+            startSample += n;
+            numSamples -= n;
+        }
+    }
+
+private:
+    static constexpr int maxFrames = 256;
+
+    float voiceLanes[shaper::numLanes][maxFrames] = {};
+    float interleaved[shaper::numLanes * maxFrames] = {};
+
+    shaper::State state;
+    bool bypassed = true;
+    std::atomic<float>* driveParam = nullptr;
+};
+
+//==============================================================================
+// Memory accounting helpers
+namespace
+{
+    // Registro process-wide de instancias vivas (para getProcessMemoryStats)
+    struct InstanceRegistry
+    {
+        juce::CriticalSection lock;
+        juce::Array<BasicInstrumentAudioProcessor*> instances;
+    };
+
+    static InstanceRegistry& getInstanceRegistry()
+    {
+        static InstanceRegistry registry;
+        return registry;
+    }
+}
+
+// Acumula stats contando una sola vez cada objeto compartido y marcando
+// como duplicado el contenido idéntico retenido en más de un sitio.
+struct BasicInstrumentAudioProcessor::MemoryCollector
+{
+    MemoryStats stats;
+    std::set<const Wavetable*> seenTables;
+    std::set<const Wavetable::SharedFrame*> seenFrames;
+    size_t frameBytes = 0; // frames del FrameStore alcanzables desde las tablas vistas
+    std::set<const WtSource*>  seenSources;
+    std::set<juce::uint64> seenTableHashes;  // Wavetable::contentHash
+    std::set<juce::uint64> seenSourceHashes; // WtSource::contentHash (otro dominio)
+    std::set<juce::int64>  seenStringHashes;
+
+    void addWavetable (const Wavetable& wt)
+    {
+        if (! seenTables.insert (&wt).second)
+            return;
+
+        const auto bytes = wt.getMemoryBytes();
+        stats.wavetableBytes += bytes;
+        ++stats.wavetables;
+
+        if (! seenTableHashes.insert (wt.contentHash).second)
+            stats.duplicateBytes += bytes;
+
+        // Frames y mips del FrameStore: una vez aunque los compartan varias tablas
+        for (auto* frames : { &wt.sharedFrames, &wt.mipFrames })
+        {
+            for (auto& frame : *frames)
+            {
+                if (frame != nullptr && seenFrames.insert (frame.get()).second)
+                {
+                    stats.wavetableBytes += frame->getMemoryBytes();
+                    frameBytes += frame->getMemoryBytes();
+                }
+            }
+        }
+    }
+
+    void addSource (const WtSource& src)
+    {
+        if (! seenSources.insert (&src).second)
+            return;
+
+        const auto bytes = src.getMemoryBytes();
+        stats.sourceBytes += bytes;
+
+        if (! seenSourceHashes.insert (src.contentHash).second)
+            stats.duplicateBytes += bytes;
+    }
+
+    void addStateTree (const juce::ValueTree& vt)
+    {
+        for (int i = 0; i < vt.getNumProperties(); ++i)
+        {
+            const auto& v = vt.getProperty (vt.getPropertyName (i));
+            if (! v.isString())
+                continue;
+
+            const auto s = v.toString();
+            const auto bytes = s.getNumBytesAsUTF8();
+            stats.stateBytes += bytes;
+            noteString (s, bytes);
+        }
+
+        for (const auto& child : vt)
+            addStateTree (child);
+    }
+
+private:
+    // Solo strings grandes (JSON embebido); los nombres cortos no cuentan como duplicados
+    void noteString (const juce::String& s, size_t bytes)
+    {
+        if (bytes < 256)
+            return;
+
+        if (! seenStringHashes.insert (s.hashCode64()).second)
+            stats.duplicateBytes += bytes;
+    }
+};
+
+void BasicInstrumentAudioProcessor::collectMemory (MemoryCollector& c) const
+{
+    std::array<Wavetable::Ptr, 4> slots;
+    std::array<WtSource::Ptr, 4> sources;
+    {
+        const juce::SpinLock::ScopedLockType sl (wtLock);
+        slots = wtSlots;
+        sources = wtSlotSource;
+    }
+
+    for (auto& wt : slots)
+        if (wt != nullptr)
+            c.addWavetable (*wt);
+
+    for (auto& src : sources)
+        if (src != nullptr)
+            c.addSource (*src);
+
+    // Programas residentes del banco (las tablas compartidas con los slots, una vez)
+    for (auto& wt : programBank->getResidentTables())
+        c.addWavetable (*wt);
+
+    c.addStateTree (apvts.state);
+    c.stats.voiceBytes += (size_t) synth->getNumVoices() * sizeof (WavetableVoice);
+    ++c.stats.instances;
+}
+
+BasicInstrumentAudioProcessor::MemoryStats BasicInstrumentAudioProcessor::getMemoryStats() const
+{
+    MemoryCollector c;
+    collectMemory (c);
+    return c.stats;
+}
+
+BasicInstrumentAudioProcessor::MemoryStats BasicInstrumentAudioProcessor::getProcessMemoryStats()
+{
+    MemoryCollector c;
+
+    auto& reg = getInstanceRegistry();
+    const juce::ScopedLock sl (reg.lock);
+    for (auto* p : reg.instances)
+        p->collectMemory (c);
+
+    // Factory set y tablas del drive compartidos: una sola copia por proceso
+    c.stats.cacheBytes += builtin::getMemoryBytes() + shaper::getMemoryBytes();
+
+    // FrameStore: lo que no cuelga de ninguna tabla viva (pendiente de purga)
+    const auto store = framestore::getStats();
+    c.stats.cacheBytes += store.bytes > c.frameBytes ? store.bytes - c.frameBytes : 0;
+
+    return c.stats;
+}
+
+//==============================================================================
+// Parameters
 juce::AudioProcessorValueTreeState::ParameterLayout
 BasicInstrumentAudioProcessor::createParameterLayout()
 {
@@ -644,96 +1076,824 @@ BasicInstrumentAudioProcessor::createParameterLayout()
         0.0f
     ));
 
-    return { params.begin(), params.end() };
+    params.push_back (std::make_unique<juce::AudioParameterChoice>(
+        "wt_interp", "WT Interp",
+        juce::StringArray { "Linear", "Cubic" },
+        0
+    ));
+
+    // Playback: los frames del framepack como serie temporal (resíntesis)
+    params.push_back (std::make_unique<juce::AudioParameterChoice>(
+        "wt_mode", "WT Mode",
+        juce::StringArray { "Morph", "Playback" },
+        0
+    ));
+
+    params.push_back (std::make_unique<P>(
+        "play_speed", "Play Speed",
+        juce::NormalisableRange<float> (0.1f, 500.0f, 0.01f, 0.3f),
+        24.0f // frames/s
+    ));
+
+    params.push_back (std::make_unique<P>(
+        "play_start", "Play Start",
+        juce::NormalisableRange<float> (0.0f, 1.0f, 0.0001f),
+        0.0f
+    ));
+
+    params.push_back (std::make_unique<P>(
+        "play_end", "Play End",
+        juce::NormalisableRange<float> (0.0f, 1.0f, 0.0001f),
+        1.0f
+    ));
+
+    params.push_back (std::make_unique<juce::AudioParameterBool>(
+        "play_loop", "Play Loop",
+        true
+    ));
+
+    // Drive por voz (tanh con ADAA); 0 = sin waveshaper
+    params.push_back (std::make_unique<P>(
+        "drive", "Drive",
+        juce::NormalisableRange<float> (0.0f, 1.0f, 0.0001f),
+        0.0f
+    ));
+
+    // Hard sync de osc 2..4 al osc 1
+    for (int i = 2; i <= 4; ++i)
+    {
+        params.push_back (std::make_unique<juce::AudioParameterBool>(
+            "osc" + juce::String (i) + "_sync", "Osc" + juce::String (i) + " Sync",
+            false
+        ));
+    }
+
+    params.push_back (std::make_unique<P>(
+        "sync_ratio", "Sync Ratio",
+        juce::NormalisableRange<float> (1.0f, 16.0f, 0.001f, 0.4f),
+        2.0f // pitch del slave / pitch del master
+    ));
+
+    // Matriz PM: fase de la portadora c desplazada amount * salida del modulador m
+    // (ciclos); diagonal = feedback. Solo las voces que la usan se sobremuestrean
+    for (int m = 0; m < 4; ++m)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            params.push_back (std::make_unique<P>(
+                getPmParamId (m, c), "PM Osc" + juce::String (m + 1) + " > Osc" + juce::String (c + 1),
+                juce::NormalisableRange<float> (0.0f, 2.0f, 0.0001f, 0.5f),
+                0.0f
+            ));
+        }
+    }
+
+    params.push_back (std::make_unique<juce::AudioParameterChoice>(
+        "pm_oversampling", "PM Oversampling",
+        juce::StringArray { "2x", "4x" },
+        0
+    ));
+
+    // Modo vector: los 4 slots mezclados por un punto XY (esquinas osc1..osc4) que cada
+    // voz recorre desde la esquina del osc 1, con una órbita de LFO encima
+    params.push_back (std::make_unique<juce::AudioParameterBool>(
+        "vector_mode", "Vector Mode",
+        false
+    ));
+
+    params.push_back (std::make_unique<P>(
+        "vector_x", "Vector X",
+        juce::NormalisableRange<float> (0.0f, 1.0f, 0.0001f),
+        0.5f
+    ));
+
+    params.push_back (std::make_unique<P>(
+        "vector_y", "Vector Y",
+        juce::NormalisableRange<float> (0.0f, 1.0f, 0.0001f),
+        0.5f
+    ));
+
+    params.push_back (std::make_unique<P>(
+        "vector_env", "Vector Env",
+        juce::NormalisableRange<float> (0.0f, 10.0f, 0.001f, 0.4f),
+        0.0f // segundos hasta el punto XY; 0 = desde el inicio
+    ));
+
+    params.push_back (std::make_unique<P>(
+        "vector_lfo_rate", "Vector LFO Rate",
+        juce::NormalisableRange<float> (0.01f, 20.0f, 0.001f, 0.3f),
+        0.5f // Hz
+    ));
+
+    params.push_back (std::make_unique<P>(
+        "vector_lfo_depth", "Vector LFO Depth",
+        juce::NormalisableRange<float> (0.0f, 1.0f, 0.0001f),
+        0.0f
+    ));
+
+    // Forma built-in que suena cuando el slot no tiene wavetable cargada
+    for (int i = 1; i <= 4; ++i)
+    {
+        params.push_back (std::make_unique<juce::AudioParameterChoice>(
+            "osc" + juce::String (i) + "_shape", "Osc" + juce::String (i) + " Shape",
+            builtin::getShapeNames(),
+            0
+        ));
+    }
+
+    return { params.begin(), params.end() };
+}
+
+//==============================================================================
+// Processor
+BasicInstrumentAudioProcessor::BasicInstrumentAudioProcessor()
+: juce::AudioProcessor (BusesProperties().withOutput ("Output", juce::AudioChannelSet::stereo(), true))
+, apvts (*this, nullptr, "PARAMS", createParameterLayout())
+{
+    // Tablas built-in generadas aquí, nunca en el audio thread
+    builtin::prepare();
+    shaper::prepare();
+
+    synth = std::make_unique<VoiceSynth>();
+    synth->setDriveParameter (apvts.getRawParameterValue ("drive"));
+
+    // Una lane del drive por voz
+    constexpr int numVoices = shaper::numLanes;
+    for (int i = 0; i < numVoices; ++i)
+    {
+        auto* v = new WavetableVoice();
+        v->setParameters (apvts, *this);
+        synth->addVoice (v);
+    }
+    synth->addSound (new SineSound());
+
+    programBank = std::make_unique<programs::Bank> (*scheduler);
+
+    auto& reg = getInstanceRegistry();
+    const juce::ScopedLock sl (reg.lock);
+    reg.instances.add (this);
+}
+
+BasicInstrumentAudioProcessor::~BasicInstrumentAudioProcessor()
+{
+    stopTimer();
+    alive->store (false);
+
+    // Primero fuera del registro: getProcessMemoryStats no puede ver la instancia a medio destruir
+    {
+        auto& reg = getInstanceRegistry();
+        const juce::ScopedLock sl (reg.lock);
+        reg.instances.removeFirstMatchingValue (this);
+    }
+
+    // Decodes pendientes de esta instancia: fuera de la cola, y espera a los que corren
+    scheduler->cancel (this);
+    programBank.reset();
+
+    // Frames que solo usaba esta instancia
+    {
+        const juce::SpinLock::ScopedLockType sl (wtLock);
+        wtSlots = {};
+        wtSlotSource = {};
+        retiredSlots = {};
+        retiredSources = {};
+    }
+
+    framestore::purgeUnused();
+}
+
+const juce::String BasicInstrumentAudioProcessor::getName() const { return JucePlugin_Name; }
+bool BasicInstrumentAudioProcessor::acceptsMidi() const   { return true; }
+bool BasicInstrumentAudioProcessor::producesMidi() const  { return false; }
+bool BasicInstrumentAudioProcessor::isMidiEffect() const  { return false; }
+double BasicInstrumentAudioProcessor::getTailLengthSeconds() const { return 0.0; }
+
+int BasicInstrumentAudioProcessor::getNumPrograms()
+{
+    return juce::jmax (1, programBank->getNumPrograms());
+}
+
+int BasicInstrumentAudioProcessor::getCurrentProgram()
+{
+    const int requested = requestedProgram.load();
+    return requested >= 0 ? requested : currentProgram.load();
+}
+
+void BasicInstrumentAudioProcessor::setCurrentProgram (int index)
+{
+    if (! juce::isPositiveAndBelow (index, programBank->getNumPrograms()))
+        return;
+
+    // Residente: cambia ya; si no, queda pendiente (processBlock / timer)
+    requestedProgram = index;
+    if (trySwitchProgram (index))
+        requestedProgram.compare_exchange_strong (index, -1);
+}
+
+const juce::String BasicInstrumentAudioProcessor::getProgramName (int index)
+{
+    return programBank->getProgramName (index);
+}
+
+void BasicInstrumentAudioProcessor::changeProgramName (int, const juce::String&) {}
+
+void BasicInstrumentAudioProcessor::prepareToPlay (double sampleRate, int)
+{
+    synth->setCurrentPlaybackSampleRate (sampleRate);
+}
+
+void BasicInstrumentAudioProcessor::releaseResources()
+{
+    audioRunning = false;
+}
+
+bool BasicInstrumentAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+    const auto& out = layouts.getMainOutputChannelSet();
+    return (out == juce::AudioChannelSet::mono() || out == juce::AudioChannelSet::stereo());
+}
+
+void BasicInstrumentAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi)
+{
+    juce::ScopedNoDenormals noDenormals;
+    buffer.clear();
+
+    audioRunning.store (true, std::memory_order_relaxed);
+
+    // Render offline (bounce, freeze) con una restauración de sesión aún en el pool:
+    // se espera, como si se hubiera decodificado en setStateInformation
+    if (isNonRealtime() && restoresPending.load() > 0)
+        waitForSessionRestore();
+
+    // Program change: se aplica al inicio del bloque (el último del bloque gana)
+    for (const auto metadata : midi)
+    {
+        const auto msg = metadata.getMessage();
+        if (msg.isProgramChange() && msg.getProgramChangeNumber() < programBank->getNumPrograms())
+            requestedProgram = msg.getProgramChangeNumber();
+    }
+
+    int requested = requestedProgram.load();
+    if (requested >= 0 && trySwitchProgram (requested))
+        requestedProgram.compare_exchange_strong (requested, -1);
+
+    synth->renderNextBlock (buffer, midi, 0, buffer.getNumSamples());
+}
+
+//==============================================================================
+// Programas
+bool BasicInstrumentAudioProcessor::trySwitchProgram (int index)
+{
+    // El cambio anterior aún no se ha recogido en el message thread
+    if (retiredPending.load())
+        return false;
+
+    return programBank->withResident (index, [this, index] (const programs::Program& p)
+    {
+        const juce::SpinLock::ScopedTryLockType sl (wtLock);
+        if (! sl.isLocked())
+            return false;
+
+        // Otro hilo pudo cambiar de programa entre la comprobación de arriba y el lock:
+        // sus slots retirados aún no se han recogido
+        if (retiredPending.load())
+            return false;
+
+        // retired* están vacíos: copiar ahí solo suma referencias, y el swap deja los
+        // slots anteriores en retired* sin soltar nada en este hilo
+        for (size_t k = 0; k < 4; ++k)
+        {
+            ++wtSlotGeneration[k]; // una carga de fichero pendiente ya no publica
+
+            retiredSlots[k]   = p.tables[k];
+            retiredSources[k] = p.sources[k];
+            retiredNames[k]   = p.slotNames[k];
+
+            std::swap (wtSlots[k],      retiredSlots[k]);
+            std::swap (wtSlotSource[k], retiredSources[k]);
+            std::swap (wtSlotName[k],   retiredNames[k]);
+        }
+
+        currentProgram = index;
+        retiredPending = true;
+        return true;
+    });
+}
+
+void BasicInstrumentAudioProcessor::releaseRetiredSlots()
+{
+    if (! retiredPending.load())
+        return;
+
+    std::array<Wavetable::Ptr, 4> tables;
+    std::array<WtSource::Ptr, 4> sources;
+    std::array<juce::String, 4> names;
+    {
+        const juce::SpinLock::ScopedLockType sl (wtLock);
+        std::swap (tables, retiredSlots);
+        std::swap (sources, retiredSources);
+        std::swap (names, retiredNames);
+        retiredPending = false;
+    }
+
+    // Frames que solo usaban los slots retirados
+    tables = {};
+    sources = {};
+    framestore::purgeUnused();
+}
+
+void BasicInstrumentAudioProcessor::timerCallback()
+{
+    releaseRetiredSlots();
+
+    // Sin audio corriendo (host parado, render offline) el cambio pendiente se hace aquí
+    int requested = requestedProgram.load();
+    if (requested >= 0 && trySwitchProgram (requested))
+        requestedProgram.compare_exchange_strong (requested, -1);
+
+    requested = requestedProgram.load();
+    programBank->update (requested >= 0 ? requested : currentProgram.load(), requested);
+}
+
+bool BasicInstrumentAudioProcessor::loadProgramBank (const juce::File& bankFile, juce::String& err)
+{
+    if (! programBank->load (bankFile, err))
+        return false;
+
+    currentProgram = 0;
+    requestedProgram = -1;
+    programBank->update (0, -1);
+
+    startTimerHz (20);
+    updateHostDisplay (ChangeDetails().withProgramChanged (true));
+    return true;
+}
+
+void BasicInstrumentAudioProcessor::restoreProgramBank (const juce::String& bankPath, int program)
+{
+    if (juce::File::isAbsolutePath (bankPath) && juce::File (bankPath) != getProgramBankFile())
+    {
+        juce::String bankErr;
+        loadProgramBank (juce::File (bankPath), bankErr);
+    }
+
+    if (juce::isPositiveAndBelow (program, programBank->getNumPrograms()))
+        currentProgram = program;
+}
+
+juce::File BasicInstrumentAudioProcessor::getProgramBankFile() const
+{
+    return programBank->getFile();
+}
+
+bool BasicInstrumentAudioProcessor::isProgramResident (int index) const
+{
+    return programBank->isResident (index);
+}
+
+//==============================================================================
+// Wavetable slots API
+juce::var BasicInstrumentAudioProcessor::WtSource::toVar (bool includeData) const
+{
+    juce::Array<juce::var> nodes;
+
+    // spectralData primero: lectores anteriores solo miran nodes[0]
+    if (codec.isNotEmpty())
+    {
+        auto* p = new juce::DynamicObject();
+        p->setProperty ("codec", codec);
+
+        if (phaseMode != PhaseMode::minimum)
+            p->setProperty ("phase", wtgen::getPhaseModeName (phaseMode));
+
+        if (loBin > 0 || hiBin > 0)
+        {
+            auto* banding = new juce::DynamicObject();
+            banding->setProperty ("loBin", loBin);
+            banding->setProperty ("hiBin", hiBin);
+
+            auto* noise = new juce::DynamicObject();
+            noise->setProperty ("banding", juce::var (banding));
+            p->setProperty ("noise", juce::var (noise));
+        }
+
+        if (includeData)
+            p->setProperty ("data", juce::Base64::toBase64 (data.getData(), data.getSize()));
+
+        auto* node = new juce::DynamicObject();
+        node->setProperty ("op", "spectralData");
+        node->setProperty ("p", juce::var (p));
+        nodes.add (juce::var (node));
+    }
+
+    if (framesCodec.isNotEmpty())
+    {
+        auto* p = new juce::DynamicObject();
+        p->setProperty ("codec", framesCodec);
+
+        if (codec.isEmpty() && phaseMode != PhaseMode::minimum)
+            p->setProperty ("phase", wtgen::getPhaseModeName (phaseMode));
+
+        if (includeData)
+            p->setProperty ("data", juce::Base64::toBase64 (frames.getData(), frames.getSize()));
+
+        auto* node = new juce::DynamicObject();
+        node->setProperty ("op", "timeFrames");
+        node->setProperty ("p", juce::var (p));
+        nodes.add (juce::var (node));
+    }
+
+    auto* program = new juce::DynamicObject();
+    program->setProperty ("nodes", nodes);
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty ("schema", "wtgen-1");
+    root->setProperty ("program", juce::var (program));
+
+    return juce::var (root);
+}
+
+juce::String BasicInstrumentAudioProcessor::WtSource::toJson() const
+{
+    return juce::JSON::toString (toVar (true), true);
+}
+
+bool BasicInstrumentAudioProcessor::decodeWtgenFile (const juce::File& file,
+                                                     std::optional<PhaseMode> phaseOverride,
+                                                     tasks::Priority priority,
+                                                     const tasks::CancelFlag* cancelled,
+                                                     WtSource::Ptr& outSrc, Wavetable::Ptr& outWt,
+                                                     juce::String& err)
+{
+    if (! file.existsAsFile())
+    {
+        err = "File does not exist";
+        return false;
+    }
+
+    juce::FileInputStream in (file);
+    if (! in.openedOk())
+    {
+        err = "Failed to read file";
+        return false;
+    }
+
+    // JSON o contenedor binario; el override de fase lo aplica el loader
+    const wtgen::DecodeLimits limits;
+    if (! wtgen::loadWtgenPipelined (in, file.getFileNameWithoutExtension(), limits, *scheduler, priority,
+                                     phaseOverride, outSrc, outWt, err, nullptr, cancelled))
+        return false;
+
+    framestore::intern (*outWt);
+    return true;
+}
+
+bool BasicInstrumentAudioProcessor::publishWtSlot (int slot, juce::uint32 generation,
+                                                   const Wavetable::Ptr& wt, const WtSource::Ptr& src,
+                                                   const juce::String& name)
+{
+    // Lo que había en el slot se suelta fuera del lock
+    Wavetable::Ptr oldWt = wt;
+    WtSource::Ptr oldSrc = src;
+    {
+        const juce::SpinLock::ScopedLockType sl (wtLock);
+
+        // Ya se pidió otra carga para este slot
+        if (wtSlotGeneration[(size_t) slot].load() != generation)
+            return false;
+
+        std::swap (wtSlots[(size_t) slot], oldWt);
+        std::swap (wtSlotSource[(size_t) slot], oldSrc);
+        wtSlotName[(size_t) slot] = name;
+    }
+
+    oldWt = nullptr;
+    oldSrc = nullptr;
+    framestore::purgeUnused();
+    return true;
+}
+
+bool BasicInstrumentAudioProcessor::loadWtgenSlot (int slot, const juce::File& file, juce::String& err,
+                                                   std::optional<PhaseMode> phaseOverride)
+{
+    err.clear();
+
+    if (! juce::isPositiveAndBelow (slot, 4))
+    {
+        err = "Invalid slot";
+        return false;
+    }
+
+    const auto generation = ++wtSlotGeneration[(size_t) slot];
+
+    WtSource::Ptr src;
+    Wavetable::Ptr wt;
+    if (! decodeWtgenFile (file, phaseOverride, tasks::Priority::interactive, nullptr, src, wt, err))
+        return false;
+
+    publishWtSlot (slot, generation, wt, src, file.getFileName());
+    return true;
+}
+
+void BasicInstrumentAudioProcessor::loadWtgenSlotAsync (int slot, const juce::File& file,
+                                                        std::function<void (bool, const juce::String&)> onDone,
+                                                        std::optional<PhaseMode> phaseOverride)
+{
+    const auto finish = [onDone] (bool ok, const juce::String& err)
+    {
+        if (onDone != nullptr)
+            juce::MessageManager::callAsync ([onDone, ok, err] { onDone (ok, err); });
+    };
+
+    if (! juce::isPositiveAndBelow (slot, 4))
+    {
+        finish (false, "Invalid slot");
+        return;
+    }
+
+    const auto generation = ++wtSlotGeneration[(size_t) slot];
+
+    scheduler->submit (this, tasks::Priority::interactive,
+                       [this, slot, file, phaseOverride, generation, finish] (const tasks::CancelFlag& cancelled)
+    {
+        // Superada por otra carga del mismo slot antes de empezar
+        if (cancelled || wtSlotGeneration[(size_t) slot].load() != generation)
+            return;
+
+        juce::String err;
+        WtSource::Ptr src;
+        Wavetable::Ptr wt;
+
+        const bool ok = decodeWtgenFile (file, phaseOverride, tasks::Priority::interactive, &cancelled,
+                                         src, wt, err);
+        if (ok && ! cancelled)
+            publishWtSlot (slot, generation, wt, src, file.getFileName());
+
+        finish (ok, err);
+    });
 }
 
 //==============================================================================
-// Processor
-BasicInstrumentAudioProcessor::BasicInstrumentAudioProcessor()
-: juce::AudioProcessor (BusesProperties().withOutput ("Output", juce::AudioChannelSet::stereo(), true))
-, apvts (*this, nullptr, "PARAMS", createParameterLayout())
+// Transacciones multi-slot
+bool BasicInstrumentAudioProcessor::beginSlotTransaction (const std::vector<SlotLoad>& loads,
+                                                          SlotTransaction& txn, juce::String& err)
 {
-    constexpr int numVoices = 8;
-    for (int i = 0; i < numVoices; ++i)
+    if (loads.empty())
     {
-        auto* v = new WavetableVoice();
-        v->setParameters (apvts, *this);
-        synth.addVoice (v);
+        err = "No slots to load";
+        return false;
     }
-    synth.addSound (new SineSound());
-}
 
-const juce::String BasicInstrumentAudioProcessor::getName() const { return JucePlugin_Name; }
-bool BasicInstrumentAudioProcessor::acceptsMidi() const   { return true; }
-bool BasicInstrumentAudioProcessor::producesMidi() const  { return false; }
-bool BasicInstrumentAudioProcessor::isMidiEffect() const  { return false; }
-double BasicInstrumentAudioProcessor::getTailLengthSeconds() const { return 0.0; }
+    std::array<bool, 4> used {};
+    for (const auto& load : loads)
+    {
+        if (! juce::isPositiveAndBelow (load.slot, 4))
+        {
+            err = "Invalid slot";
+            return false;
+        }
 
-int BasicInstrumentAudioProcessor::getNumPrograms() { return 1; }
-int BasicInstrumentAudioProcessor::getCurrentProgram() { return 0; }
-void BasicInstrumentAudioProcessor::setCurrentProgram (int) {}
-const juce::String BasicInstrumentAudioProcessor::getProgramName (int) { return {}; }
-void BasicInstrumentAudioProcessor::changeProgramName (int, const juce::String&) {}
+        if (used[(size_t) load.slot])
+        {
+            err = "Slot " + juce::String (load.slot + 1) + " requested twice";
+            return false;
+        }
 
-void BasicInstrumentAudioProcessor::prepareToPlay (double sampleRate, int)
-{
-    synth.setCurrentPlaybackSampleRate (sampleRate);
-}
+        used[(size_t) load.slot] = true;
+    }
 
-void BasicInstrumentAudioProcessor::releaseResources() {}
+    txn.entries.clear();
+    for (const auto& load : loads)
+    {
+        SlotTransaction::Entry e;
+        e.slot = load.slot;
+        e.generation = ++wtSlotGeneration[(size_t) load.slot];
+        e.name = load.file.getFileName();
+        txn.entries.push_back (e);
+    }
 
-bool BasicInstrumentAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
-{
-    const auto& out = layouts.getMainOutputChannelSet();
-    return (out == juce::AudioChannelSet::mono() || out == juce::AudioChannelSet::stereo());
+    return true;
 }
 
-void BasicInstrumentAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi)
+bool BasicInstrumentAudioProcessor::readSlotTransaction (const std::vector<SlotLoad>& loads, SlotTransaction& txn,
+                                                         tasks::Priority priority, const tasks::CancelFlag* cancelled,
+                                                         juce::String& err)
 {
-    juce::ScopedNoDenormals noDenormals;
-    buffer.clear();
-    synth.renderNextBlock (buffer, midi, 0, buffer.getNumSamples());
+    jassert (loads.size() == txn.entries.size());
+
+    scheduler->parallelFor ((int) loads.size(), priority, 0, [&] (int begin, int end, int)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            auto& e = txn.entries[(size_t) i];
+
+            if (cancelled != nullptr && cancelled->load())
+                e.err = "Cancelled";
+            else if (! wtgen::readWtgenFile (loads[(size_t) i].file, loads[(size_t) i].phaseOverride, {}, e.src, e.err))
+                e.src = nullptr;
+        }
+    });
+
+    for (const auto& e : txn.entries)
+    {
+        if (e.err.isNotEmpty())
+        {
+            err = "Slot " + juce::String (e.slot + 1) + ": " + e.err;
+            return false;
+        }
+    }
+
+    return true;
 }
 
-//==============================================================================
-// Wavetable slots API
-bool BasicInstrumentAudioProcessor::loadWtgenSlot (int slot, const juce::File& file, juce::String& err)
+bool BasicInstrumentAudioProcessor::buildSlotTransaction (SlotTransaction& txn, tasks::Priority priority,
+                                                          const tasks::CancelFlag* cancelled, juce::String& err)
 {
-    err.clear();
+    // Tablas ya cargadas en esta instancia: misma fuente -> misma tabla
+    std::array<Wavetable::Ptr, 4> current;
+    getWtSlotsSnapshot (current);
 
-    if (! juce::isPositiveAndBelow (slot, 4))
+    const auto findLoaded = [&current] (juce::uint64 sourceHash) -> Wavetable::Ptr
     {
-        err = "Invalid slot";
-        return false;
+        for (auto& wt : current)
+            if (wt != nullptr && wt->sourceHash == sourceHash)
+                return wt;
+
+        return nullptr;
+    };
+
+    // Entradas a reconstruir (una por fuente distinta; los duplicados copian el resultado)
+    std::vector<size_t> toBuild;
+    for (size_t i = 0; i < txn.entries.size(); ++i)
+    {
+        auto& e = txn.entries[i];
+        if (e.src == nullptr || e.err.isNotEmpty())
+            continue;
+
+        e.wt = findLoaded (e.src->contentHash);
+        if (e.wt != nullptr)
+            continue;
+
+        const bool duplicate = std::any_of (toBuild.begin(), toBuild.end(), [&] (size_t j)
+        {
+            return txn.entries[j].src->contentHash == e.src->contentHash;
+        });
+
+        if (! duplicate)
+            toBuild.push_back (i);
     }
 
-    if (! file.existsAsFile())
+    const wtgen::DecodeLimits limits;
+    scheduler->parallelFor ((int) toBuild.size(), priority, 0, [&] (int begin, int end, int)
     {
-        err = "File does not exist";
-        return false;
+        for (int k = begin; k < end; ++k)
+        {
+            auto& e = txn.entries[toBuild[(size_t) k]];
+
+            if (cancelled != nullptr && cancelled->load())
+            {
+                e.err = "Cancelled";
+                continue;
+            }
+
+            if (wtgen::buildWavetableFromSource (*e.src, limits, e.wt, e.err, cancelled))
+                framestore::intern (*e.wt);
+        }
+    });
+
+    for (auto& e : txn.entries)
+    {
+        if (e.src == nullptr || e.wt != nullptr || e.err.isNotEmpty())
+            continue;
+
+        for (auto j : toBuild)
+        {
+            if (txn.entries[j].src->contentHash == e.src->contentHash)
+            {
+                e.wt = txn.entries[j].wt;
+                e.err = txn.entries[j].err;
+                break;
+            }
+        }
     }
 
-    const auto jsonText = file.loadFileAsString();
-    if (jsonText.isEmpty())
+    for (const auto& e : txn.entries)
     {
-        err = "Failed to read file";
-        return false;
+        if (e.err.isNotEmpty())
+        {
+            err = "Slot " + juce::String (e.slot + 1) + ": " + e.err;
+            return false;
+        }
     }
 
-    Wavetable::Ptr wt;
-    if (! buildWavetableFromWtgenJson (jsonText, file.getFileNameWithoutExtension(), wt, err))
-        return false;
+    return true;
+}
+
+void BasicInstrumentAudioProcessor::waitForSessionRestore()
+{
+    while (restoresPending.load() > 0)
+        restoreDone.wait (10);
+}
+
+void BasicInstrumentAudioProcessor::publishWtSlots (const SlotTransaction& txn)
+{
+    // Lo que había en los slots se suelta fuera del lock
+    std::vector<Wavetable::Ptr> oldTables;
+    std::vector<WtSource::Ptr> oldSources;
+    oldTables.reserve (txn.entries.size());
+    oldSources.reserve (txn.entries.size());
 
     {
         const juce::SpinLock::ScopedLockType sl (wtLock);
-        wtSlots[(size_t) slot]    = wt;
-        wtSlotJson[(size_t) slot] = jsonText;
-        wtSlotName[(size_t) slot] = file.getFileName();
+
+        for (const auto& e : txn.entries)
+        {
+            // Un slot que ya pidió otra carga se queda con la suya; el resto cambia a la vez
+            if (wtSlotGeneration[(size_t) e.slot].load() != e.generation)
+                continue;
+
+            // Fallo: sigue sonando la tabla anterior, con su fuente (se guarda la que suena)
+            if (e.err.isNotEmpty() || e.wt == nullptr)
+            {
+                if (e.sourcePublished)
+                {
+                    oldSources.push_back (std::move (wtSlotSource[(size_t) e.slot]));
+                    wtSlotSource[(size_t) e.slot] = e.previousSrc;
+                    wtSlotName[(size_t) e.slot]   = e.previousName;
+                }
+                continue;
+            }
+
+            oldTables.push_back (std::move (wtSlots[(size_t) e.slot]));
+            oldSources.push_back (std::move (wtSlotSource[(size_t) e.slot]));
+
+            wtSlots[(size_t) e.slot]      = e.wt;
+            wtSlotSource[(size_t) e.slot] = e.src;
+            wtSlotName[(size_t) e.slot]   = e.name;
+        }
     }
 
+    oldTables.clear();
+    oldSources.clear();
+    framestore::purgeUnused();
+}
+
+bool BasicInstrumentAudioProcessor::loadWtgenSlots (const std::vector<SlotLoad>& loads, juce::String& err)
+{
+    err.clear();
+
+    SlotTransaction txn;
+    if (! beginSlotTransaction (loads, txn, err))
+        return false;
+
+    if (! readSlotTransaction (loads, txn, tasks::Priority::interactive, nullptr, err)
+         || ! buildSlotTransaction (txn, tasks::Priority::interactive, nullptr, err))
+        return false;
+
+    publishWtSlots (txn);
     return true;
 }
 
+void BasicInstrumentAudioProcessor::loadWtgenSlotsAsync (std::vector<SlotLoad> loads,
+                                                         std::function<void (bool, const juce::String&)> onDone)
+{
+    const auto finish = [onDone] (bool ok, const juce::String& err)
+    {
+        if (onDone != nullptr)
+            juce::MessageManager::callAsync ([onDone, ok, err] { onDone (ok, err); });
+    };
+
+    SlotTransaction txn;
+    juce::String err;
+    if (! beginSlotTransaction (loads, txn, err))
+    {
+        finish (false, err);
+        return;
+    }
+
+    scheduler->submit (this, tasks::Priority::interactive,
+                       [this, loads = std::move (loads), txn, finish] (const tasks::CancelFlag& cancelled) mutable
+    {
+        // Todos los slots ya tienen otra carga pedida
+        const bool superseded = std::none_of (txn.entries.begin(), txn.entries.end(), [this] (const auto& e)
+        {
+            return wtSlotGeneration[(size_t) e.slot].load() == e.generation;
+        });
+
+        if (cancelled || superseded)
+            return;
+
+        juce::String jobErr;
+        const bool ok = readSlotTransaction (loads, txn, tasks::Priority::interactive, &cancelled, jobErr)
+                     && buildSlotTransaction (txn, tasks::Priority::interactive, &cancelled, jobErr);
+
+        if (ok && ! cancelled)
+            publishWtSlots (txn);
+
+        finish (ok, jobErr);
+    });
+}
+
 BasicInstrumentAudioProcessor::Wavetable::Ptr BasicInstrumentAudioProcessor::getWtSlot (int slot) const
 {
     if (! juce::isPositiveAndBelow (slot, 4))
@@ -758,13 +1918,21 @@ juce::String BasicInstrumentAudioProcessor::getWtSlotName (int slot) const
     return wtSlotName[(size_t) slot];
 }
 
-juce::String BasicInstrumentAudioProcessor::getWtSlotJson (int slot) const
+BasicInstrumentAudioProcessor::WtSource::Ptr BasicInstrumentAudioProcessor::getWtSlotSource (int slot) const
 {
     if (! juce::isPositiveAndBelow (slot, 4))
-        return {};
+        return nullptr;
 
     const juce::SpinLock::ScopedLockType sl (wtLock);
-    return wtSlotJson[(size_t) slot];
+    return wtSlotSource[(size_t) slot];
+}
+
+juce::String BasicInstrumentAudioProcessor::getWtSlotJson (int slot) const
+{
+    if (auto src = getWtSlotSource (slot))
+        return src->toJson();
+
+    return {};
 }
 
 //==============================================================================
@@ -773,7 +1941,8 @@ void BasicInstrumentAudioProcessor::getStateInformation (juce::MemoryBlock& dest
 {
     auto state = apvts.copyState();
 
-    // Store WT JSON per slot for portability
+    // Store WT JSON per slot for portability (regenerado desde la fuente compacta;
+    // mismo formato que antes, así que versiones anteriores siguen leyendo el estado)
     for (int i = 0; i < 4; ++i)
     {
         const auto key = juce::String ("wt_slot") + juce::String (i + 1) + "_json";
@@ -783,6 +1952,14 @@ void BasicInstrumentAudioProcessor::getStateInformation (juce::MemoryBlock& dest
         state.setProperty (keyName, getWtSlotName (i), nullptr);
     }
 
+    // Banco de programas: solo la ruta (las tablas del programa ya van en los slots)
+    const auto bankFile = getProgramBankFile();
+    if (bankFile != juce::File())
+    {
+        state.setProperty ("program_bank", bankFile.getFullPathName(), nullptr);
+        state.setProperty ("program", getCurrentProgram(), nullptr);
+    }
+
     std::unique_ptr<juce::XmlElement> xml (state.createXml());
     copyXmlToBinary (*xml, destData);
 }
@@ -797,31 +1974,110 @@ void BasicInstrumentAudioProcessor::setStateInformation (const void* data, int s
         return;
 
     auto vt = juce::ValueTree::fromXml (*xmlState);
-    apvts.replaceState (vt);
+    xmlState.reset();
+
+    // Banco de programas: se vuelve a cargar y precarga alrededor del programa guardado.
+    // No hay cambio de programa: los slots restaurados abajo son los que sonaban.
+    const auto bankPath = vt.getProperty ("program_bank").toString();
+    const int program = vt.getProperty ("program", 0);
+    vt.removeProperty ("program_bank", nullptr);
+    vt.removeProperty ("program", nullptr);
+
+    if (juce::MessageManager::existsAndIsCurrentThread())
+    {
+        restoreProgramBank (bankPath, program);
+    }
+    else
+    {
+        juce::MessageManager::callAsync ([this, flag = alive, bankPath, program]
+        {
+            if (flag->load())
+                restoreProgramBank (bankPath, program);
+        });
+    }
+
+    // Restore wavetable slots from embedded JSON (best-effort), como una transacción:
+    // todos los slots restaurados cambian a la vez
+    const wtgen::DecodeLimits limits;
+    SlotTransaction txn;
 
-    // Restore wavetable slots from embedded JSON (best-effort)
     for (int i = 0; i < 4; ++i)
     {
         const auto key = juce::String ("wt_slot") + juce::String (i + 1) + "_json";
+        const auto keyName = juce::String ("wt_slot") + juce::String (i + 1) + "_name";
+
+        const auto nameHint = vt.getProperty (keyName).toString();
         const auto json = vt.getProperty (key).toString();
 
-        if (json.isNotEmpty())
-        {
-            juce::String err;
-            Wavetable::Ptr wt;
+        // No dejar el JSON (ni el nombre) retenido dentro de apvts.state
+        vt.removeProperty (key, nullptr);
+        vt.removeProperty (keyName, nullptr);
+
+        if (json.isEmpty())
+            continue;
+
+        juce::String err;
+        WtSource::Ptr src;
+        if (! wtgen::parseWtgenJson (json, nameHint, limits, src, err))
+            continue;
 
-            const auto keyName = juce::String ("wt_slot") + juce::String (i + 1) + "_name";
-            const auto nameHint = vt.getProperty (keyName).toString();
+        SlotTransaction::Entry e;
+        e.slot = i;
+        e.generation = ++wtSlotGeneration[(size_t) i];
+        e.src = src;
+        e.name = nameHint;
+        txn.entries.push_back (e);
+    }
 
-            if (buildWavetableFromWtgenJson (json, nameHint, wt, err))
+    if (! txn.entries.empty())
+    {
+        // Las fuentes se publican ya (el estado vuelve a guardarse igual aunque el decode
+        // no haya terminado); las tablas anteriores siguen sonando hasta el swap
+        {
+            const juce::SpinLock::ScopedLockType sl (wtLock);
+            for (auto& e : txn.entries)
             {
-                const juce::SpinLock::ScopedLockType sl (wtLock);
-                wtSlots[(size_t) i]    = wt;
-                wtSlotJson[(size_t) i] = json;
-                wtSlotName[(size_t) i] = nameHint;
+                e.sourcePublished = true;
+                e.previousSrc  = wtSlotSource[(size_t) e.slot];
+                e.previousName = wtSlotName[(size_t) e.slot];
+
+                wtSlotSource[(size_t) e.slot] = e.src;
+                wtSlotName[(size_t) e.slot]   = e.name;
             }
         }
+
+        // Un slot que no se puede reconstruir se queda con la tabla y la fuente anteriores.
+        // Sin audio en marcha (carga del proyecto) o en render offline: decode aquí, para
+        // que el primer bloque ya suene con las tablas restauradas. Con audio en vivo, en
+        // el pool con prioridad sessionRestore (siguen sonando las anteriores hasta el swap)
+        if (isNonRealtime() || ! audioRunning.load())
+        {
+            juce::String decodeErr;
+            buildSlotTransaction (txn, tasks::Priority::sessionRestore, nullptr, decodeErr);
+            publishWtSlots (txn);
+        }
+        else
+        {
+            ++restoresPending;
+            scheduler->submit (this, tasks::Priority::sessionRestore,
+                               [this, txn] (const tasks::CancelFlag& cancelled) mutable
+            {
+                if (! cancelled)
+                {
+                    juce::String decodeErr;
+                    buildSlotTransaction (txn, tasks::Priority::sessionRestore, &cancelled, decodeErr);
+
+                    if (! cancelled)
+                        publishWtSlots (txn);
+                }
+
+                --restoresPending;
+                restoreDone.signal();
+            });
+        }
     }
+
+    apvts.replaceState (vt);
 }
 
 //==============================================================================
@@ -967,7 +2223,8 @@ namespace ui
 
 //==============================================================================
 // Editor (dentro del mismo .cpp)
-class BasicInstrumentAudioProcessorEditor : public juce::AudioProcessorEditor
+class BasicInstrumentAudioProcessorEditor : public juce::AudioProcessorEditor,
+                                            private juce::Timer
 {
 public:
     explicit BasicInstrumentAudioProcessorEditor (BasicInstrumentAudioProcessor& p)
@@ -981,7 +2238,17 @@ public:
       knobOsc1    (p.apvts, "osc1_level", "OSC1"),
       knobOsc2    (p.apvts, "osc2_level", "OSC2"),
       knobOsc3    (p.apvts, "osc3_level", "OSC3"),
-      knobOsc4    (p.apvts, "osc4_level", "OSC4")
+      knobOsc4    (p.apvts, "osc4_level", "OSC4"),
+      knobSpeed   (p.apvts, "play_speed", "SPEED"),
+      knobStart   (p.apvts, "play_start", "START"),
+      knobEnd     (p.apvts, "play_end",   "END"),
+      knobRatio   (p.apvts, "sync_ratio", "RATIO"),
+      knobDrive   (p.apvts, "drive",      "DRIVE"),
+      knobVecX    (p.apvts, "vector_x",         "VEC X"),
+      knobVecY    (p.apvts, "vector_y",         "VEC Y"),
+      knobVecEnv  (p.apvts, "vector_env",       "VEC ENV"),
+      knobVecRate (p.apvts, "vector_lfo_rate",  "LFO RATE"),
+      knobVecDepth (p.apvts, "vector_lfo_depth", "LFO DEPTH")
     {
         setLookAndFeel (&lnf);
 
@@ -992,13 +2259,59 @@ public:
 
         auto labelFont = lnf.font (12.0f, juce::Font::bold);
         for (auto* k : { &knobGain, &knobAttack, &knobDecay, &knobSustain, &knobRelease, &knobMorph,
-                         &knobOsc1, &knobOsc2, &knobOsc3, &knobOsc4 })
+                         &knobOsc1, &knobOsc2, &knobOsc3, &knobOsc4, &knobSpeed, &knobStart, &knobEnd,
+                         &knobRatio, &knobDrive, &knobVecX, &knobVecY, &knobVecEnv, &knobVecRate, &knobVecDepth })
             k->label.setFont (labelFont);
 
         for (auto* k : { &knobGain, &knobAttack, &knobDecay, &knobSustain, &knobRelease, &knobMorph,
-                         &knobOsc1, &knobOsc2, &knobOsc3, &knobOsc4 })
+                         &knobOsc1, &knobOsc2, &knobOsc3, &knobOsc4, &knobSpeed, &knobStart, &knobEnd,
+                         &knobRatio, &knobDrive, &knobVecX, &knobVecY, &knobVecEnv, &knobVecRate, &knobVecDepth })
             addAndMakeVisible (*k);
 
+        // Modo de frames: morph fijo o playback en el tiempo
+        modeBox.addItemList ({ "Morph", "Playback" }, 1);
+        addAndMakeVisible (modeBox);
+        modeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (
+            p.apvts, "wt_mode", modeBox);
+
+        loopButton.setButtonText ("Loop");
+        addAndMakeVisible (loopButton);
+        loopAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment> (
+            p.apvts, "play_loop", loopButton);
+
+        // Hard sync de osc 2..4 al osc 1
+        for (int i = 0; i < 3; ++i)
+        {
+            syncButtons[i].setButtonText ("Sync " + juce::String (i + 2));
+            addAndMakeVisible (syncButtons[i]);
+            syncAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment> (
+                p.apvts, "osc" + juce::String (i + 2) + "_sync", syncButtons[i]);
+        }
+
+        // Matriz PM: "m>c" = osc m modula la fase de osc c
+        for (int m = 0; m < 4; ++m)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                auto& k = pmKnobs[(size_t) (m * 4 + c)];
+                k = std::make_unique<ui::KnobWithLabel> (p.apvts, getPmParamId (m, c),
+                                                         juce::String (m + 1) + ">" + juce::String (c + 1));
+                k->label.setFont (lnf.font (10.0f, juce::Font::bold));
+                addAndMakeVisible (*k);
+            }
+        }
+
+        pmOversamplingBox.addItemList ({ "PM 2x", "PM 4x" }, 1);
+        addAndMakeVisible (pmOversamplingBox);
+        pmOversamplingAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (
+            p.apvts, "pm_oversampling", pmOversamplingBox);
+
+        // Modo vector: XY de los 4 slots
+        vectorButton.setButtonText ("Vector");
+        addAndMakeVisible (vectorButton);
+        vectorAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment> (
+            p.apvts, "vector_mode", vectorButton);
+
         for (int i = 0; i < 4; ++i)
         {
             wtButtons[i].setButtonText ("Load WT" + juce::String (i + 1));
@@ -1009,15 +2322,45 @@ public:
             wtLabels[i].setJustificationType (juce::Justification::centredLeft);
             wtLabels[i].setText ("(empty)", juce::dontSendNotification);
             addAndMakeVisible (wtLabels[i]);
+
+            // Forma built-in del slot (suena mientras el slot está vacío)
+            shapeBoxes[i].addItemList (builtin::getShapeNames(), 1);
+            addAndMakeVisible (shapeBoxes[i]);
+            shapeAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment> (
+                p.apvts, "osc" + juce::String (i + 1) + "_shape", shapeBoxes[i]);
         }
 
         refreshWtLabels();
 
-        setSize (720, 300);
+        // Banco de programas: fichero + selector (también responde a MIDI program change)
+        bankButton.setButtonText ("Bank...");
+        bankButton.onClick = [this] { chooseBank(); };
+        addAndMakeVisible (bankButton);
+
+        programBox.setTextWhenNothingSelected ("(no bank)");
+        programBox.onChange = [this]
+        {
+            const int index = programBox.getSelectedItemIndex();
+            if (index >= 0 && index != proc.getCurrentProgram())
+                proc.setCurrentProgram (index);
+        };
+        addAndMakeVisible (programBox);
+        refreshProgramBox();
+
+        // Diagnóstico de memoria (instancia + proceso)
+        memLabel.setFont (lnf.font (11.0f));
+        memLabel.setJustificationType (juce::Justification::centredLeft);
+        memLabel.setColour (juce::Label::textColourId, juce::Colours::white.withAlpha (0.55f));
+        addAndMakeVisible (memLabel);
+        refreshMemoryLabel();
+        startTimerHz (2);
+
+        setSize (720, 650);
     }
 
     ~BasicInstrumentAudioProcessorEditor() override
     {
+        stopTimer();
         setLookAndFeel (nullptr);
     }
 
@@ -1036,17 +2379,25 @@ public:
     void resized() override
     {
         auto r = getLocalBounds().reduced (18);
-        title.setBounds (r.removeFromTop (28));
+        memLabel.setBounds (r.removeFromBottom (18));
+
+        auto titleRow = r.removeFromTop (28);
+        bankButton.setBounds (titleRow.removeFromLeft (70).reduced (0, 3));
+        programBox.setBounds (titleRow.removeFromRight (180).reduced (0, 3));
+        title.setBounds (titleRow);
         r.removeFromTop (8);
 
         // WT buttons + labels
-        auto wtRow = r.removeFromTop (36);
+        auto wtRow = r.removeFromTop (50);
         for (int i = 0; i < 4; ++i)
         {
             auto cell = wtRow.removeFromLeft (wtRow.getWidth() / (4 - i));
             auto btnArea = cell.removeFromTop (22);
             wtButtons[i].setBounds (btnArea.removeFromLeft (90));
             wtLabels[i].setBounds (btnArea);
+
+            cell.removeFromTop (4);
+            shapeBoxes[i].setBounds (cell.removeFromTop (22).removeFromLeft (90));
         }
 
         r.removeFromTop (10);
@@ -1071,9 +2422,120 @@ public:
         place (knobOsc2);
         place (knobOsc3);
         place (knobOsc4);
+        place (knobDrive);
+
+        // Playback
+        r.removeFromTop (6);
+        auto row2 = r.removeFromTop (knobH);
+        auto controls = row2.removeFromLeft (100);
+        modeBox.setBounds (controls.removeFromTop (22));
+        controls.removeFromTop (6);
+        loopButton.setBounds (controls.removeFromTop (22));
+
+        for (auto* k : { &knobSpeed, &knobStart, &knobEnd })
+            k->setBounds (row2.removeFromLeft (knobW).reduced (3, 0));
+
+        // Sync
+        row2.removeFromLeft (24);
+        auto syncControls = row2.removeFromLeft (80);
+        for (auto& b : syncButtons)
+        {
+            b.setBounds (syncControls.removeFromTop (22));
+            syncControls.removeFromTop (4);
+        }
+
+        knobRatio.setBounds (row2.removeFromLeft (knobW).reduced (3, 0));
+
+        // Matriz PM
+        r.removeFromTop (6);
+        auto row3 = r.removeFromTop (80);
+        pmOversamplingBox.setBounds (row3.removeFromLeft (80).removeFromTop (22));
+        row3.removeFromLeft (8);
+
+        const int pmW = row3.getWidth() / (int) pmKnobs.size();
+        for (auto& k : pmKnobs)
+            k->setBounds (row3.removeFromLeft (pmW));
+
+        // Vector XY
+        r.removeFromTop (6);
+        auto row4 = r.removeFromTop (knobH);
+        vectorButton.setBounds (row4.removeFromLeft (100).removeFromTop (22));
+
+        for (auto* k : { &knobVecX, &knobVecY, &knobVecEnv, &knobVecRate, &knobVecDepth })
+            k->setBounds (row4.removeFromLeft (knobW).reduced (3, 0));
     }
 
 private:
+    void timerCallback() override
+    {
+        refreshMemoryLabel();
+
+        // Un program change por MIDI cambia los slots sin pasar por la UI
+        refreshProgramBox();
+        refreshWtLabels();
+    }
+
+    void refreshProgramBox()
+    {
+        const auto bankFile = proc.getProgramBankFile();
+        if (bankFile != shownBankFile)
+        {
+            shownBankFile = bankFile;
+            programBox.clear (juce::dontSendNotification);
+
+            if (bankFile != juce::File())
+                for (int i = 0; i < proc.getNumPrograms(); ++i)
+                    programBox.addItem (juce::String (i + 1) + ". " + proc.getProgramName (i), i + 1);
+        }
+
+        if (programBox.getNumItems() > 0)
+            programBox.setSelectedItemIndex (proc.getCurrentProgram(), juce::dontSendNotification);
+    }
+
+    void chooseBank()
+    {
+        fileChooser = std::make_unique<juce::FileChooser> (
+            "Load program bank (wtgen-bank-1)",
+            juce::File(),
+            "*.json");
+
+        const int chooserFlags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+        fileChooser->launchAsync (chooserFlags, [this] (const juce::FileChooser& fc)
+        {
+            const auto file = fc.getResult();
+            if (! file.existsAsFile())
+                return;
+
+            // Solo lee la lista; las tablas se precargan en el pool
+            juce::String err;
+            if (! proc.loadProgramBank (file, err))
+            {
+                juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::WarningIcon,
+                                                       "Bank Load Error",
+                                                       err);
+            }
+
+            refreshProgramBox();
+        });
+    }
+
+    void refreshMemoryLabel()
+    {
+        auto mb = [] (size_t bytes) { return juce::File::descriptionOfSizeInBytes ((juce::int64) bytes); };
+
+        const auto inst = proc.getMemoryStats();
+        const auto all  = BasicInstrumentAudioProcessor::getProcessMemoryStats();
+
+        memLabel.setText ("MEM " + mb (inst.getTotalBytes())
+                          + "  (wt " + mb (inst.wavetableBytes)
+                          + " / src " + mb (inst.sourceBytes)
+                          + " / state " + mb (inst.stateBytes)
+                          + " / voices " + mb (inst.voiceBytes) + ")"
+                          + "   |   process: " + juce::String (all.instances) + " inst, "
+                          + mb (all.getTotalBytes()) + ", dup " + mb (all.duplicateBytes),
+                          juce::dontSendNotification);
+    }
+
     void refreshWtLabels()
     {
         for (int i = 0; i < 4; ++i)
@@ -1086,9 +2548,9 @@ private:
     void chooseAndLoad (int slot)
     {
         fileChooser = std::make_unique<juce::FileChooser> (
-            "Load WTGEN (.wtgen.json)",
+            "Load WTGEN (.wtgen.json / .wtgen.bin)",
             juce::File(),
-            "*.wtgen.json;*.json");
+            "*.wtgen.json;*.wtgen.bin;*.json");
 
         const int chooserFlags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
         fileChooser->launchAsync (chooserFlags, [this, slot] (const juce::FileChooser& fc)
@@ -1097,14 +2559,24 @@ private:
             if (! file.existsAsFile())
                 return;
 
-            juce::String err;
-            if (! proc.loadWtgenSlot (slot, file, err))
+            // Decode en el pool compartido; la UI no se bloquea con tablas grandes
+            juce::Component::SafePointer<BasicInstrumentAudioProcessorEditor> safeThis (this);
+
+            proc.loadWtgenSlotAsync (slot, file, [safeThis] (bool ok, const juce::String& err)
             {
-                juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::WarningIcon,
-                                                       "WT Load Error",
-                                                       err);
-            }
-            refreshWtLabels();
+                if (! ok)
+                {
+                    juce::AlertWindow::showMessageBoxAsync (juce::AlertWindow::WarningIcon,
+                                                           "WT Load Error",
+                                                           err);
+                }
+
+                if (safeThis != nullptr)
+                {
+                    safeThis->refreshWtLabels();
+                    safeThis->refreshMemoryLabel();
+                }
+            });
         });
     }
 
@@ -1123,11 +2595,44 @@ private:
     ui::KnobWithLabel knobOsc2;
     ui::KnobWithLabel knobOsc3;
     ui::KnobWithLabel knobOsc4;
+    ui::KnobWithLabel knobSpeed;
+    ui::KnobWithLabel knobStart;
+    ui::KnobWithLabel knobEnd;
+    ui::KnobWithLabel knobRatio;
+    ui::KnobWithLabel knobDrive;
+    ui::KnobWithLabel knobVecX;
+    ui::KnobWithLabel knobVecY;
+    ui::KnobWithLabel knobVecEnv;
+    ui::KnobWithLabel knobVecRate;
+    ui::KnobWithLabel knobVecDepth;
+
+    juce::ComboBox modeBox;
+    juce::ToggleButton loopButton;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> modeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> loopAttachment;
+
+    std::array<juce::ToggleButton, 3> syncButtons; // osc 2..4
+    std::array<std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment>, 3> syncAttachments;
+
+    std::array<std::unique_ptr<ui::KnobWithLabel>, 16> pmKnobs; // [modulador * 4 + portadora]
+    juce::ComboBox pmOversamplingBox;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> pmOversamplingAttachment;
+
+    juce::ToggleButton vectorButton;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> vectorAttachment;
 
     std::array<juce::TextButton, 4> wtButtons;
     std::array<juce::Label, 4> wtLabels;
+    std::array<juce::ComboBox, 4> shapeBoxes;
+    std::array<std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment>, 4> shapeAttachments;
     std::unique_ptr<juce::FileChooser> fileChooser;
 
+    juce::TextButton bankButton;
+    juce::ComboBox programBox;
+    juce::File shownBankFile;
+
+    juce::Label memLabel;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BasicInstrumentAudioProcessorEditor)
 };
 
@@ -1,10 +1,20 @@
 #pragma once
 #include <JuceHeader.h>
 
+#include "TaskScheduler.h"
+
 #include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
 #include <mutex> // (no es estrictamente necesario si usas juce::SpinLock, pero lo incluyo como pediste)
 
-class BasicInstrumentAudioProcessor : public juce::AudioProcessor
+namespace programs { class Bank; }
+
+class BasicInstrumentAudioProcessor : public juce::AudioProcessor,
+                                      private juce::Timer
 {
 public:
     //==============================================================================
@@ -13,17 +23,185 @@ public:
     {
         using Ptr = juce::ReferenceCountedObjectPtr<Wavetable>;
 
+        // Frame inmutable del FrameStore, compartido por contenido entre tablas,
+        // slots e instancias
+        struct SharedFrame : public juce::ReferenceCountedObject
+        {
+            using Ptr = juce::ReferenceCountedObjectPtr<SharedFrame>;
+
+            juce::uint64 hash = 0;
+            int size = 0;
+            juce::HeapBlock<float> data;
+
+            size_t getMemoryBytes() const noexcept { return sizeof (*this) + (size_t) size * sizeof (float); }
+        };
+
         int tableSize = 0;
         int frames    = 0;
 
-        // Tabla: [frames][tableSize]
+        // Tabla: [frames][tableSize] (vacía una vez internada en el FrameStore)
         juce::AudioBuffer<float> table;
 
+        // Indirección frame -> frame compartido; frames idénticos comparten puntero
+        std::vector<SharedFrame::Ptr> sharedFrames;
+
         juce::String name;
+
+        // Hash del contenido de table (FNV-1a), para detectar duplicados
+        juce::uint64 contentHash = 0;
+
+        // WtSource::contentHash de la fuente reconstruida (0 = built-in): una carga
+        // con la misma fuente reutiliza la tabla sin reconstruirla
+        juce::uint64 sourceHash = 0;
+
+        // Armónico más alto con energía (> -80 dB del pico) de cada frame y de toda la
+        // tabla; con el phaseDelta de la voz decide su sobremuestreo. Vacío = sin medir
+        std::vector<int> frameBandwidth;
+        int maxBandwidth = 0;
+
+        // Mip chain dispersa: el nivel m >= 1 tiene tableSize >> m samples y los armónicos
+        // hasta getMipBandwidth (m). Solo se guarda para los frames que pasan de ese límite;
+        // el resto se lee del frame completo, que ya no tiene aliasing a ese nivel.
+        // mipFrames[f * mipLevels + m]: frame del FrameStore (internado con la tabla),
+        // nullptr = frame completo
+        static constexpr int minMipSize = 16;
+        int mipLevels = 0; // 0 = sin mips (built-in: una tabla por nivel)
+        std::vector<SharedFrame::Ptr> mipFrames;
+
+        // Lectura de un frame, esté o no internado
+        const float* getFrame (int f) const noexcept
+        {
+            return sharedFrames.empty() ? table.getReadPointer (f)
+                                        : sharedFrames[(size_t) f]->data.get();
+        }
+
+        // Armónico más alto que cabe en el nivel (el 0 es el frame completo)
+        static int getMipBandwidth (int size, int level) noexcept
+        {
+            return level == 0 ? size / 2 : (size >> (level + 1)) - 1;
+        }
+
+        int getMipBandwidth (int level) const noexcept { return getMipBandwidth (tableSize, level); }
+
+        // Niveles (con el 0) hasta minMipSize para una tabla de este tamaño
+        static int getNumMipLevels (int size) noexcept
+        {
+            int levels = 1;
+            while ((size >> levels) >= minMipSize)
+                ++levels;
+
+            return levels;
+        }
+
+        // Nivel más bajo cuyo límite no pasa de Nyquist a este phaseDelta
+        int getMipLevelForDelta (float phaseDelta) const noexcept
+        {
+            int level = 0;
+            while (level + 1 < mipLevels && (float) getMipBandwidth (level) * phaseDelta > 0.5f)
+                ++level;
+
+            return level;
+        }
+
+        // Frame f al nivel dado; size = su tamaño de tabla (potencia de 2)
+        const float* getMipFrame (int f, int level, int& size) const noexcept
+        {
+            if (level > 0 && level < mipLevels)
+            {
+                const auto& mip = mipFrames[(size_t) (f * mipLevels + level)];
+                if (mip != nullptr)
+                {
+                    size = mip->size;
+                    return mip->data.get();
+                }
+            }
+
+            size = tableSize;
+            return getFrame (f);
+        }
+
+        // Sin los frames compartidos ni los mips (se cuentan una vez por proceso)
+        size_t getMemoryBytes() const noexcept
+        {
+            return sizeof (*this)
+                 + (size_t) table.getNumChannels() * (size_t) table.getNumSamples() * sizeof (float)
+                 + sharedFrames.size() * sizeof (SharedFrame::Ptr)
+                 + frameBandwidth.size() * sizeof (int)
+                 + mipFrames.size() * sizeof (SharedFrame::Ptr);
+        }
+    };
+
+    // Reconstrucción de fase de cada frame a partir de su espectro de magnitud
+    enum class PhaseMode
+    {
+        minimum = 0, // real-cepstrum (3 FFTs complejas + exp/cos/sin por bin)
+        zero,        // fase cero: una sola IFFT real
+        fixed        // fase fija (Schroeder) común a todos los frames: una sola IFFT real
     };
 
-    // Carga un .wtgen.json (o .json compatible) en un slot [0..3]
-    bool loadWtgenSlot (int slot, const juce::File& file, juce::String& err);
+    // Fuente compacta de un slot: framepack binario (sin base64) + metadata mínima.
+    // El JSON original no se retiene; se regenera solo al exportar (toJson).
+    struct WtSource : public juce::ReferenceCountedObject
+    {
+        using Ptr = juce::ReferenceCountedObjectPtr<WtSource>;
+
+        juce::String codec;     // p.codec (ej. "harm-noise-framepack-v1"); vacío = sin datos espectrales
+        juce::MemoryBlock data; // p.data ya decodificado
+        int loBin = 0;          // p.noise.banding (0 = default del decoder)
+        int hiBin = 0;
+        PhaseMode phaseMode = PhaseMode::minimum; // p.phase
+        juce::String name;
+
+        // Nodo opcional "timeFrames": tabla final precalculada (se carga sin FFT)
+        juce::String framesCodec;   // ej. "pcm-frames-v1"; vacío = sin frames
+        juce::MemoryBlock frames;   // payload ya decodificado
+
+        // Hash de codec + banding + fase + data + frames (FNV-1a)
+        juce::uint64 contentHash = 0;
+
+        size_t getMemoryBytes() const noexcept
+        {
+            return sizeof (*this) + data.getSize() + frames.getSize()
+                 + (size_t) codec.getNumBytesAsUTF8() + (size_t) framesCodec.getNumBytesAsUTF8()
+                 + (size_t) name.getNumBytesAsUTF8();
+        }
+
+        // Regenera un wtgen-1 JSON equivalente (export / estado).
+        // includeData = false: sin p.data (meta del contenedor binario)
+        juce::var toVar (bool includeData) const;
+        juce::String toJson() const;
+    };
+
+    // Carga un .wtgen.json (o .json compatible) en un slot [0..3].
+    // phaseOverride: ignora p.phase del fichero (opción de carga)
+    bool loadWtgenSlot (int slot, const juce::File& file, juce::String& err,
+                        std::optional<PhaseMode> phaseOverride = std::nullopt);
+
+    // Igual, pero lectura + decode corren en el pool compartido (prioridad interactive)
+    // y la tabla se publica al terminar. onDone se llama en el message thread.
+    // La última carga pedida para un slot gana aunque otra termine después.
+    void loadWtgenSlotAsync (int slot, const juce::File& file,
+                             std::function<void (bool ok, const juce::String& err)> onDone,
+                             std::optional<PhaseMode> phaseOverride = std::nullopt);
+
+    // Carga de preset: varios slots como una sola transacción
+    struct SlotLoad
+    {
+        int slot = 0;
+        juce::File file;
+        std::optional<PhaseMode> phaseOverride;
+    };
+
+    // Los ficheros se leen y reconstruyen en paralelo en el pool y las tablas se
+    // publican juntas con un único swap bajo wtLock: el render nunca mezcla slots del
+    // preset anterior y del nuevo. Si una carga falla no se publica ninguna.
+    // Una fuente ya cargada (mismo WtSource::contentHash en cualquier slot) reutiliza
+    // su tabla sin reconstruirla.
+    bool loadWtgenSlots (const std::vector<SlotLoad>& loads, juce::String& err);
+
+    // Igual, como job del pool (prioridad interactive); onDone en el message thread
+    void loadWtgenSlotsAsync (std::vector<SlotLoad> loads,
+                              std::function<void (bool ok, const juce::String& err)> onDone);
 
     // Obtiene un slot puntual (puntero ref-counted)
     Wavetable::Ptr getWtSlot (int slot) const;
@@ -31,13 +209,51 @@ public:
     // Snapshot thread-safe de todos los slots (para no lockear por sample)
     void getWtSlotsSnapshot (std::array<Wavetable::Ptr, 4>& outSlots) const;
 
-    // Nombre y JSON guardado por slot (thread-safe)
+    // Nombre y fuente por slot (thread-safe)
     juce::String getWtSlotName (int index) const;
+    WtSource::Ptr getWtSlotSource (int index) const;
+
+    // Export explícito: regenera el JSON desde la fuente compacta
     juce::String getWtSlotJson (int index) const;
 
+    //==============================================================================
+    // Banco de programas (ProgramBank): presets decodificados de antemano, bajo un
+    // presupuesto de memoria. MIDI program change / setCurrentProgram cambian los 4
+    // slots de golpe en el audio thread si el programa ya es residente; si no, el
+    // cambio queda pendiente y el programa se carga con prioridad interactive.
+    bool loadProgramBank (const juce::File& bankFile, juce::String& err);
+    juce::File getProgramBankFile() const;
+    bool isProgramResident (int index) const;
+
+    //==============================================================================
+    // Memory accounting (bytes aproximados; llamar fuera del audio thread)
+    struct MemoryStats
+    {
+        size_t wavetableBytes = 0; // buffers Wavetable::table + frames compartidos (una vez)
+        size_t sourceBytes    = 0; // fuente compacta retenida por slot (WtSource)
+        size_t stateBytes     = 0; // strings retenidos en apvts.state
+        size_t voiceBytes     = 0; // voces del synth
+        size_t cacheBytes     = 0; // caches compartidos entre instancias
+        size_t duplicateBytes = 0; // contenido idéntico retenido más de una vez (ya incluido arriba)
+
+        int instances  = 0;
+        int wavetables = 0;
+
+        size_t getTotalBytes() const noexcept
+        {
+            return wavetableBytes + sourceBytes + stateBytes + voiceBytes + cacheBytes;
+        }
+    };
+
+    // Esta instancia
+    MemoryStats getMemoryStats() const;
+
+    // Todas las instancias vivas del proceso (objetos compartidos se cuentan una vez)
+    static MemoryStats getProcessMemoryStats();
+
     //==============================================================================
     BasicInstrumentAudioProcessor();
-    ~BasicInstrumentAudioProcessor() override = default;
+    ~BasicInstrumentAudioProcessor() override;
 
     const juce::String getName() const override;
 
@@ -73,10 +289,105 @@ private:
     mutable juce::SpinLock wtLock;
     std::array<Wavetable::Ptr, 4> wtSlots {};
     std::array<juce::String, 4>   wtSlotName {};
-    std::array<juce::String, 4>   wtSlotJson  {};
+    std::array<WtSource::Ptr, 4>  wtSlotSource {};
+
+    // Generación por slot: cada carga pedida la incrementa y solo publica la última
+    std::array<std::atomic<juce::uint32>, 4> wtSlotGeneration {};
+
+    // Lectura + decode en pipeline (WtgenLoader): la reconstrucción va al pool
+    // mientras el fichero aún se está leyendo
+    bool decodeWtgenFile (const juce::File& file, std::optional<PhaseMode> phaseOverride,
+                          tasks::Priority priority, const tasks::CancelFlag* cancelled,
+                          WtSource::Ptr& outSrc, Wavetable::Ptr& outWt, juce::String& err);
+
+    bool publishWtSlot (int slot, juce::uint32 generation, const Wavetable::Ptr& wt,
+                        const WtSource::Ptr& src, const juce::String& name);
+
+    // Transacción multi-slot (preset / restore): fuentes ya parseadas -> tablas
+    // reutilizadas por sourceHash o reconstruidas en paralelo -> un solo swap
+    struct SlotTransaction
+    {
+        struct Entry
+        {
+            int slot = 0;
+            juce::uint32 generation = 0;
+            WtSource::Ptr src;
+            Wavetable::Ptr wt;
+            juce::String name;
+            juce::String err; // vacío = ok
+
+            // Restauración de sesión: fuente/nombre que había antes de publicar la
+            // fuente por adelantado; vuelven al slot si el decode falla
+            bool sourcePublished = false;
+            WtSource::Ptr previousSrc;
+            juce::String previousName;
+        };
+
+        std::vector<Entry> entries;
+    };
+
+    // Rellena entry.wt / entry.err de cada entrada con fuente (false: alguna falló,
+    // err = la primera)
+    bool buildSlotTransaction (SlotTransaction& txn, tasks::Priority priority,
+                               const tasks::CancelFlag* cancelled, juce::String& err);
+
+    // Restauración de sesión en el pool (solo con audio en vivo). audioRunning: hay
+    // processBlock desde el último prepare/release. Un render offline que empieza
+    // con una restauración pendiente la espera (waitForSessionRestore)
+    std::atomic<bool> audioRunning { false };
+    std::atomic<int> restoresPending { 0 };
+    juce::WaitableEvent restoreDone;
+    void waitForSessionRestore();
+
+    // Slots cuya generación sigue vigente, bajo un único lock. Una entrada que no se
+    // pudo reconstruir (err / sin tabla) deja el slot como estaba
+    void publishWtSlots (const SlotTransaction& txn);
+
+    // Lectura + parse (JSON o binario) de los slots de un preset, en paralelo
+    bool readSlotTransaction (const std::vector<SlotLoad>& loads, SlotTransaction& txn,
+                              tasks::Priority priority, const tasks::CancelFlag* cancelled,
+                              juce::String& err);
+
+    // Valida slots [0..3] sin repetir y reserva la generación de cada uno
+    bool beginSlotTransaction (const std::vector<SlotLoad>& loads, SlotTransaction& txn, juce::String& err);
+
+    // Pool de decode compartido por todas las instancias (jobs de esta instancia:
+    // owner = this, se cancelan en el destructor)
+    juce::SharedResourcePointer<tasks::Scheduler> scheduler;
+
+    // Programas: el banco y el cambio O(1). requestedProgram lo escriben MIDI y el
+    // host; lo consume el primero que consiga el cambio (audio thread o timer)
+    std::unique_ptr<programs::Bank> programBank;
+    std::atomic<int> currentProgram { 0 };
+    std::atomic<int> requestedProgram { -1 };
+
+    // Slots desplazados por un cambio de programa: se sueltan en el message thread
+    // (un cambio en el audio thread nunca libera memoria). Mientras haya algo aquí
+    // no se aceptan más cambios.
+    std::array<Wavetable::Ptr, 4> retiredSlots {};
+    std::array<WtSource::Ptr, 4>  retiredSources {};
+    std::array<juce::String, 4>   retiredNames {};
+    std::atomic<bool> retiredPending { false };
+
+    // Banco guardado en el estado: se aplica en el message thread (el host puede
+    // llamar a setStateInformation desde otro). alive: la llamada diferida no toca
+    // una instancia ya destruida (ambos lados corren en el message thread)
+    void restoreProgramBank (const juce::String& bankPath, int program);
+    std::shared_ptr<std::atomic<bool>> alive = std::make_shared<std::atomic<bool>> (true);
+
+    // Cualquier hilo (audio incluido): sin reservas ni liberaciones
+    bool trySwitchProgram (int index);
+    void releaseRetiredSlots();
+
+    void timerCallback() override;
+
+    struct MemoryCollector;
+    void collectMemory (MemoryCollector&) const;
 
     //==============================================================================
-    juce::Synthesiser synth;
+    // Synthesiser + drive por voz (PluginProcessor.cpp)
+    struct VoiceSynth;
+    std::unique_ptr<VoiceSynth> synth;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BasicInstrumentAudioProcessor)
 };
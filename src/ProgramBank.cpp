@@ -0,0 +1,454 @@
+/*
+  ==============================================================================
+
+    ProgramBank.cpp
+    - Bank of presets decoded ahead of time for instant program changes
+    - Resident programs kept under a memory budget, nearest to the current first
+
+  ==============================================================================
+*/
+
+#include "ProgramBank.h"
+#include "WtgenDecoder.h"
+#include "FrameStore.h"
+
+#include <algorithm>
+#include <set>
+
+namespace programs
+{
+    namespace
+    {
+        static constexpr juce::int64 maxBankFileBytes = 4 * 1024 * 1024;
+
+        static void addTableBytes (const Wavetable& wt,
+                                   std::set<const Wavetable*>& seenTables,
+                                   std::set<const Wavetable::SharedFrame*>& seenFrames,
+                                   size_t& bytes)
+        {
+            if (! seenTables.insert (&wt).second)
+                return;
+
+            bytes += wt.getMemoryBytes();
+
+            // Frames y mips del FrameStore
+            for (auto* frames : { &wt.sharedFrames, &wt.mipFrames })
+                for (auto& frame : *frames)
+                    if (frame != nullptr && seenFrames.insert (frame.get()).second)
+                        bytes += frame->getMemoryBytes();
+        }
+    }
+
+    //==============================================================================
+    size_t Program::getMemoryBytes() const
+    {
+        std::set<const Wavetable*> seenTables;
+        std::set<const Wavetable::SharedFrame*> seenFrames;
+        size_t bytes = sizeof (*this);
+
+        for (auto& wt : tables)
+            if (wt != nullptr)
+                addTableBytes (*wt, seenTables, seenFrames, bytes);
+
+        for (auto& src : sources)
+            if (src != nullptr)
+                bytes += src->getMemoryBytes();
+
+        return bytes;
+    }
+
+    //==============================================================================
+    Bank::Bank (tasks::Scheduler& s)
+        : scheduler (s), completed (std::make_shared<Completed>())
+    {
+    }
+
+    Bank::~Bank()
+    {
+        scheduler.cancel (this);
+    }
+
+    bool Bank::load (const juce::File& bankFile, juce::String& err)
+    {
+        if (! bankFile.existsAsFile())
+        {
+            err = "Bank file does not exist";
+            return false;
+        }
+
+        if (bankFile.getSize() > maxBankFileBytes)
+        {
+            err = "Bank file too large";
+            return false;
+        }
+
+        const auto root = juce::JSON::parse (bankFile.loadFileAsString());
+        if (root.getProperty ("schema", {}).toString() != "wtgen-bank-1")
+        {
+            err = "Not a wtgen-bank-1 file";
+            return false;
+        }
+
+        const auto* list = root.getProperty ("programs", {}).getArray();
+        if (list == nullptr || list->isEmpty())
+        {
+            err = "Bank has no programs";
+            return false;
+        }
+
+        if (list->size() > maxPrograms)
+        {
+            err = "Too many programs (max " + juce::String (maxPrograms) + ")";
+            return false;
+        }
+
+        const auto dir = bankFile.getParentDirectory();
+        std::vector<ProgramDef> newDefs;
+
+        for (int i = 0; i < list->size(); ++i)
+        {
+            const auto& p = list->getReference (i);
+
+            ProgramDef def;
+            def.name = p.getProperty ("name", {}).toString();
+            if (def.name.isEmpty())
+                def.name = "Program " + juce::String (i + 1);
+
+            if (const auto* slots = p.getProperty ("slots", {}).getArray())
+            {
+                if (slots->size() > 4)
+                {
+                    err = def.name + ": more than 4 slots";
+                    return false;
+                }
+
+                for (int k = 0; k < slots->size(); ++k)
+                {
+                    const auto path = slots->getReference (k).toString();
+                    if (path.isNotEmpty())
+                        def.files[(size_t) k] = dir.getChildFile (path);
+                }
+            }
+
+            if (p.hasProperty ("phase"))
+            {
+                PhaseMode mode = PhaseMode::minimum;
+                if (! wtgen::parsePhaseModeName (p.getProperty ("phase", {}).toString(), mode))
+                {
+                    err = def.name + ": unknown phase mode";
+                    return false;
+                }
+
+                def.phaseOverride = mode;
+            }
+
+            newDefs.push_back (def);
+        }
+
+        clear();
+
+        {
+            const std::lock_guard<std::mutex> sl (defsLock);
+            file = bankFile;
+            defs = std::move (newDefs);
+        }
+
+        knownBytes.assign (defs.size(), 0);
+        failed.assign (defs.size(), false);
+
+        {
+            const juce::SpinLock::ScopedLockType sl (residentLock);
+            resident.resize (defs.size());
+        }
+
+        numPrograms = (int) defs.size();
+        return true;
+    }
+
+    void Bank::clear()
+    {
+        // Precargas en curso: fuera; sus resultados van a la cola anterior
+        scheduler.cancel (this);
+        completed = std::make_shared<Completed>();
+        inFlight = -1;
+
+        std::vector<Program::Ptr> old;
+        {
+            const juce::SpinLock::ScopedLockType sl (residentLock);
+            old.swap (resident);
+        }
+
+        numPrograms = 0;
+        {
+            const std::lock_guard<std::mutex> sl (defsLock);
+            file = juce::File();
+            defs.clear();
+        }
+        knownBytes.clear();
+        failed.clear();
+        residentBytes = 0;
+    }
+
+    juce::File Bank::getFile() const
+    {
+        const std::lock_guard<std::mutex> sl (defsLock);
+        return file;
+    }
+
+    juce::String Bank::getProgramName (int index) const
+    {
+        const std::lock_guard<std::mutex> sl (defsLock);
+        if (! juce::isPositiveAndBelow (index, (int) defs.size()))
+            return {};
+
+        return defs[(size_t) index].name;
+    }
+
+    bool Bank::isResident (int index) const
+    {
+        const juce::SpinLock::ScopedLockType sl (residentLock);
+        return juce::isPositiveAndBelow (index, (int) resident.size())
+            && resident[(size_t) index] != nullptr;
+    }
+
+    std::vector<Wavetable::Ptr> Bank::getResidentTables() const
+    {
+        std::vector<Wavetable::Ptr> tables;
+
+        const juce::SpinLock::ScopedLockType sl (residentLock);
+        for (auto& p : resident)
+            if (p != nullptr)
+                for (auto& wt : p->tables)
+                    if (wt != nullptr)
+                        tables.push_back (wt);
+
+        return tables;
+    }
+
+    //==============================================================================
+    std::vector<int> Bank::getLoadOrder (int focus) const
+    {
+        const int n = (int) defs.size();
+        focus = juce::jlimit (0, n - 1, focus);
+
+        // focus, focus + 1, focus - 1, focus + 2, ... (los siguientes primero: tocar en orden)
+        std::vector<int> order;
+        order.reserve ((size_t) n);
+        order.push_back (focus);
+
+        for (int d = 1; (int) order.size() < n; ++d)
+        {
+            if (focus + d < n)  order.push_back (focus + d);
+            if (focus - d >= 0) order.push_back (focus - d);
+        }
+
+        return order;
+    }
+
+    void Bank::collectCompleted()
+    {
+        std::vector<std::pair<int, Program::Ptr>> results;
+        {
+            const std::lock_guard<std::mutex> sl (completed->lock);
+            results.swap (completed->results);
+        }
+
+        for (auto& r : results)
+        {
+            const int index = r.first;
+            if (index == inFlight)
+                inFlight = -1;
+
+            if (! juce::isPositiveAndBelow (index, (int) defs.size()))
+                continue;
+
+            if (r.second == nullptr)
+            {
+                failed[(size_t) index] = true;
+                continue;
+            }
+
+            knownBytes[(size_t) index] = juce::jmax ((size_t) 1, r.second->getMemoryBytes());
+
+            // El anterior (si lo hubiera) se suelta fuera del lock, al salir de r
+            const juce::SpinLock::ScopedLockType sl (residentLock);
+            std::swap (resident[(size_t) index], r.second);
+        }
+    }
+
+    void Bank::recomputeResidentBytes()
+    {
+        std::set<const Wavetable*> seenTables;
+        std::set<const Wavetable::SharedFrame*> seenFrames;
+        size_t bytes = 0;
+
+        for (auto& p : resident)
+        {
+            if (p == nullptr)
+                continue;
+
+            for (auto& wt : p->tables)
+                if (wt != nullptr)
+                    addTableBytes (*wt, seenTables, seenFrames, bytes);
+
+            for (auto& src : p->sources)
+                if (src != nullptr)
+                    bytes += src->getMemoryBytes();
+        }
+
+        residentBytes = bytes;
+    }
+
+    void Bank::update (int focus, int requested)
+    {
+        if (defs.empty())
+            return;
+
+        collectCompleted();
+
+        auto order = getLoadOrder (focus);
+        if (juce::isPositiveAndBelow (requested, (int) defs.size()))
+        {
+            order.erase (std::find (order.begin(), order.end(), requested));
+            order.insert (order.begin(), requested);
+        }
+
+        // Programas aún sin decodificar: se estiman con la media de los ya vistos
+        size_t knownSum = 0;
+        size_t numKnown = 0;
+        for (auto b : knownBytes)
+        {
+            if (b > 0)
+            {
+                knownSum += b;
+                ++numKnown;
+            }
+        }
+
+        const size_t estimate = numKnown > 0 ? knownSum / numKnown : 0;
+
+        // Lo que cabe en el presupuesto, del más cercano al más lejano (el primero siempre)
+        std::vector<bool> desired (defs.size(), false);
+        size_t total = 0;
+
+        for (auto index : order)
+        {
+            const auto bytes = knownBytes[(size_t) index] > 0 ? knownBytes[(size_t) index] : estimate;
+            if (total > 0 && total + bytes > budgetBytes)
+                break;
+
+            desired[(size_t) index] = true;
+            total += bytes;
+        }
+
+        // Fuera de presupuesto: se sueltan aquí, en el message thread
+        std::vector<Program::Ptr> evicted;
+        {
+            const juce::SpinLock::ScopedLockType sl (residentLock);
+            for (size_t i = 0; i < resident.size(); ++i)
+                if (resident[i] != nullptr && ! desired[i])
+                    evicted.push_back (std::move (resident[i]));
+        }
+
+        recomputeResidentBytes();
+
+        // Frames que solo usaban los programas desalojados
+        if (! evicted.empty())
+        {
+            evicted.clear();
+            framestore::purgeUnused();
+        }
+
+        if (inFlight >= 0)
+            return;
+
+        for (auto index : order)
+        {
+            if (! desired[(size_t) index])
+                break;
+
+            if (resident[(size_t) index] == nullptr && ! failed[(size_t) index])
+            {
+                submitLoad (index, index == requested ? tasks::Priority::interactive
+                                                      : tasks::Priority::background);
+                break;
+            }
+        }
+    }
+
+    void Bank::submitLoad (int index, tasks::Priority priority)
+    {
+        inFlight = index;
+
+        // Tablas ya residentes: una fuente repetida entre programas se decodifica una vez
+        auto existing = getResidentTables();
+        auto done = completed;
+        auto& pool = scheduler;
+        const auto def = defs[(size_t) index];
+
+        scheduler.submit (this, priority,
+                          [index, priority, def, existing, done, &pool] (const tasks::CancelFlag& cancelled)
+        {
+            Program::Ptr program (new Program());
+            int numFiles = 0, numLoaded = 0;
+
+            for (auto& f : def.files)
+                if (f != juce::File())
+                    ++numFiles;
+
+            // Los 4 slots en paralelo; cada uno escribe solo su índice
+            std::array<bool, 4> loaded {};
+            pool.parallelFor (4, priority, 0, [&] (int begin, int end, int)
+            {
+                for (int k = begin; k < end; ++k)
+                {
+                    const auto& f = def.files[(size_t) k];
+                    if (f == juce::File() || cancelled)
+                        continue;
+
+                    juce::String err;
+                    WtSource::Ptr src;
+                    if (! wtgen::readWtgenFile (f, def.phaseOverride, {}, src, err))
+                        continue;
+
+                    Wavetable::Ptr wt;
+                    for (auto& t : existing)
+                    {
+                        if (t->sourceHash == src->contentHash)
+                        {
+                            wt = t;
+                            break;
+                        }
+                    }
+
+                    if (wt == nullptr)
+                    {
+                        if (! wtgen::buildWavetableFromSource (*src, {}, wt, err, &cancelled))
+                            continue;
+
+                        framestore::intern (*wt);
+                    }
+
+                    program->tables[(size_t) k]    = wt;
+                    program->sources[(size_t) k]   = src;
+                    program->slotNames[(size_t) k] = f.getFileName();
+                    loaded[(size_t) k] = true;
+                }
+            });
+
+            if (cancelled)
+                return;
+
+            for (auto ok : loaded)
+                numLoaded += ok ? 1 : 0;
+
+            // Un slot que no se puede leer queda vacío (forma built-in); si no se pudo
+            // leer ninguno, el programa se marca como fallido
+            if (numFiles > 0 && numLoaded == 0)
+                program = nullptr;
+
+            const std::lock_guard<std::mutex> sl (done->lock);
+            done->results.emplace_back (index, program);
+        });
+    }
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <JuceHeader.h>
+
+#include "PluginProcessor.h"
+#include "TaskScheduler.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+//==============================================================================
+// Banco de programas (presets) precargados para cambio instantáneo por MIDI
+//
+// Fichero de banco (wtgen-bank-1), rutas relativas al propio fichero:
+//   { "schema": "wtgen-bank-1",
+//     "programs": [ { "name": "Pad", "slots": [ "pad.wtgen.json", null, ... ],
+//                     "phase": "zero" }, ... ] }
+//
+// Las tablas de los programas se decodifican en el pool (prioridad background;
+// interactive para el programa que se está pidiendo), empezando por el programa
+// actual y hacia fuera, mientras quepan en el presupuesto de memoria. Al moverse
+// el programa actual se descartan los más lejanos.
+//
+// withResident() es O(1) y apto para el audio thread: try-lock + acceso al
+// programa ya construido, sin reservas ni liberaciones. load / clear / update corren
+// en el message thread (update() desde un timer); las consultas (nombre, fichero,
+// residente) valen desde cualquier hilo.
+namespace programs
+{
+    using Wavetable = BasicInstrumentAudioProcessor::Wavetable;
+    using WtSource  = BasicInstrumentAudioProcessor::WtSource;
+    using PhaseMode = BasicInstrumentAudioProcessor::PhaseMode;
+
+    static constexpr int maxPrograms = 128; // rango de MIDI program change
+    static constexpr size_t defaultBudgetBytes = (size_t) 256 * 1024 * 1024;
+
+    // Programa tal como viene del fichero de banco
+    struct ProgramDef
+    {
+        juce::String name;
+        std::array<juce::File, 4> files {}; // File() = slot vacío
+        std::optional<PhaseMode> phaseOverride;
+    };
+
+    // Programa decodificado; inmutable una vez residente
+    struct Program : public juce::ReferenceCountedObject
+    {
+        using Ptr = juce::ReferenceCountedObjectPtr<Program>;
+
+        std::array<Wavetable::Ptr, 4> tables {};
+        std::array<WtSource::Ptr, 4>  sources {};
+        std::array<juce::String, 4>   slotNames {};
+
+        // Tablas + frames compartidos (cada uno una vez)
+        size_t getMemoryBytes() const;
+    };
+
+    class Bank
+    {
+    public:
+        explicit Bank (tasks::Scheduler& scheduler);
+        ~Bank();
+
+        // Message thread. Sustituye el banco entero (los programas residentes se sueltan)
+        bool load (const juce::File& bankFile, juce::String& err);
+        void clear();
+
+        // Cualquier hilo (el host pide nombres desde el suyo)
+        juce::File getFile() const;
+        int getNumPrograms() const noexcept { return numPrograms.load(); }
+        juce::String getProgramName (int index) const;
+
+        void setMemoryBudget (size_t bytes) { budgetBytes = bytes; }
+        size_t getMemoryBudget() const noexcept { return budgetBytes; }
+
+        // Bytes retenidos por los programas residentes (tablas compartidas una vez)
+        size_t getResidentBytes() const noexcept { return residentBytes; }
+        bool isResident (int index) const;
+
+        // Tablas retenidas por el banco (memory accounting)
+        std::vector<Wavetable::Ptr> getResidentTables() const;
+
+        // Message thread, periódico: recoge precargas terminadas, descarta lo que no
+        // cabe y lanza la siguiente. requested: programa pedido aún no residente (-1: ninguno)
+        void update (int focus, int requested);
+
+        // Cualquier hilo, incluido el audio thread. fn (const Program&) -> bool se
+        // llama con el programa residente; false si no lo es o el banco está ocupado
+        template <typename Fn>
+        bool withResident (int index, Fn&& fn) const
+        {
+            const juce::SpinLock::ScopedTryLockType sl (residentLock);
+            if (! sl.isLocked() || ! juce::isPositiveAndBelow (index, (int) resident.size()))
+                return false;
+
+            if (auto* p = resident[(size_t) index].get())
+                return fn (*p);
+
+            return false;
+        }
+
+    private:
+        struct Completed
+        {
+            std::mutex lock;
+            std::vector<std::pair<int, Program::Ptr>> results; // (índice, programa o nullptr)
+        };
+
+        void collectCompleted();
+        void recomputeResidentBytes();
+        void submitLoad (int index, tasks::Priority priority);
+        std::vector<int> getLoadOrder (int focus) const;
+
+        tasks::Scheduler& scheduler;
+
+        // Escritura solo en el message thread bajo defsLock; los demás hilos leen con el
+        // lock (el message thread, que es quien escribe, lee sin él)
+        mutable std::mutex defsLock;
+        juce::File file;
+        std::vector<ProgramDef> defs;
+        std::atomic<int> numPrograms { 0 };
+
+        // Escritura solo en el message thread bajo residentLock; el audio thread lee con try-lock
+        mutable juce::SpinLock residentLock;
+        std::vector<Program::Ptr> resident;
+
+        std::vector<size_t> knownBytes; // tamaño real una vez decodificado (0: desconocido)
+        std::vector<bool>   failed;     // no se reintenta hasta recargar el banco
+        int inFlight = -1;              // una precarga a la vez
+
+        size_t budgetBytes   = defaultBudgetBytes;
+        size_t residentBytes = 0;
+
+        std::shared_ptr<Completed> completed;
+
+        JUCE_DECLARE_NON_COPYABLE (Bank)
+    };
+}
@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+
+    TaskScheduler.cpp
+    - Process-wide worker pool for non-realtime work (decode, scans)
+    - Priority classes, per-owner cancellation, caller-assisted parallelFor
+
+  ==============================================================================
+*/
+
+#include "TaskScheduler.h"
+
+#include <algorithm>
+
+namespace tasks
+{
+    Scheduler::Scheduler()
+    {
+        // Un núcleo queda para el audio / message thread
+        const int numWorkers = juce::jmax (1, juce::SystemStats::getNumCpus() - 1);
+
+        workers.reserve ((size_t) numWorkers);
+        for (int i = 0; i < numWorkers; ++i)
+            workers.emplace_back ([this] { workerLoop(); });
+    }
+
+    Scheduler::~Scheduler()
+    {
+        {
+            const std::lock_guard<std::mutex> sl (lock);
+            stopping = true;
+
+            for (auto& q : queues)
+                q.clear();
+        }
+
+        wake.notify_all();
+
+        for (auto& w : workers)
+            w.join();
+    }
+
+    bool Scheduler::hasPendingLocked() const noexcept
+    {
+        for (auto& q : queues)
+            if (! q.empty())
+                return true;
+
+        return false;
+    }
+
+    void Scheduler::submit (const void* owner, Priority priority, Job job)
+    {
+        if (job == nullptr)
+            return;
+
+        {
+            const std::lock_guard<std::mutex> sl (lock);
+            if (stopping)
+                return;
+
+            Task task;
+            task.owner = owner;
+            task.job = std::move (job);
+            task.cancelled = std::make_shared<CancelFlag> (false);
+
+            queues[(size_t) priority].push_back (std::move (task));
+        }
+
+        wake.notify_one();
+    }
+
+    void Scheduler::cancel (const void* owner)
+    {
+        if (owner == nullptr)
+            return;
+
+        std::unique_lock<std::mutex> sl (lock);
+
+        for (auto& q : queues)
+            q.erase (std::remove_if (q.begin(), q.end(), [owner] (const Task& t) { return t.owner == owner; }),
+                     q.end());
+
+        for (auto& r : running)
+            if (r.first == owner)
+                r.second->store (true);
+
+        finished.wait (sl, [this, owner]
+        {
+            return std::none_of (running.begin(), running.end(),
+                                 [owner] (const auto& r) { return r.first == owner; });
+        });
+    }
+
+    void Scheduler::workerLoop()
+    {
+        for (;;)
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> sl (lock);
+                wake.wait (sl, [this] { return stopping || hasPendingLocked(); });
+
+                if (stopping)
+                    return;
+
+                for (auto& q : queues)
+                {
+                    if (! q.empty())
+                    {
+                        task = std::move (q.front());
+                        q.pop_front();
+                        break;
+                    }
+                }
+
+                running.emplace_back (task.owner, task.cancelled);
+            }
+
+            task.job (*task.cancelled);
+
+            // Las capturas del job se liberan antes de que cancel() pueda volver
+            task.job = nullptr;
+
+            {
+                const std::lock_guard<std::mutex> sl (lock);
+                running.erase (std::find_if (running.begin(), running.end(),
+                                             [&task] (const auto& r) { return r.second == task.cancelled; }));
+            }
+
+            finished.notify_all();
+        }
+    }
+
+    //==============================================================================
+    void Scheduler::parallelFor (int count, Priority priority, int maxParallelism,
+                                 const std::function<void (int begin, int end, int worker)>& fn)
+    {
+        if (count <= 0)
+            return;
+
+        int parts = maxParallelism > 0 ? maxParallelism : getNumWorkers() + 1;
+        parts = juce::jlimit (1, count, parts);
+
+        if (parts == 1)
+        {
+            fn (0, count, 0);
+            return;
+        }
+
+        // Compartido con los helpers: un helper que arranca tarde (todo reclamado)
+        // sale sin tocar fn, que solo vive mientras el que llama espera
+        struct State
+        {
+            std::atomic<int> next { 0 };
+            std::atomic<int> done { 0 };
+            std::mutex doneLock;
+            std::condition_variable allDone;
+            const std::function<void (int, int, int)>* fn = nullptr;
+            int count = 0;
+            int parts = 0;
+
+            void runParts()
+            {
+                for (;;)
+                {
+                    const int p = next.fetch_add (1);
+                    if (p >= parts)
+                        return;
+
+                    const auto start = [this] (int i) { return (int) ((juce::int64) count * i / parts); };
+                    (*fn) (start (p), start (p + 1), p);
+
+                    if (done.fetch_add (1) + 1 == parts)
+                    {
+                        const std::lock_guard<std::mutex> sl (doneLock);
+                        allDone.notify_all();
+                    }
+                }
+            }
+        };
+
+        auto state = std::make_shared<State>();
+        state->fn = &fn;
+        state->count = count;
+        state->parts = parts;
+
+        for (int i = 1; i < parts; ++i)
+            submit (nullptr, priority, [state] (const CancelFlag&) { state->runParts(); });
+
+        state->runParts();
+
+        std::unique_lock<std::mutex> sl (state->doneLock);
+        state->allDone.wait (sl, [&state] { return state->done.load() == state->parts; });
+    }
+}
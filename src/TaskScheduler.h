@@ -0,0 +1,87 @@
+#pragma once
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//==============================================================================
+// Pool de hilos del proceso para trabajo no realtime: decode de wavetables,
+// thumbnails y escaneo de librerías.
+//
+// Se comparte vía juce::SharedResourcePointer<tasks::Scheduler>. Con 100
+// instancias sigue habiendo un solo pool de (núcleos - 1) hilos; se crea con la
+// primera instancia y se destruye con la última.
+//
+// Prioridades: cada worker atiende siempre la cola más alta que no esté vacía.
+//   interactive     slot que el usuario acaba de elegir
+//   sessionRestore  restaurar el estado de la sesión
+//   background      cache warming, scans
+//
+// Cancelación por owner (normalmente la instancia): cancel() descarta los jobs
+// pendientes, marca los que están corriendo y espera a que terminen.
+namespace tasks
+{
+    enum class Priority
+    {
+        interactive = 0,
+        sessionRestore,
+        background
+    };
+
+    static constexpr int numPriorities = 3;
+
+    // El job la consulta para abandonar trabajo largo tras un cancel()
+    using CancelFlag = std::atomic<bool>;
+    using Job = std::function<void (const CancelFlag& cancelled)>;
+
+    class Scheduler
+    {
+    public:
+        Scheduler();
+        ~Scheduler();
+
+        int getNumWorkers() const noexcept { return (int) workers.size(); }
+
+        // owner: clave de cancel() (nullptr: solo se descarta al destruir el pool)
+        void submit (const void* owner, Priority priority, Job job);
+
+        // No llamar desde un job del mismo owner (se esperaría a sí mismo)
+        void cancel (const void* owner);
+
+        // Reparte [0, count) en rangos contiguos (worker = índice de rango, para
+        // scratch por rango). El hilo que llama también consume rangos, así que
+        // termina aunque el pool esté ocupado o se llame desde un job.
+        // maxParallelism <= 0: workers + el que llama
+        void parallelFor (int count, Priority priority, int maxParallelism,
+                          const std::function<void (int begin, int end, int worker)>& fn);
+
+    private:
+        struct Task
+        {
+            const void* owner = nullptr;
+            Job job;
+            std::shared_ptr<CancelFlag> cancelled;
+        };
+
+        void workerLoop();
+        bool hasPendingLocked() const noexcept;
+
+        std::mutex lock;
+        std::condition_variable wake;     // workers: hay trabajo o stop
+        std::condition_variable finished; // cancel(): terminó un job
+        std::array<std::deque<Task>, numPriorities> queues;
+        std::vector<std::pair<const void*, std::shared_ptr<CancelFlag>>> running;
+        bool stopping = false;
+
+        std::vector<std::thread> workers;
+
+        JUCE_DECLARE_NON_COPYABLE (Scheduler)
+    };
+}
@@ -0,0 +1,540 @@
+#pragma once
+#include <JuceHeader.h>
+
+#include "BuiltinWavetables.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+//==============================================================================
+// Kernels de voz especializados en compile-time
+//
+// Cada combinación (máscara de osciladores activos x interpolación x mono/estéreo
+// x morph) es una instancia distinta; la voz elige una vez por bloque vía tabla de dispatch
+// y el loop por sample queda sin branches. La fase de cada sample se calcula como
+// frac(phase0 + j * delta), sin dependencia entre samples, para que el
+// compilador pueda vectorizar. Lo mismo para la mezcla entre frames en el modo
+// playback: frameMix + j * mixDelta.
+//
+// Las voces con modulación de fase entre osciladores (matriz PM) usan otro kernel:
+// 2x/4x sobremuestreado con decimación half-band, con la misma firma para que la voz
+// lo trate igual (ver renderPm / selectPm). Las voces agudas con tablas brillantes
+// corren el kernel normal sobremuestreado con los mismos decimadores (renderOversampled).
+//
+// El modo vector (XY) usa renderVector: los 4 slots como 4 lanes, siempre los 4, con
+// los pesos bilineales en rampa por sample.
+namespace kernels
+{
+    enum class Interp
+    {
+        linear = 0,
+        cubic
+    };
+
+    static constexpr int maxChunk = 64;
+
+    // Un oscilador ya resuelto para el bloque (tabla, frames a/b del morph, nivel)
+    struct Osc
+    {
+        const float* frameA = nullptr;
+        const float* frameB = nullptr;
+        int   mask     = 0;    // tamaño de frameA - 1 (potencia de 2)
+        float size     = 0.0f; // tamaño de frameA como float
+        int   maskB    = 0;    // frameB: puede ser de otro nivel de mip que frameA
+        float sizeB    = 0.0f;
+        float frameMix = 0.0f; // 0 = frameA, 1 = frameB
+        float mixDelta = 0.0f; // avance de frameMix por sample (playback; 0 = morph fijo)
+        float level    = 0.0f;
+        float levelDelta = 0.0f; // avance de level por sample (solo renderVector)
+        float phase    = 0.0f; // [0, 1)
+        float delta    = 0.0f; // ciclos/sample
+    };
+
+    struct PmState;
+
+    struct Args
+    {
+        std::array<Osc, 4> osc;
+        PmState* pm = nullptr; // solo kernels PM
+    };
+
+    //==============================================================================
+    static inline float frac (float x) noexcept
+    {
+        return x - (float) (int) x; // x >= 0
+    }
+
+    static inline float readLinear (const float* t, int mask, float idx) noexcept
+    {
+        const int i0 = (int) idx;
+        const float f = idx - (float) i0;
+        const float a = t[i0 & mask];
+        const float b = t[(i0 + 1) & mask];
+        return a + f * (b - a);
+    }
+
+    // 4-point, 3rd-order Hermite
+    static inline float readCubic (const float* t, int mask, float idx) noexcept
+    {
+        const int i1 = (int) idx;
+        const float f = idx - (float) i1;
+
+        const float y0 = t[(i1 - 1) & mask];
+        const float y1 = t[i1 & mask];
+        const float y2 = t[(i1 + 1) & mask];
+        const float y3 = t[(i1 + 2) & mask];
+
+        const float c1 = 0.5f * (y2 - y0);
+        const float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+        const float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+        return ((c3 * f + c2) * f + c1) * f + y1;
+    }
+
+    // Morph = false: frameA == frameB en todos los osc activos, una sola lectura
+    template <Interp I, bool Morph>
+    static inline float readMorph (const Osc& o, float phase01, float mix) noexcept
+    {
+        const float idx = phase01 * o.size;
+
+        if constexpr (! Morph)
+        {
+            if constexpr (I == Interp::cubic)
+                return readCubic (o.frameA, o.mask, idx);
+            else
+                return readLinear (o.frameA, o.mask, idx);
+        }
+        else if constexpr (I == Interp::cubic)
+        {
+            const float a = readCubic (o.frameA, o.mask, idx);
+            const float b = readCubic (o.frameB, o.maskB, phase01 * o.sizeB);
+            return a + mix * (b - a);
+        }
+        else
+        {
+            const float a = readLinear (o.frameA, o.mask, idx);
+            const float b = readLinear (o.frameB, o.maskB, phase01 * o.sizeB);
+            return a + mix * (b - a);
+        }
+    }
+
+    template <int K, int OscMask, Interp I, bool Morph>
+    static inline void addOsc (const Args& args, float j, float& mix) noexcept
+    {
+        if constexpr ((OscMask & (1 << K)) != 0)
+        {
+            // El sample j usa phase0 + j * delta (sin recurrencia entre samples)
+            const auto& o = args.osc[(size_t) K];
+            const float frameMix = Morph ? o.frameMix + j * o.mixDelta : 0.0f;
+            mix += readMorph<I, Morph> (o, frac (o.phase + j * o.delta), frameMix) * o.level;
+        }
+    }
+
+    // Trae una fila de frame a cache antes de que el playback cruce a ella
+    static inline void prefetchRow (const float* row, int numSamples) noexcept
+    {
+       #if defined (__GNUC__) || defined (__clang__)
+        for (int i = 0; i < numSamples; i += 16) // una línea de 64 bytes
+            __builtin_prefetch (row + i);
+       #else
+        juce::ignoreUnused (row, numSamples);
+       #endif
+    }
+
+    //==============================================================================
+    // Suma (osc activos * nivel) * gain[j] en outL/outR y avanza las fases de los 4 osc.
+    // gain ya incluye envolvente, velocity y master.
+    template <int OscMask, Interp I, bool Stereo, bool Morph>
+    static void render (Args& args, const float* gain, float* outL, float* outR, int numSamples) noexcept
+    {
+        for (int j = 0; j < numSamples; ++j)
+        {
+            const float fj = (float) j;
+            float mix = 0.0f;
+
+            addOsc<0, OscMask, I, Morph> (args, fj, mix);
+            addOsc<1, OscMask, I, Morph> (args, fj, mix);
+            addOsc<2, OscMask, I, Morph> (args, fj, mix);
+            addOsc<3, OscMask, I, Morph> (args, fj, mix);
+
+            const float s = mix * gain[j];
+            outL[j] += s;
+
+            if constexpr (Stereo)
+                outR[j] += s;
+        }
+
+        for (auto& o : args.osc)
+            o.phase = frac (o.phase + (float) numSamples * o.delta);
+    }
+
+    //==============================================================================
+    // Modo vector: los 4 slots como las 4 lanes de un vector. Mezcla = sum (lectura * peso)
+    // con los pesos (bilineales del punto XY) en rampa: level + j * levelDelta. Se va por
+    // bloques en pasadas separadas, como el waveshaper: fases y pesos de las 4 lanes a la
+    // vez (loop interno de 4, que el compilador hace una operación vectorial por sample),
+    // lecturas de tabla escalares (gather) y producto escalar por sample
+    template <Interp I, bool Stereo, bool Morph>
+    static void renderVector (Args& args, const float* gain, float* outL, float* outR, int numSamples) noexcept
+    {
+        constexpr int lanes = 4;
+        constexpr int blockFrames = maxChunk;
+
+        float phase0[lanes], delta[lanes], level0[lanes], levelDelta[lanes], mix0[lanes], mixDelta[lanes];
+        for (int k = 0; k < lanes; ++k)
+        {
+            const auto& o = args.osc[(size_t) k];
+            phase0[k]     = o.phase;
+            delta[k]      = o.delta;
+            level0[k]     = o.level;
+            levelDelta[k] = o.levelDelta;
+            mix0[k]       = o.frameMix;
+            mixDelta[k]   = o.mixDelta;
+        }
+
+        // [sample][lane]
+        float ph[blockFrames * lanes], w[blockFrames * lanes], mix[blockFrames * lanes], r[blockFrames * lanes];
+
+        for (int start = 0; start < numSamples; start += blockFrames)
+        {
+            const int n = juce::jmin (blockFrames, numSamples - start);
+
+            for (int j = 0; j < n; ++j)
+            {
+                const float fj = (float) (start + j);
+
+                for (int k = 0; k < lanes; ++k)
+                {
+                    ph[j * lanes + k]  = frac (phase0[k] + fj * delta[k]);
+                    w[j * lanes + k]   = level0[k] + fj * levelDelta[k];
+                    mix[j * lanes + k] = mix0[k] + fj * mixDelta[k];
+                }
+            }
+
+            for (int i = 0; i < n * lanes; ++i)
+                r[i] = readMorph<I, Morph> (args.osc[(size_t) (i & (lanes - 1))], ph[i], mix[i]);
+
+            for (int j = 0; j < n; ++j)
+            {
+                float s = 0.0f;
+                for (int k = 0; k < lanes; ++k)
+                    s += r[j * lanes + k] * w[j * lanes + k];
+
+                s *= gain[start + j];
+                outL[start + j] += s;
+
+                if constexpr (Stereo)
+                    outR[start + j] += s;
+            }
+        }
+
+        for (auto& o : args.osc)
+        {
+            o.phase = frac (o.phase + (float) numSamples * o.delta);
+            o.level += (float) numSamples * o.levelDelta;
+        }
+    }
+
+    //==============================================================================
+    // Decimador 2:1 half-band: FIR simétrico de 47 taps (Kaiser, beta 8). Los taps a
+    // distancia par del centro son cero, así que cada salida cuesta 12 multiplicaciones
+    // + el central. Plano hasta 0.2 fs de entrada, > 56 dB de rechazo desde 0.3 fs
+    struct Halfband
+    {
+        static constexpr int numTaps = 47;
+        static constexpr int centre  = numTaps / 2;
+        static constexpr int maxInput = maxChunk * 4;
+
+        // in: 2 * numOut samples; out: numOut
+        void process (const float* in, float* out, int numOut) noexcept
+        {
+            static constexpr float taps[(centre + 1) / 2] = {
+                3.160600265e-01f, -9.953366729e-02f, 5.323910908e-02f, -3.190591831e-02f,
+                1.951150296e-02f, -1.168527653e-02f, 6.670786169e-03f, -3.539435262e-03f,
+                1.690635467e-03f, -6.899972485e-04f, 2.146022812e-04f, -3.236778986e-05f
+            };
+
+            float work[numTaps - 1 + maxInput];
+            const int numIn = numOut * 2;
+
+            std::memcpy (work, history, sizeof (history));
+            std::memcpy (work + numTaps - 1, in, (size_t) numIn * sizeof (float));
+
+            for (int m = 0; m < numOut; ++m)
+            {
+                const float* x = work + 2 * m + 1 + centre;
+                float acc = 0.5f * x[0];
+
+                for (int i = 0; i < (centre + 1) / 2; ++i)
+                    acc += taps[i] * (x[-(2 * i + 1)] + x[2 * i + 1]);
+
+                out[m] = acc;
+            }
+
+            std::memcpy (history, work + numIn, sizeof (history));
+        }
+
+        void reset() noexcept
+        {
+            std::fill (std::begin (history), std::end (history), 0.0f);
+        }
+
+        float history[numTaps - 1] = {};
+    };
+
+    // Estado por voz de los caminos sobremuestreados: matriz PM, realimentación, sync
+    // a la tasa sobremuestreada y los decimadores (compartidos con renderOversampled,
+    // así que la voz puede pasar de un kernel a otro sin saltos de latencia)
+    struct PmState
+    {
+        // amount[m][c]: desplazamiento de fase de la portadora c, en ciclos por unidad
+        // de salida del modulador m (diagonal = feedback)
+        std::array<std::array<float, 4>, 4> amount {};
+        int runMask  = 0; // osc evaluados: audibles + sus moduladores
+        int syncMask = 0; // slaves con hard sync al osc 0
+
+        std::array<float, 4> prev {}; // salida del sample sobremuestreado anterior
+        Halfband stage1, stage2;      // 4x: stage1 (4x -> 2x) + stage2 (2x -> 1x)
+
+        // Corrección minBLEP del sync a la tasa sobremuestreada; [pending, end) == 0
+        float correction[Halfband::maxInput + builtin::blepTaps] = {};
+        int   pending = 0;
+
+        void reset() noexcept
+        {
+            prev = {};
+            stage1.reset();
+            stage2.reset();
+            std::fill (correction, correction + pending, 0.0f);
+            pending = 0;
+        }
+    };
+
+    //==============================================================================
+    // factor:1 (2 o 4) con los half-band de st; 4x = stage1 (4x -> 2x) + stage2
+    static inline void decimate (PmState& st, int factor, const float* os, float* out, int numOut) noexcept
+    {
+        if (factor >= 4)
+        {
+            float half[maxChunk * 2];
+            st.stage1.process (os, half, numOut * 2);
+            st.stage2.process (half, out, numOut);
+        }
+        else
+        {
+            st.stage1.process (os, out, numOut);
+        }
+    }
+
+    //==============================================================================
+    // Camino PM: Factor samples por sample del host. Cada osc lee su tabla en
+    // fase + sum (amount[m][k] * salida previa de m), por eso aquí las fases sí se
+    // acumulan sample a sample. El hard sync se resuelve dentro, en el sample
+    // sobremuestreado exacto, con la corrección minBLEP a esa tasa antes de decimar.
+    template <Interp I, bool Stereo, int Factor>
+    static void renderPm (Args& args, const float* gain, float* outL, float* outR, int numSamples) noexcept
+    {
+        static_assert (Factor == 2 || Factor == 4, "2x o 4x");
+
+        auto& st = *args.pm;
+        const int numOs = numSamples * Factor;
+        const float inv = 1.0f / (float) Factor;
+
+        float p[4], d[4];
+        for (int k = 0; k < 4; ++k)
+        {
+            p[k] = args.osc[(size_t) k].phase;
+            d[k] = args.osc[(size_t) k].delta * inv;
+        }
+
+        float os[Halfband::maxInput];
+
+        for (int i = 0; i < numOs; ++i)
+        {
+            const float t = (float) i * inv; // en samples del host (mezcla de frames)
+            float y[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            float mix = st.correction[i];
+
+            for (int k = 0; k < 4; ++k)
+            {
+                if ((st.runMask & (1 << k)) == 0)
+                    continue;
+
+                const auto& o = args.osc[(size_t) k];
+                float pm = 0.0f;
+                for (int m = 0; m < 4; ++m)
+                    pm += st.amount[(size_t) m][(size_t) k] * st.prev[(size_t) m];
+
+                const float ph = p[k] + pm;
+                y[k] = readMorph<I, true> (o, ph - std::floor (ph), o.frameMix + t * o.mixDelta);
+                mix += y[k] * o.level;
+            }
+
+            for (int k = 0; k < 4; ++k)
+            {
+                st.prev[(size_t) k] = y[k];
+                p[k] += d[k];
+            }
+
+            if (st.syncMask != 0 && p[0] >= 1.0f)
+            {
+                p[0] -= 1.0f;
+                const float since = juce::jlimit (0.0f, 1.0f, p[0] / d[0]); // hasta el sample i + 1
+
+                for (int k = 1; k < 4; ++k)
+                {
+                    if ((st.syncMask & (1 << k)) == 0)
+                        continue;
+
+                    const auto& o = args.osc[(size_t) k];
+                    const float mixAt = o.frameMix + t * o.mixDelta;
+                    const float atWrap = p[k] - since * d[k];
+                    const float before = readMorph<I, true> (o, atWrap - std::floor (atWrap), mixAt);
+                    const float after  = readMorph<I, true> (o, 0.0f, mixAt);
+
+                    p[k] = since * d[k];
+                    builtin::addBlepResidual (st.correction + i + 1, since, (after - before) * o.level);
+                    st.pending = juce::jmax (st.pending, i + 1 + builtin::blepTaps);
+                }
+            }
+
+            for (int k = 0; k < 4; ++k)
+                p[k] -= std::floor (p[k]);
+
+            os[i] = mix;
+        }
+
+        // Lo que queda de la corrección pasa a la siguiente llamada
+        if (st.pending > 0)
+        {
+            const int rest = juce::jmax (0, st.pending - numOs);
+            const int from = st.pending - rest;
+            std::memmove (st.correction, st.correction + from, (size_t) rest * sizeof (float));
+            std::fill (st.correction + rest, st.correction + st.pending, 0.0f);
+            st.pending = rest;
+        }
+
+        float dec[maxChunk];
+        decimate (st, Factor, os, dec, numSamples);
+
+        for (int j = 0; j < numSamples; ++j)
+        {
+            const float s = dec[j] * gain[j];
+            outL[j] += s;
+
+            if constexpr (Stereo)
+                outR[j] += s;
+        }
+
+        for (int k = 0; k < 4; ++k)
+            args.osc[(size_t) k].phase = p[k];
+    }
+
+    //==============================================================================
+    using RenderFn = void (*) (Args&, const float*, float*, float*, int) noexcept;
+
+    static constexpr int numKernels = 16 * 2 * 2 * 2; // mask x interp x stereo x morph
+
+    template <int Index>
+    static void renderAt (Args& a, const float* g, float* l, float* r, int n) noexcept
+    {
+        render<(Index & 15),
+               ((Index >> 4) & 1) != 0 ? Interp::cubic : Interp::linear,
+               ((Index >> 5) & 1) != 0,
+               ((Index >> 6) & 1) != 0> (a, g, l, r, n);
+    }
+
+    template <size_t... Is>
+    static constexpr std::array<RenderFn, sizeof... (Is)> makeDispatchTable (std::index_sequence<Is...>)
+    {
+        return { { &renderAt<(int) Is>... } };
+    }
+
+    // morph = false solo si todos los osc activos tienen frameA == frameB
+    static RenderFn select (int oscMask, Interp interp, bool stereo, bool morph) noexcept
+    {
+        static constexpr auto table = makeDispatchTable (std::make_index_sequence<numKernels>());
+
+        const int index = (oscMask & 15)
+                        | ((interp == Interp::cubic ? 1 : 0) << 4)
+                        | ((stereo ? 1 : 0) << 5)
+                        | ((morph ? 1 : 0) << 6);
+        return table[(size_t) index];
+    }
+
+    // Voz sin PM a factor x la tasa del host: el kernel normal (mono, ganancia 1) con
+    // delta y mixDelta divididos por factor, y después decimación. La envolvente se
+    // aplica a la tasa del host; fases y frameMix terminan igual que a 1x. Requiere Args::pm
+    static void renderOversampled (RenderFn render, int factor, Args& args, const float* gain,
+                                   float* outL, float* outR, int numSamples) noexcept
+    {
+        const int numOs = numSamples * factor;
+        const float inv = 1.0f / (float) factor;
+
+        float os[Halfband::maxInput], unity[Halfband::maxInput];
+        std::fill (os, os + numOs, 0.0f);
+        std::fill (unity, unity + numOs, 1.0f);
+
+        std::array<float, 4> delta, mixDelta, levelDelta;
+        for (size_t k = 0; k < 4; ++k)
+        {
+            delta[k]      = args.osc[k].delta;
+            mixDelta[k]   = args.osc[k].mixDelta;
+            levelDelta[k] = args.osc[k].levelDelta;
+            args.osc[k].delta      *= inv;
+            args.osc[k].mixDelta   *= inv;
+            args.osc[k].levelDelta *= inv;
+        }
+
+        render (args, unity, os, nullptr, numOs);
+
+        for (size_t k = 0; k < 4; ++k)
+        {
+            args.osc[k].delta      = delta[k];
+            args.osc[k].mixDelta   = mixDelta[k];
+            args.osc[k].levelDelta = levelDelta[k];
+        }
+
+        float dec[maxChunk];
+        decimate (*args.pm, factor, os, dec, numSamples);
+
+        for (int j = 0; j < numSamples; ++j)
+        {
+            const float s = dec[j] * gain[j];
+            outL[j] += s;
+
+            if (outR != nullptr)
+                outR[j] += s;
+        }
+    }
+
+    // Modo vector: siempre las 4 lanes (la máscara de osc no aplica)
+    static RenderFn selectVector (Interp interp, bool stereo, bool morph) noexcept
+    {
+        if (interp == Interp::cubic)
+        {
+            if (morph) return stereo ? &renderVector<Interp::cubic, true, true>  : &renderVector<Interp::cubic, false, true>;
+            return stereo ? &renderVector<Interp::cubic, true, false> : &renderVector<Interp::cubic, false, false>;
+        }
+
+        if (morph) return stereo ? &renderVector<Interp::linear, true, true>  : &renderVector<Interp::linear, false, true>;
+        return stereo ? &renderVector<Interp::linear, true, false> : &renderVector<Interp::linear, false, false>;
+    }
+
+    // Kernel PM (requiere Args::pm). factor: 2 o 4
+    static RenderFn selectPm (Interp interp, bool stereo, int factor) noexcept
+    {
+        const bool cubic = interp == Interp::cubic;
+
+        if (factor >= 4)
+        {
+            if (cubic) return stereo ? &renderPm<Interp::cubic, true, 4>  : &renderPm<Interp::cubic, false, 4>;
+            return stereo ? &renderPm<Interp::linear, true, 4> : &renderPm<Interp::linear, false, 4>;
+        }
+
+        if (cubic) return stereo ? &renderPm<Interp::cubic, true, 2>  : &renderPm<Interp::cubic, false, 2>;
+        return stereo ? &renderPm<Interp::linear, true, 2> : &renderPm<Interp::linear, false, 2>;
+    }
+}
@@ -0,0 +1,152 @@
+/*
+  ==============================================================================
+
+    Waveshaper.cpp
+    - Per-voice tanh drive with first-order antiderivative anti-aliasing
+    - Antiderivative and tanh tables generated once per process
+
+  ==============================================================================
+*/
+
+#include "Waveshaper.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    static constexpr float uMax    = 12.0f; // más allá: tanh = ±1, G = -log 2 (error < 1e-10)
+    static constexpr int   perUnit = 128;
+    static constexpr int   tableSize = (int) uMax * perUnit + 1;
+
+    // Escala de |du| en la que el cociente cede el paso a tanh del punto medio
+    static constexpr float minDelta = 1.0e-4f;
+
+    // Tablas en |u| (G es par, tanh impar)
+    struct Tables
+    {
+        Tables()
+        {
+            for (int i = 0; i < tableSize; ++i)
+            {
+                const double u = (double) i / (double) perUnit;
+
+                // log cosh (u) - u = log1p (e^-2u) - log 2, estable para u grande
+                g[(size_t) i]    = (float) (std::log1p (std::exp (-2.0 * u)) - std::log (2.0));
+                tanh[(size_t) i] = (float) std::tanh (u);
+            }
+        }
+
+        std::array<float, tableSize> g {};
+        std::array<float, tableSize> tanh {};
+    };
+
+    static const Tables& getTables()
+    {
+        static Tables tables;
+        return tables;
+    }
+
+    static inline float lookup (const std::array<float, tableSize>& t, float a) noexcept
+    {
+        const float pos = juce::jmin (a, uMax) * (float) perUnit;
+        const int i = juce::jmin ((int) pos, tableSize - 2);
+        const float f = pos - (float) i;
+        return t[(size_t) i] + f * (t[(size_t) i + 1] - t[(size_t) i]);
+    }
+
+    // G con Hermite cúbico (G' = tanh - 1, ya tabulada): G lineal por tramos haría de
+    // dF/du la pendiente de una secante dentro de cada celda => escalones con du pequeño
+    static inline float lookupG (const Tables& t, float a) noexcept
+    {
+        const float pos = juce::jmin (a, uMax) * (float) perUnit;
+        const int i = juce::jmin ((int) pos, tableSize - 2);
+        const float f = pos - (float) i;
+
+        const float g0 = t.g[(size_t) i],    g1 = t.g[(size_t) i + 1];
+        const float d0 = (t.tanh[(size_t) i] - 1.0f) / (float) perUnit;
+        const float d1 = (t.tanh[(size_t) i + 1] - 1.0f) / (float) perUnit;
+
+        const float f2 = f * f, f3 = f2 * f;
+        return g0 + (3.0f * f2 - 2.0f * f3) * (g1 - g0)
+                  + (f3 - 2.0f * f2 + f) * d0 + (f3 - f2) * d1;
+    }
+}
+
+//==============================================================================
+namespace shaper
+{
+    void prepare()
+    {
+        (void) getTables();
+    }
+
+    float getDriveGain (float drive) noexcept
+    {
+        return 1.0f + 24.0f * juce::jlimit (0.0f, 1.0f, drive); // hasta ~ +28 dB
+    }
+
+    float getDriveMix (float drive) noexcept
+    {
+        constexpr float fadeDrive = 0.05f;
+        return juce::jlimit (0.0f, 1.0f, drive / fadeDrive);
+    }
+
+    void process (float* lanes, int numSamples, float gain, float mix, State& state) noexcept
+    {
+        const auto& t = getTables();
+        const float makeup = 1.0f / std::tanh (gain);
+        const float eps2 = minDelta * minDelta;
+
+        // u, G: la primera fila (numLanes) es el frame anterior => "anterior" = i - numLanes
+        constexpr int blockFrames = 32;
+        constexpr int blockValues = blockFrames * numLanes;
+        float u[numLanes + blockValues], g[numLanes + blockValues], th[blockValues];
+
+        std::copy (state.u1.begin(), state.u1.end(), u);
+        std::copy (state.g1.begin(), state.g1.end(), g);
+
+        for (int start = 0; start < numSamples; start += blockFrames)
+        {
+            const int n = juce::jmin (blockFrames, numSamples - start) * numLanes;
+            float* x = lanes + start * numLanes;
+
+            for (int i = 0; i < n; ++i)
+                u[numLanes + i] = x[i] * gain;
+
+            // Lecturas de tabla (gather: escalar en SSE/NEON)
+            for (int i = 0; i < n; ++i)
+            {
+                g[numLanes + i] = lookupG (t, std::abs (u[numLanes + i]));
+                th[i] = lookup (t.tanh, std::abs (0.5f * (u[numLanes + i] + u[i])));
+            }
+
+            // ADAA sin branches, todas las lanes a la vez:
+            //   F (u) - F (u1) = (|u| - |u1|) + (G (u) - G (u1))
+            //   y = (dF * du + eps^2 * tanh (mid)) / (du^2 + eps^2)
+            // => dF / du si |du| >> eps, tanh del punto medio si du -> 0 (nunca divide por 0)
+            for (int i = 0; i < n; ++i)
+            {
+                const float un = u[numLanes + i];
+                const float du = un - u[i];
+                const float dF = (std::abs (un) - std::abs (u[i])) + (g[numLanes + i] - g[i]);
+                const float mid = std::copysign (th[i], un + u[i]);
+
+                const float y = (dF * du + eps2 * mid) / (du * du + eps2) * makeup;
+                x[i] += mix * (y - x[i]);
+            }
+
+            // El último frame pasa a ser el anterior del siguiente bloque
+            std::copy (u + n, u + n + numLanes, u);
+            std::copy (g + n, g + n + numLanes, g);
+        }
+
+        std::copy (u, u + numLanes, state.u1.begin());
+        std::copy (g, g + numLanes, state.g1.begin());
+    }
+
+    size_t getMemoryBytes() noexcept
+    {
+        return sizeof (Tables);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <JuceHeader.h>
+
+#include <array>
+
+//==============================================================================
+// Drive por voz: tanh con antialiasing por antiderivada (ADAA de primer orden).
+//
+//   y[n] = (F (u[n]) - F (u[n-1])) / (u[n] - u[n-1]),   F (u) = log cosh (u)
+//
+// con u = gain * x. Baja el aliasing del tanh sin sobremuestrear, al coste de dos
+// lecturas de tabla por sample (y medio sample de retardo). F se tabula una vez por proceso
+// como G (u) = F (u) - |u|, acotada en [-log 2, 0], para que la resta no pierda
+// precisión cuando u es grande, y se interpola con Hermite cúbico (G' = tanh - 1)
+// para que dF/du no sea escalonada dentro de cada celda.
+//
+// Se procesa a la vez una lane por voz (datos intercalados [sample][lane]). La
+// aritmética del ADAA va sin branches en loops planos sobre samples x lanes, que el
+// compilador vectoriza; solo las lecturas de tabla quedan escalares.
+namespace shaper
+{
+    static constexpr int numLanes = 8; // una por voz del synth
+
+    // Estado ADAA por lane: entrada anterior y su G
+    struct State
+    {
+        std::array<float, numLanes> u1 {};
+        std::array<float, numLanes> g1 {};
+    };
+
+    // Genera las tablas si aún no existen. Llamar fuera del audio thread
+    void prepare();
+
+    // drive (0, 1] -> ganancia antes del tanh (drive 0 = bypass, no llamar a process)
+    float getDriveGain (float drive) noexcept;
+
+    // drive -> proporción de señal procesada. Sube de 0 a 1 en el primer tramo de
+    // drive, para que al salir del bypass no salten el makeup (+2.4 dB en señales
+    // pequeñas con gain = 1) ni el medio sample de retardo del ADAA
+    float getDriveMix (float drive) noexcept;
+
+    // lanes: numSamples * numLanes samples intercalados; se sustituyen en sitio por
+    // tanh (gain * x) / tanh (gain) con ADAA (el pico a fondo de escala se mantiene),
+    // mezclado con la entrada: x + mix * (shaped - x)
+    void process (float* lanes, int numSamples, float gain, float mix, State& state) noexcept;
+
+    size_t getMemoryBytes() noexcept;
+}
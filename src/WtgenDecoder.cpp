@@ -0,0 +1,1627 @@
+/*
+  ==============================================================================
+
+    WtgenDecoder.cpp
+    - wtgen-1 JSON / WTGENBIN front ends + HNFPv1/v2 framepack decoder
+    - Validated, bounded-cost decode (DecodeLimits)
+    - Per-frame bandwidth and sparse mip chains of decoded tables
+
+  ==============================================================================
+*/
+
+#include "WtgenDecoder.h"
+#include "BatchedFft.h"
+#include "FftBackend.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//==============================================================================
+// Helpers (static, only inside this TU)
+namespace
+{
+    // ------------------------------
+    // Little-endian readers
+    static inline bool canRead (const juce::uint8* ptr, size_t size, size_t offset, size_t bytes)
+    {
+        return ptr != nullptr && offset <= size && bytes <= size - offset;
+    }
+
+    static inline juce::uint16 readLEU16 (const juce::uint8* ptr, size_t size, size_t& off)
+    {
+        if (! canRead (ptr, size, off, 2))
+            return 0;
+
+        const auto lo = (juce::uint16) ptr[off + 0];
+        const auto hi = (juce::uint16) ptr[off + 1];
+        off += 2;
+        return (juce::uint16) (lo | (hi << 8));
+    }
+
+    static inline juce::int16 readLEI16 (const juce::uint8* ptr, size_t size, size_t& off)
+    {
+        const auto u = readLEU16 (ptr, size, off);
+        return (juce::int16) u;
+    }
+
+    // ------------------------------
+    // JUCE var JSON navigation helpers
+    static juce::String varToString (const juce::var& v)
+    {
+        if (v.isString())
+            return v.toString();
+        return {};
+    }
+
+    static juce::var getProp (const juce::var& objVar, const juce::Identifier& key)
+    {
+        if (auto* obj = objVar.getDynamicObject())
+            return obj->getProperty (key);
+        return {};
+    }
+
+    static const juce::Array<juce::var>* getArray (const juce::var& v)
+    {
+        return v.getArray();
+    }
+
+    static juce::var arrayAt (const juce::var& arrVar, int index)
+    {
+        if (auto* arr = getArray (arrVar))
+            if (juce::isPositiveAndBelow (index, arr->size()))
+                return arr->getReference (index);
+        return {};
+    }
+
+    static bool isPowerOfTwo (int n)
+    {
+        return n > 0 && (n & (n - 1)) == 0;
+    }
+
+    static int log2OfPowerOfTwo (int n)
+    {
+        int order = 0;
+        while ((1 << order) < n)
+            ++order;
+        return order;
+    }
+
+    // ------------------------------
+    // Minimum-phase reconstruction from magnitude spectrum (real signal)
+    // Implements the standard real-cepstrum method.
+    static bool minimumPhaseFromMagRfft (fft::Engine& engine,
+                                         const std::vector<float>& magRfft, int N,
+                                         std::vector<fft::Complex>& X,
+                                         std::vector<float>& outTime)
+    {
+        if (N <= 0 || engine.getSize() != N)
+            return false;
+
+        const int nBins = (N / 2) + 1;
+        if ((int) magRfft.size() != nBins)
+            return false;
+
+        const float eps = 1.0e-12f;
+        using Complex = fft::Complex;
+
+        // Build full even log-magnitude spectrum (length N)
+        X.resize ((size_t) N);
+        for (int k = 0; k < N; ++k)
+        {
+            const int rk = (k <= N / 2) ? k : (N - k);
+            const float m = juce::jmax (magRfft[(size_t) rk], eps);
+            X[(size_t) k] = Complex (std::log (m), 0.0f);
+        }
+
+        // Real cepstrum: c = IFFT(log|X|) (la inversa ya viene escalada por 1/N)
+        engine.perform (X.data(), true);
+
+        // Minimum-phase cepstrum shaping
+        for (int n = 1; n < N; ++n)
+        {
+            if (n < N / 2)
+                X[(size_t) n] *= 2.0f;
+            else if (n > N / 2)
+                X[(size_t) n] = Complex (0.0f, 0.0f);
+        }
+
+        // Back to frequency domain: L = FFT(c_min)
+        engine.perform (X.data(), false);
+
+        // Exponentiate: H = exp(L)
+        for (int k = 0; k < N; ++k)
+        {
+            const float a = X[(size_t) k].real();
+            const float b = X[(size_t) k].imag();
+            const float ea = std::exp (a);
+            X[(size_t) k] = Complex (ea * std::cos (b), ea * std::sin (b));
+        }
+
+        // IFFT to get time-domain minimum-phase frame
+        engine.perform (X.data(), true);
+
+        outTime.resize ((size_t) N);
+        for (int n = 0; n < N; ++n)
+            outTime[(size_t) n] = X[(size_t) n].real();
+
+        return true;
+    }
+
+    // ------------------------------
+    // Zero/fixed-phase reconstruction: X[k] = |X[k]| * e^(i*phi[k]), una IFFT real.
+    // phaseCosSin vacío = fase cero. Lineal en la magnitud: la escala del FFT se
+    // absorbe en la normalización global de la tabla.
+    static bool fixedPhaseFromMagRfft (fft::Engine& engine,
+                                       const std::vector<float>& magRfft, int N,
+                                       const std::vector<float>& phaseCosSin,
+                                       std::vector<fft::Complex>& bins,
+                                       std::vector<float>& outTime)
+    {
+        if (N <= 0 || engine.getSize() != N)
+            return false;
+
+        const int nBins = (N / 2) + 1;
+        if ((int) magRfft.size() != nBins)
+            return false;
+
+        bins.resize ((size_t) nBins);
+
+        if (phaseCosSin.empty())
+        {
+            for (int k = 0; k < nBins; ++k)
+                bins[(size_t) k] = fft::Complex (magRfft[(size_t) k], 0.0f);
+        }
+        else
+        {
+            for (int k = 0; k < nBins; ++k)
+            {
+                const float m = magRfft[(size_t) k];
+                bins[(size_t) k] = fft::Complex (m * phaseCosSin[(size_t) (2 * k)],
+                                                 m * phaseCosSin[(size_t) (2 * k + 1)]);
+            }
+        }
+
+        outTime.resize ((size_t) N);
+        engine.inverseReal (bins.data(), outTime.data());
+        return true;
+    }
+
+    // Fases de Schroeder (factor de cresta bajo), iguales en todos los frames para
+    // que el morph entre frames no cancele armónicos
+    static std::vector<float> makeSchroederPhases (int nBins)
+    {
+        std::vector<float> cs ((size_t) nBins * 2, 0.0f);
+        const double pi = juce::MathConstants<double>::pi;
+        const double K = (double) juce::jmax (1, nBins - 1);
+
+        for (int k = 0; k < nBins; ++k)
+        {
+            const double phi = -pi * (double) k * (double) (k - 1) / K;
+            cs[(size_t) (2 * k)]     = (float) std::cos (phi);
+            cs[(size_t) (2 * k + 1)] = (float) std::sin (phi);
+        }
+        return cs;
+    }
+
+    static constexpr juce::uint8 framepackMagic[7]   = { 'H','N','F','P','v','1','\0' };
+    static constexpr juce::uint8 framepackMagicV2[7] = { 'H','N','F','P','v','2','\0' };
+    static constexpr juce::uint8 pcmFramesMagic[7]   = { 'P','C','M','F','v','1','\0' };
+
+    // ------------------------------
+    // rows * width valores u16 desde off: crudos (LE) o varint zigzag, y opcionalmente
+    // delta entre filas (HNFPv2, PCMFv1 int16)
+    static bool readPackedValues (const juce::uint8* bytes, size_t size, size_t off,
+                                  int rows, int width, int flags,
+                                  std::vector<juce::uint16>& values,
+                                  juce::String& err)
+    {
+        values.resize ((size_t) rows * (size_t) width);
+
+        if ((flags & wtgen::framepackVarint) != 0)
+        {
+            for (auto& v : values)
+            {
+                // Fast path: la mayoría de deltas caben en un byte
+                if (off < size && bytes[off] < 0x80)
+                {
+                    const juce::uint32 zz = bytes[off++];
+                    v = (juce::uint16) ((zz >> 1) ^ (0u - (zz & 1u)));
+                    continue;
+                }
+
+                juce::uint32 zz = 0;
+                for (int shift = 0;; shift += 7)
+                {
+                    if (off >= size || shift > 14)
+                    {
+                        err = "Corrupt data (varint)";
+                        return false;
+                    }
+
+                    const auto byte = bytes[off++];
+                    zz |= (juce::uint32) (byte & 0x7f) << shift;
+                    if ((byte & 0x80) == 0)
+                        break;
+                }
+
+                if (zz > 0xffff)
+                {
+                    err = "Corrupt data (varint out of range)";
+                    return false;
+                }
+
+                v = (juce::uint16) ((zz >> 1) ^ (0u - (zz & 1u)));
+            }
+        }
+        else
+        {
+            if (! canRead (bytes, size, off, values.size() * 2))
+            {
+                err = "Corrupt data (truncated)";
+                return false;
+            }
+
+            for (auto& v : values)
+                v = readLEU16 (bytes, size, off);
+        }
+
+        // Prefix sum entre filas: fila r += fila r-1 (u16 con wrap). Sin dependencia
+        // dentro de la fila, así que el loop interior vectoriza.
+        if ((flags & wtgen::framepackDelta) != 0)
+        {
+            for (int r = 1; r < rows; ++r)
+            {
+                auto* row = values.data() + (size_t) r * (size_t) width;
+                const auto* prev = row - width;
+                for (int i = 0; i < width; ++i)
+                    row[i] = (juce::uint16) (row[i] + prev[i]);
+            }
+        }
+
+        return true;
+    }
+
+    // ------------------------------
+    // Frame f del framepack -> magnitudes rfft (nBins). Lee desde el offset exacto del frame.
+    static void decodeFrameMagnitudes (const juce::uint8* bytes, size_t size,
+                                       const wtgen::FramepackHeader& header,
+                                       const std::vector<int>& edges,
+                                       int f, float* mag)
+    {
+        const int N = header.tableSize;
+        const int H = header.harmonics;
+        const int B = header.bands;
+        const int nBins = (N / 2) + 1;
+
+        size_t off = header.headerBytes + (size_t) f * header.frameBytes;
+        std::fill (mag, mag + nBins, 0.0f);
+
+        // Harmonics (u16); los que caen sobre Nyquist se saltan sin leer
+        const int usableH = juce::jmin (H, nBins - 1);
+        for (int h = 0; h < usableH; ++h)
+        {
+            const auto q = (float) readLEU16 (bytes, size, off);
+            const float harmAmpScaled = q / 4096.0f;                 // (mag * (2/N))
+            const float binMag = harmAmpScaled * ((float) N * 0.5f); // back to rfft magnitude
+            mag[1 + h] = binMag;
+        }
+        off += (size_t) (H - usableH) * 2;
+
+        // Noise bands (i16 dB*2)
+        for (int b = 0; b < B; ++b)
+        {
+            const auto qdb = (float) readLEI16 (bytes, size, off);
+            const float db = juce::jlimit (-240.0f, 40.0f, qdb * 0.5f); // i16 admite ±16383 dB: overflow a inf
+            const float rmsScaled = std::pow (10.0f, db / 20.0f);
+            const float binMag = rmsScaled * ((float) N * 0.5f);
+
+            const int a = edges[(size_t) b];
+            const int c = edges[(size_t) b + 1];
+            for (int k = a; k < c && k < nBins; ++k)
+                mag[k] = binMag;
+        }
+
+        // 3*u16 tilt params (ignored for now)
+
+        // Safety: DC and Nyquist to zero
+        mag[0] = 0.0f;
+        if (nBins > 1) mag[nBins - 1] = 0.0f;
+    }
+
+    // ------------------------------
+    // Reconstrucción por lotes de batched::lanes frames. Cada lote es independiente
+    // (solo lee el framepack y escribe sus propias filas de la tabla), así que los
+    // lotes se pueden repartir entre hilos con un Scratch por hilo.
+    struct FrameReconstructor
+    {
+        struct Scratch
+        {
+            std::vector<float> mags;                // lanes * nBins
+            std::vector<float> mag, time;
+            std::vector<fft::Complex> complexScratch;
+            std::unique_ptr<fft::Engine> engine;    // scratch propio: uno por hilo
+            batched::Scratch batch;
+        };
+
+        const juce::uint8* bytes = nullptr;
+        size_t size = 0;
+        wtgen::FramepackHeader header;
+        std::vector<int> edges;
+        wtgen::PhaseMode phaseMode = wtgen::PhaseMode::minimum;
+        std::vector<float> phaseCosSin;
+        std::unique_ptr<batched::FrameBatchFft> batchFft;
+        fft::Backend backend = fft::getDefaultBackend();
+        juce::AudioBuffer<float>* table = nullptr;
+
+        bool process (int firstFrame, int numFrames, Scratch& s) const
+        {
+            const int N = header.tableSize;
+            const int nBins = (N / 2) + 1;
+            numFrames = juce::jmin (numFrames, batched::lanes);
+
+            s.mags.resize ((size_t) batched::lanes * (size_t) nBins);
+            for (int i = 0; i < numFrames; ++i)
+                decodeFrameMagnitudes (bytes, size, header, edges, firstFrame + i,
+                                       s.mags.data() + (size_t) i * (size_t) nBins);
+
+            // Fase mínima: FFT / ventana cepstral / exp de todo el lote a la vez.
+            // Un frame suelto (tablas de 1 frame, cola) o sin batchFrames (sin
+            // batchFft) va por fft::Engine.
+            if (phaseMode == wtgen::PhaseMode::minimum && numFrames > 1 && batchFft != nullptr)
+            {
+                const float* mags[batched::lanes] = {};
+                float* out[batched::lanes] = {};
+                for (int i = 0; i < numFrames; ++i)
+                {
+                    mags[i] = s.mags.data() + (size_t) i * (size_t) nBins;
+                    out[i] = table->getWritePointer (firstFrame + i);
+                }
+
+                batched::minimumPhase (*batchFft, mags, out, numFrames, s.batch);
+                return true;
+            }
+
+            if (s.engine == nullptr || s.engine->getSize() != N)
+                s.engine = fft::create (log2OfPowerOfTwo (N), backend);
+            if (s.engine == nullptr)
+                return false;
+
+            for (int i = 0; i < numFrames; ++i)
+            {
+                const auto* src = s.mags.data() + (size_t) i * (size_t) nBins;
+                s.mag.assign (src, src + nBins);
+
+                const bool ok = (phaseMode == wtgen::PhaseMode::minimum)
+                                  ? minimumPhaseFromMagRfft (*s.engine, s.mag, N, s.complexScratch, s.time)
+                                  : fixedPhaseFromMagRfft (*s.engine, s.mag, N, phaseCosSin, s.complexScratch, s.time);
+                if (! ok)
+                    return false;
+
+                auto* dst = table->getWritePointer (firstFrame + i);
+                for (int n = 0; n < N; ++n)
+                    dst[n] = s.time[(size_t) n];
+            }
+            return true;
+        }
+    };
+}
+
+//==============================================================================
+namespace wtgen
+{
+    juce::uint64 hashBytes (const void* data, size_t numBytes, juce::uint64 h)
+    {
+        const auto* p = (const juce::uint8*) data;
+        for (size_t i = 0; i < numBytes; ++i)
+        {
+            h ^= (juce::uint64) p[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    juce::String getPhaseModeName (PhaseMode mode)
+    {
+        switch (mode)
+        {
+            case PhaseMode::zero:    return "zero";
+            case PhaseMode::fixed:   return "fixed";
+            case PhaseMode::minimum: break;
+        }
+        return "minimum";
+    }
+
+    bool parsePhaseModeName (const juce::String& name, PhaseMode& outMode)
+    {
+        if (name.isEmpty() || name == "minimum") { outMode = PhaseMode::minimum; return true; }
+        if (name == "zero")                      { outMode = PhaseMode::zero;    return true; }
+        if (name == "fixed")                     { outMode = PhaseMode::fixed;   return true; }
+        return false;
+    }
+
+    void updateSourceHash (WtSource& src)
+    {
+        const auto phase = (int) src.phaseMode;
+
+        juce::uint64 h = hashBytes (src.codec.toRawUTF8(), src.codec.getNumBytesAsUTF8());
+        h = hashBytes (&src.loBin, sizeof (src.loBin), h);
+        h = hashBytes (&src.hiBin, sizeof (src.hiBin), h);
+        h = hashBytes (&phase, sizeof (phase), h);
+        h = hashBytes (src.data.getData(), src.data.getSize(), h);
+        h = hashBytes (src.framesCodec.toRawUTF8(), src.framesCodec.getNumBytesAsUTF8(), h);
+        src.contentHash = hashBytes (src.frames.getData(), src.frames.getSize(), h);
+    }
+
+    bool readWtgenFile (const juce::File& file,
+                        std::optional<PhaseMode> phaseOverride,
+                        const DecodeLimits& limits,
+                        WtSource::Ptr& outSrc,
+                        juce::String& err)
+    {
+        outSrc = nullptr;
+
+        if (! file.existsAsFile())
+        {
+            err = "File does not exist";
+            return false;
+        }
+
+        if (file.getSize() > (juce::int64) limits.maxJsonBytes)
+        {
+            err = "File too large";
+            return false;
+        }
+
+        // El contenido solo vive durante el parse (JSON o contenedor binario)
+        juce::MemoryBlock contents;
+        if (! file.loadFileAsData (contents) || contents.getSize() == 0)
+        {
+            err = "Failed to read file";
+            return false;
+        }
+
+        const auto nameHint = file.getFileNameWithoutExtension();
+
+        WtSource::Ptr src;
+        if (isWtgenBinary (contents.getData(), contents.getSize()))
+        {
+            if (! parseWtgenBinary (contents.getData(), contents.getSize(), nameHint, limits, src, err))
+                return false;
+        }
+        else if (! parseWtgenJson (contents.toString(), nameHint, limits, src, err))
+            return false;
+
+        applyPhaseOverride (*src, phaseOverride);
+
+        outSrc = src;
+        return true;
+    }
+
+    void applyPhaseOverride (WtSource& src, std::optional<PhaseMode> phaseOverride)
+    {
+        if (! phaseOverride.has_value() || *phaseOverride == src.phaseMode || src.data.getSize() == 0)
+            return;
+
+        src.phaseMode = *phaseOverride;
+        src.framesCodec.clear();
+        src.frames.reset();
+        updateSourceHash (src);
+    }
+
+    std::vector<int> linearBandEdges (int loBin, int hiBin, int bands)
+    {
+        bands = juce::jmax (1, bands);
+        loBin = juce::jmax (0, loBin);
+        hiBin = juce::jmax (loBin, hiBin);
+
+        const int total = hiBin - loBin;
+        std::vector<int> edges;
+        edges.reserve ((size_t) bands + 1);
+
+        edges.push_back (loBin);
+        for (int i = 1; i < bands; ++i)
+        {
+            // floor(lo + i * total / bands)
+            const double t = (double) i / (double) bands;
+            const int edge = loBin + (int) std::floor (t * (double) total);
+            edges.push_back (edge);
+        }
+        edges.push_back (hiBin);
+        return edges;
+    }
+
+    //==============================================================================
+    bool parseFramepackHeader (const juce::uint8* bytes, size_t size,
+                               const DecodeLimits& limits,
+                               FramepackHeader& outHeader,
+                               juce::String& err,
+                               bool requirePayload)
+    {
+        outHeader = {};
+
+        size_t off = 0;
+        if (! canRead (bytes, size, off, sizeof (framepackMagic) + 4 * 2))
+        {
+            err = "Corrupt data (too small)";
+            return false;
+        }
+
+        FramepackHeader h;
+
+        if (std::memcmp (bytes + off, framepackMagic, sizeof (framepackMagic)) == 0)
+            h.version = 1;
+        else if (std::memcmp (bytes + off, framepackMagicV2, sizeof (framepackMagicV2)) == 0)
+            h.version = 2;
+        else
+        {
+            err = "Invalid magic (expected HNFPv1\\0 or HNFPv2\\0)";
+            return false;
+        }
+        off += sizeof (framepackMagic);
+
+        h.tableSize = (int) readLEU16 (bytes, size, off);
+        h.frames    = (int) readLEU16 (bytes, size, off);
+        h.harmonics = (int) readLEU16 (bytes, size, off);
+        h.bands     = (int) readLEU16 (bytes, size, off);
+
+        if (h.version == 2)
+        {
+            if (! canRead (bytes, size, off, 1))
+            {
+                err = "Corrupt data (too small)";
+                return false;
+            }
+
+            h.flags = (int) bytes[off++];
+            if ((h.flags & ~(framepackDelta | framepackVarint)) != 0)
+            {
+                err = "Unsupported HNFPv2 flags";
+                return false;
+            }
+        }
+
+        h.headerBytes = off;
+
+        if (h.tableSize <= 0 || h.frames <= 0)
+        {
+            err = "Invalid header (tableSize/frames)";
+            return false;
+        }
+        if (! isPowerOfTwo (h.tableSize))
+        {
+            err = "tableSize must be power-of-two (for FFT)";
+            return false;
+        }
+
+        // --- Límites: todo se decide con el header, antes de reservar nada
+        if (h.tableSize < limits.minTableSize || h.tableSize > limits.maxTableSize)
+        {
+            err = "tableSize out of range (" + juce::String (h.tableSize) + ")";
+            return false;
+        }
+        if (h.frames > limits.maxFrames)
+        {
+            err = "Too many frames (" + juce::String (h.frames) + ")";
+            return false;
+        }
+        if (h.harmonics > limits.maxHarmonics || h.bands > limits.maxBands)
+        {
+            err = "Too many harmonics/bands (H=" + juce::String (h.harmonics)
+                + ", B=" + juce::String (h.bands) + ")";
+            return false;
+        }
+
+        const auto tableSamples = (size_t) h.frames * (size_t) h.tableSize;
+        if (tableSamples > limits.maxTableSamples)
+        {
+            err = "Wavetable too large (" + juce::String ((juce::int64) tableSamples) + " samples)";
+            return false;
+        }
+
+        const double fftWork = (double) h.frames * (double) h.tableSize * (double) log2OfPowerOfTwo (h.tableSize);
+        if (fftWork > limits.maxFftWork)
+        {
+            err = "Decode cost over budget";
+            return false;
+        }
+
+        // Tamaño exacto esperado (varint: al menos 1 byte por valor)
+        h.frameBytes = (size_t) h.harmonics * 2 + (size_t) h.bands * 2 + 3 * 2;
+        h.totalBytes = h.headerBytes + (size_t) h.frames * h.frameBytes;
+
+        if ((h.flags & framepackVarint) != 0)
+            h.totalBytes = h.headerBytes + (size_t) h.frames * (size_t) h.getValuesPerFrame();
+
+        if (requirePayload && size < h.totalBytes)
+        {
+            err = "Corrupt data (truncated framepack)";
+            return false;
+        }
+
+        outHeader = h;
+        return true;
+    }
+
+    bool expandFramepack (const juce::uint8* bytes, size_t size,
+                          const FramepackHeader& header,
+                          const DecodeLimits& limits,
+                          juce::MemoryBlock& outV1,
+                          juce::String& err)
+    {
+        if (header.version != 2)
+        {
+            err = "Not an HNFPv2 framepack";
+            return false;
+        }
+
+        const int F = header.frames;
+        const int W = header.getValuesPerFrame();
+        const size_t v1HeaderBytes = sizeof (framepackMagic) + 4 * 2;
+        const size_t expandedBytes = v1HeaderBytes + (size_t) F * header.frameBytes;
+
+        if (expandedBytes > limits.maxDataBytes)
+        {
+            err = "Framepack too large";
+            return false;
+        }
+
+        // Valores [F][W] como u16 (i16 de las bandas va en complemento a 2)
+        std::vector<juce::uint16> values;
+        if (! readPackedValues (bytes, size, header.headerBytes, F, W, header.flags, values, err))
+            return false;
+
+        // Layout v1
+        outV1.setSize (expandedBytes, false);
+        auto* dst = (juce::uint8*) outV1.getData();
+
+        std::memcpy (dst, framepackMagic, sizeof (framepackMagic));
+        size_t o = sizeof (framepackMagic);
+        for (auto field : { header.tableSize, header.frames, header.harmonics, header.bands })
+        {
+            dst[o++] = (juce::uint8) (field & 0xff);
+            dst[o++] = (juce::uint8) ((field >> 8) & 0xff);
+        }
+
+        for (auto v : values)
+        {
+            dst[o++] = (juce::uint8) (v & 0xff);
+            dst[o++] = (juce::uint8) (v >> 8);
+        }
+
+        jassert (o == expandedBytes);
+        return true;
+    }
+
+    //==============================================================================
+    bool FramepackStream::advance (const juce::uint8* bytes, size_t available,
+                                   const DecodeLimits& limits, juce::String& err)
+    {
+        if (! headerReady)
+        {
+            // magic + 4 * u16 (+ flags en v2)
+            const size_t v1HeaderBytes = sizeof (framepackMagic) + 4 * 2;
+            if (available < v1HeaderBytes
+                 || (available == v1HeaderBytes
+                      && std::memcmp (bytes, framepackMagicV2, sizeof (framepackMagicV2)) == 0))
+                return true;
+
+            if (! parseFramepackHeader (bytes, available, limits, header, err, false))
+                return false;
+
+            const size_t expandedBytes = v1HeaderBytes + (size_t) header.frames * header.frameBytes;
+            if (expandedBytes > limits.maxDataBytes)
+            {
+                err = "Framepack too large";
+                return false;
+            }
+
+            v1.setSize (expandedBytes, true);
+            auto* dst = (juce::uint8*) v1.getData();
+
+            std::memcpy (dst, framepackMagic, sizeof (framepackMagic));
+            size_t o = sizeof (framepackMagic);
+            for (auto field : { header.tableSize, header.frames, header.harmonics, header.bands })
+            {
+                dst[o++] = (juce::uint8) (field & 0xff);
+                dst[o++] = (juce::uint8) ((field >> 8) & 0xff);
+            }
+
+            if (! parseFramepackHeader (dst, expandedBytes, limits, v1Header, err))
+                return false;
+
+            offset = header.headerBytes;
+            headerReady = true;
+        }
+
+        const int W = header.getValuesPerFrame();
+        const bool varint = (header.flags & framepackVarint) != 0;
+        const bool delta  = (header.flags & framepackDelta) != 0;
+        auto* v1Frames = (juce::uint8*) v1.getData() + v1Header.headerBytes;
+
+        while (framesReady < header.frames)
+        {
+            // Fin de la fila: sin varint es fijo; con varint, W bytes terminales (bit 7 a 0)
+            size_t end = offset + (size_t) W * 2;
+
+            if (varint)
+            {
+                int found = 0;
+                end = offset;
+                while (found < W && end < available)
+                    if ((bytes[end++] & 0x80) == 0)
+                        ++found;
+
+                if (found < W)
+                {
+                    // Como mucho 3 bytes por valor: más sin terminar es basura
+                    if (end - offset > (size_t) W * 3)
+                    {
+                        err = "Corrupt data (varint)";
+                        return false;
+                    }
+                    break;
+                }
+            }
+            else if (end > available)
+            {
+                break;
+            }
+
+            if (! readPackedValues (bytes, end, offset, 1, W, header.flags & ~framepackDelta, row, err))
+                return false;
+
+            if (delta && framesReady > 0)
+                for (int i = 0; i < W; ++i)
+                    row[(size_t) i] = (juce::uint16) (row[(size_t) i] + prevRow[(size_t) i]);
+
+            auto* dst = v1Frames + (size_t) framesReady * v1Header.frameBytes;
+            for (int i = 0; i < W; ++i)
+            {
+                dst[i * 2]     = (juce::uint8) (row[(size_t) i] & 0xff);
+                dst[i * 2 + 1] = (juce::uint8) (row[(size_t) i] >> 8);
+            }
+
+            std::swap (row, prevRow);
+            offset = end;
+            ++framesReady;
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    bool parsePcmFramesHeader (const juce::uint8* bytes, size_t size,
+                               const DecodeLimits& limits,
+                               PcmFramesHeader& outHeader,
+                               juce::String& err)
+    {
+        outHeader = {};
+
+        size_t off = 0;
+        if (! canRead (bytes, size, off, sizeof (pcmFramesMagic) + 2 * 2 + 2 + 4))
+        {
+            err = "Corrupt frames (too small)";
+            return false;
+        }
+
+        if (std::memcmp (bytes, pcmFramesMagic, sizeof (pcmFramesMagic)) != 0)
+        {
+            err = "Invalid magic (expected PCMFv1\\0)";
+            return false;
+        }
+        off += sizeof (pcmFramesMagic);
+
+        PcmFramesHeader h;
+        h.tableSize = (int) readLEU16 (bytes, size, off);
+        h.frames    = (int) readLEU16 (bytes, size, off);
+
+        const int format = bytes[off++];
+        h.flags = bytes[off++];
+
+        h.scale = juce::ByteOrder::littleEndianFloat (bytes + off);
+        off += 4;
+
+        if (format != (int) PcmFormat::int16 && format != (int) PcmFormat::float32)
+        {
+            err = "Unsupported frames sample format";
+            return false;
+        }
+        h.format = (PcmFormat) format;
+
+        if ((h.flags & ~(framepackDelta | framepackVarint | pcmFramesMips)) != 0
+             || (h.format == PcmFormat::float32 && (h.flags & ~pcmFramesMips) != 0))
+        {
+            err = "Unsupported frames flags";
+            return false;
+        }
+
+        // Tablas normalizadas: |q * scale| <= 32767 * |scale|; más que eso es basura
+        if (! std::isfinite (h.scale) || std::abs (h.scale) > 1.0f)
+        {
+            err = "Invalid frames scale";
+            return false;
+        }
+
+        if (h.tableSize <= 0 || h.frames <= 0 || ! isPowerOfTwo (h.tableSize))
+        {
+            err = "Invalid frames header (tableSize/frames)";
+            return false;
+        }
+        if (h.tableSize < limits.minTableSize || h.tableSize > limits.maxTableSize
+             || h.frames > limits.maxFrames
+             || (size_t) h.frames * (size_t) h.tableSize > limits.maxTableSamples)
+        {
+            err = "Frames out of range (N=" + juce::String (h.tableSize) + ", F=" + juce::String (h.frames) + ")";
+            return false;
+        }
+
+        const size_t rawBytesPerSample = h.format == PcmFormat::float32 ? 4 : 2;
+
+        // Anchos de banda precalculados: fijan qué mips hay y cuánto ocupan
+        if ((h.flags & pcmFramesMips) != 0)
+        {
+            if (! canRead (bytes, size, off, (size_t) h.frames * 2))
+            {
+                err = "Corrupt frames (truncated)";
+                return false;
+            }
+
+            const int levels = Wavetable::getNumMipLevels (h.tableSize);
+            size_t mipSamples = 0;
+
+            h.frameBandwidth.resize ((size_t) h.frames);
+            for (auto& bandwidth : h.frameBandwidth)
+            {
+                bandwidth = (int) readLEU16 (bytes, size, off);
+                if (bandwidth > h.tableSize / 2)
+                {
+                    err = "Invalid frames bandwidth";
+                    return false;
+                }
+
+                for (int m = 1; m < levels; ++m)
+                    if (bandwidth > Wavetable::getMipBandwidth (h.tableSize, m))
+                        mipSamples += (size_t) (h.tableSize >> m);
+            }
+
+            h.mipsOffset = off;
+            off += mipSamples * rawBytesPerSample;
+        }
+
+        h.headerBytes = off;
+
+        const auto samples = (size_t) h.frames * (size_t) h.tableSize;
+        const size_t bytesPerSample = (h.flags & framepackVarint) != 0 ? 1 : rawBytesPerSample;
+        h.totalBytes = h.headerBytes + samples * bytesPerSample;
+
+        if (size < h.totalBytes)
+        {
+            err = "Corrupt frames (truncated)";
+            return false;
+        }
+
+        outHeader = h;
+        return true;
+    }
+
+    //==============================================================================
+    // wtgen-1 (ya parseado) -> fuente. Nodos reconocidos en program.nodes:
+    //   "spectralData" (framepack HNFPv1/v2) y/o "timeFrames" (PCMFv1); al menos uno.
+    // rawData / rawFrames: payloads del contenedor binario; nullptr = base64 en el JSON.
+    static bool decodePayload (const juce::var& p, const juce::MemoryBlock* raw,
+                               const DecodeLimits& limits, juce::MemoryBlock& out,
+                               juce::String& err)
+    {
+        if (raw != nullptr)
+        {
+            if (raw->getSize() > limits.maxDataBytes)
+            {
+                err = "Payload too large";
+                return false;
+            }
+            out = *raw;
+            return true;
+        }
+
+        const auto dataB64 = varToString (getProp (p, "data"));
+        if (dataB64.isEmpty())
+        {
+            err = "Missing p.data";
+            return false;
+        }
+
+        // base64: 4 chars -> 3 bytes; comprobar antes de decodificar
+        if ((size_t) dataB64.length() / 4 * 3 > limits.maxDataBytes)
+        {
+            err = "Payload too large";
+            return false;
+        }
+
+        // Base64 decode into MemoryBlock
+        juce::MemoryOutputStream mo (out, false);
+        if (! juce::Base64::convertFromBase64 (mo, dataB64))
+        {
+            err = "Base64 decode failed";
+            return false;
+        }
+        mo.flush();
+        return true;
+    }
+
+    bool parseWtgenProgram (const juce::var& root,
+                            const juce::String& nameHint,
+                            const DecodeLimits& limits,
+                            const juce::MemoryBlock* rawData,
+                            const juce::MemoryBlock* rawFrames,
+                            WtSource::Ptr& outSrc,
+                            juce::String& err)
+    {
+        const auto schema = varToString (getProp (root, "schema"));
+        if (schema != "wtgen-1")
+        {
+            err = "Invalid schema (expected wtgen-1)";
+            return false;
+        }
+
+        const auto program = getProp (root, "program");
+        const auto nodes = getProp (program, "nodes");
+
+        juce::var spectral, timeFrames;
+        for (int i = 0; i < 2; ++i)
+        {
+            const auto node = arrayAt (nodes, i);
+            const auto op = varToString (getProp (node, "op"));
+
+            if (op == "spectralData" && spectral.isVoid())
+                spectral = node;
+            else if (op == "timeFrames" && timeFrames.isVoid())
+                timeFrames = node;
+        }
+
+        if (spectral.isVoid() && timeFrames.isVoid())
+        {
+            err = "Unsupported program.nodes (expected spectralData and/or timeFrames)";
+            return false;
+        }
+
+        auto src = WtSource::Ptr (new WtSource());
+        src->name = nameHint;
+
+        if (! spectral.isVoid())
+        {
+            const auto p = getProp (spectral, "p");
+            const auto codec = varToString (getProp (p, "codec"));
+            const int codecVersion = codec == codecFramepackV1 ? 1
+                                   : codec == codecFramepackV2 ? 2 : 0;
+            if (codecVersion == 0)
+            {
+                err = "Unsupported codec (expected harm-noise-framepack-v1/v2)";
+                return false;
+            }
+
+            src->codec = codec;
+
+            // Optional banding info (needed to spread noise bands)
+            {
+                const auto noise = getProp (p, "noise");
+                const auto banding = getProp (noise, "banding");
+                src->loBin = (int) getProp (banding, "loBin");
+                src->hiBin = (int) getProp (banding, "hiBin");
+            }
+
+            // Optional reconstruction mode (default minimum-phase)
+            if (! parsePhaseModeName (varToString (getProp (p, "phase")), src->phaseMode))
+            {
+                err = "Unsupported p.phase (expected minimum/zero/fixed)";
+                return false;
+            }
+
+            if (! decodePayload (p, rawData, limits, src->data, err))
+                return false;
+
+            // Header válido y dentro de límites antes de aceptar la fuente
+            FramepackHeader header;
+            if (! parseFramepackHeader ((const juce::uint8*) src->data.getData(), src->data.getSize(),
+                                        limits, header, err))
+                return false;
+
+            if (header.version != codecVersion)
+            {
+                err = "Framepack version does not match p.codec";
+                return false;
+            }
+        }
+
+        if (! timeFrames.isVoid())
+        {
+            const auto p = getProp (timeFrames, "p");
+            const auto codec = varToString (getProp (p, "codec"));
+            if (codec != codecPcmFramesV1)
+            {
+                err = "Unsupported timeFrames codec (expected pcm-frames-v1)";
+                return false;
+            }
+
+            // Sin datos espectrales, p.phase del nodo timeFrames solo es informativo
+            if (spectral.isVoid()
+                 && ! parsePhaseModeName (varToString (getProp (p, "phase")), src->phaseMode))
+            {
+                err = "Unsupported p.phase (expected minimum/zero/fixed)";
+                return false;
+            }
+
+            src->framesCodec = codec;
+            if (! decodePayload (p, rawFrames, limits, src->frames, err))
+                return false;
+
+            PcmFramesHeader header;
+            if (! parsePcmFramesHeader ((const juce::uint8*) src->frames.getData(), src->frames.getSize(),
+                                        limits, header, err))
+                return false;
+        }
+
+        updateSourceHash (*src);
+
+        outSrc = src;
+        return true;
+    }
+
+    bool parseWtgenJson (const juce::String& jsonText,
+                         const juce::String& nameHint,
+                         const DecodeLimits& limits,
+                         WtSource::Ptr& outSrc,
+                         juce::String& err)
+    {
+        outSrc = nullptr;
+
+        if (jsonText.getNumBytesAsUTF8() > limits.maxJsonBytes)
+        {
+            err = "File too large";
+            return false;
+        }
+
+        juce::var root;
+        const auto parseRes = juce::JSON::parse (jsonText, root);
+        if (parseRes.failed())
+        {
+            err = "JSON parse failed: " + parseRes.getErrorMessage();
+            return false;
+        }
+
+        return parseWtgenProgram (root, nameHint, limits, nullptr, nullptr, outSrc, err);
+    }
+
+    //==============================================================================
+    bool isWtgenBinary (const void* data, size_t size)
+    {
+        return data != nullptr && size >= sizeof (binaryMagic)
+                && std::memcmp (data, binaryMagic, sizeof (binaryMagic)) == 0;
+    }
+
+    bool parseWtgenBinary (const void* data, size_t size,
+                           const juce::String& nameHint,
+                           const DecodeLimits& limits,
+                           WtSource::Ptr& outSrc,
+                           juce::String& err)
+    {
+        outSrc = nullptr;
+
+        const auto* bytes = (const juce::uint8*) data;
+        if (! isWtgenBinary (data, size))
+        {
+            err = "Invalid magic (expected WTGENBIN)";
+            return false;
+        }
+        if (size > limits.maxJsonBytes)
+        {
+            err = "File too large";
+            return false;
+        }
+
+        size_t off = sizeof (binaryMagic);
+
+        const auto readU32 = [&] (juce::uint32& value)
+        {
+            if (! canRead (bytes, size, off, 4))
+                return false;
+            value = juce::ByteOrder::littleEndianInt (bytes + off);
+            off += 4;
+            return true;
+        };
+
+        juce::uint32 metaBytes = 0;
+        if (! readU32 (metaBytes) || ! canRead (bytes, size, off, metaBytes))
+        {
+            err = "Corrupt container (meta)";
+            return false;
+        }
+
+        if (! juce::CharPointer_UTF8::isValidString ((const char*) bytes + off, (int) metaBytes))
+        {
+            err = "Corrupt container (meta is not UTF-8)";
+            return false;
+        }
+
+        const auto metaText = juce::String::fromUTF8 ((const char*) bytes + off, (int) metaBytes);
+        off += metaBytes;
+
+        juce::uint32 dataBytes = 0;
+        if (! readU32 (dataBytes) || ! canRead (bytes, size, off, dataBytes))
+        {
+            err = "Corrupt container (data)";
+            return false;
+        }
+        if (dataBytes > limits.maxDataBytes)
+        {
+            err = "Framepack too large";
+            return false;
+        }
+
+        const juce::MemoryBlock raw (bytes + off, dataBytes);
+        off += dataBytes;
+
+        // Bloque opcional de frames precalculados
+        juce::MemoryBlock rawFrames;
+        if (off < size)
+        {
+            juce::uint32 framesBytes = 0;
+            if (! readU32 (framesBytes) || ! canRead (bytes, size, off, framesBytes))
+            {
+                err = "Corrupt container (frames)";
+                return false;
+            }
+            rawFrames.append (bytes + off, framesBytes);
+        }
+
+        juce::var root;
+        const auto parseRes = juce::JSON::parse (metaText, root);
+        if (parseRes.failed())
+        {
+            err = "JSON parse failed: " + parseRes.getErrorMessage();
+            return false;
+        }
+
+        return parseWtgenProgram (root, nameHint, limits, &raw, &rawFrames, outSrc, err);
+    }
+
+    //==============================================================================
+    static juce::uint64 hashTable (const Wavetable& wt)
+    {
+        const int N = wt.tableSize;
+        juce::uint64 h = hashBytes (&N, sizeof (N));
+        for (int f = 0; f < wt.frames; ++f)
+            h = hashBytes (wt.table.getReadPointer (f), (size_t) N * sizeof (float), h);
+        return h;
+    }
+
+    // Armónico más alto de cada frame por encima de -80 dB de su pico y, con el mismo
+    // espectro, la mip chain dispersa: el nivel m de un frame solo se genera si su
+    // ancho de banda pasa del límite del nivel (bins truncados + IFFT a tableSize >> m).
+    // Frames idénticos comparten sus mips
+    void buildMipChain (Wavetable& wt)
+    {
+        const int N = wt.tableSize;
+        const int F = wt.frames;
+        const int order = log2OfPowerOfTwo (N);
+
+        wt.frameBandwidth.assign ((size_t) F, 0);
+        wt.maxBandwidth = 0;
+
+        wt.mipLevels = Wavetable::getNumMipLevels (N);
+        const int L = wt.mipLevels;
+        wt.mipFrames.assign ((size_t) (F * L), nullptr);
+
+        auto engine = fft::create (order);
+        std::vector<std::unique_ptr<fft::Engine>> mipEngines ((size_t) L);
+        std::vector<fft::Complex> bins ((size_t) N / 2 + 1), mipBins ((size_t) N / 2 + 1);
+        std::vector<juce::uint64> frameHashes ((size_t) F);
+
+        for (int f = 0; f < F; ++f)
+        {
+            const auto* frame = wt.table.getReadPointer (f);
+            frameHashes[(size_t) f] = hashBytes (frame, (size_t) N * sizeof (float));
+
+            // Mismo contenido que un frame anterior: mismas medidas y mismos mips
+            const auto* first = std::find (frameHashes.data(), frameHashes.data() + f, frameHashes[(size_t) f]);
+            const int same = (int) (first - frameHashes.data());
+            if (same < f && std::memcmp (frame, wt.table.getReadPointer (same), (size_t) N * sizeof (float)) == 0)
+            {
+                wt.frameBandwidth[(size_t) f] = wt.frameBandwidth[(size_t) same];
+                std::copy_n (wt.mipFrames.begin() + same * L, L, wt.mipFrames.begin() + f * L);
+                continue;
+            }
+
+            engine->forwardReal (frame, bins.data());
+
+            float peak = 0.0f;
+            for (int h = 1; h <= N / 2; ++h)
+                peak = juce::jmax (peak, std::abs (bins[(size_t) h]));
+
+            const float threshold = peak * 1.0e-4f;
+            int top = 0;
+            for (int h = N / 2; h >= 1; --h)
+            {
+                if (std::abs (bins[(size_t) h]) > threshold)
+                {
+                    top = h;
+                    break;
+                }
+            }
+
+            wt.frameBandwidth[(size_t) f] = top;
+            wt.maxBandwidth = juce::jmax (wt.maxBandwidth, top);
+
+            for (int m = 1; m < L; ++m)
+            {
+                const int hMax = wt.getMipBandwidth (m);
+                if (top <= hMax)
+                    continue; // el frame completo ya cabe en este nivel
+
+                // forward sin escalar (N) -> inverse escalada por 1/size: bins * size / N
+                const int size = N >> m;
+                const float scale = (float) size / (float) N;
+
+                std::fill (mipBins.begin(), mipBins.begin() + size / 2 + 1, fft::Complex());
+                for (int h = 0; h <= hMax; ++h)
+                    mipBins[(size_t) h] = bins[(size_t) h] * scale;
+
+                auto& mipEngine = mipEngines[(size_t) m];
+                if (mipEngine == nullptr)
+                    mipEngine = fft::create (order - m);
+
+                // El hash lo pone framestore::intern
+                Wavetable::SharedFrame::Ptr mip (new Wavetable::SharedFrame());
+                mip->size = size;
+                mip->data.allocate ((size_t) size, false);
+                mipEngine->inverseReal (mipBins.data(), mip->data.get());
+                wt.mipFrames[(size_t) (f * L + m)] = mip;
+            }
+        }
+    }
+
+    // n muestras LE crudas de un payload pcm-frames-v1 -> float (false si alguna no es finita)
+    static bool readPcmSamples (const juce::uint8* p, PcmFormat format, float scale, int n, float* dst)
+    {
+        if (format == PcmFormat::int16)
+        {
+            for (int i = 0; i < n; ++i)
+                dst[i] = (float) (juce::int16) juce::ByteOrder::littleEndianShort (p + (size_t) i * 2) * scale;
+
+            return true;
+        }
+
+       #if JUCE_LITTLE_ENDIAN
+        std::memcpy (dst, p, (size_t) n * 4);
+       #else
+        for (int i = 0; i < n; ++i)
+            dst[i] = juce::ByteOrder::littleEndianFloat (p + (size_t) i * 4);
+       #endif
+
+        for (int i = 0; i < n; ++i)
+            if (! std::isfinite (dst[i]))
+                return false;
+
+        return true;
+    }
+
+    // Payload sin pcmFramesMips (anterior al flag): cota del ancho de banda de toda la
+    // tabla desde el header del framepack, si la fuente lo conserva. 0 = sin cota
+    static int getFramepackBandwidth (const WtSource& src, int tableSize, const DecodeLimits& limits)
+    {
+        if (src.data.getSize() == 0)
+            return 0;
+
+        FramepackHeader header;
+        juce::String ignored;
+        if (! parseFramepackHeader ((const juce::uint8*) src.data.getData(), src.data.getSize(),
+                                    limits, header, ignored, false)
+             || header.tableSize != tableSize)
+            return 0;
+
+        // Armónicos 1..H y, con bandas de ruido, hasta hiBin (por defecto Nyquist)
+        const int noiseTop = header.bands > 0 ? (src.hiBin > 0 ? src.hiBin : tableSize / 2) : 0;
+        return juce::jlimit (1, tableSize / 2, juce::jmax (header.harmonics, noiseTop));
+    }
+
+    // Frames precalculados -> tabla: memcpy (float32) o conversión (int16). El ancho
+    // de banda y los mips vienen en el payload (pcmFramesMips); sin ellos, la cota del
+    // framepack o sin medir, nunca una FFT en la carga
+    static bool buildWavetableFromFrames (const WtSource& src,
+                                          const DecodeLimits& limits,
+                                          Wavetable::Ptr& outWt,
+                                          juce::String& err,
+                                          const tasks::CancelFlag* cancelled)
+    {
+        const auto* bytes = (const juce::uint8*) src.frames.getData();
+        const auto size = (size_t) src.frames.getSize();
+
+        PcmFramesHeader header;
+        if (! parsePcmFramesHeader (bytes, size, limits, header, err))
+            return false;
+
+        const int N = header.tableSize;
+        const int F = header.frames;
+        const size_t bytesPerSample = header.format == PcmFormat::float32 ? 4 : 2;
+
+        auto wt = Wavetable::Ptr (new Wavetable());
+        wt->tableSize = N;
+        wt->frames = F;
+        wt->name = src.name.isNotEmpty() ? src.name : "Wavetable";
+        wt->table.setSize (F, N);
+
+        if (header.format == PcmFormat::float32)
+        {
+            for (int f = 0; f < F; ++f)
+            {
+                const auto* p = bytes + header.headerBytes + (size_t) f * (size_t) N * bytesPerSample;
+                if (! readPcmSamples (p, header.format, 1.0f, N, wt->table.getWritePointer (f)))
+                {
+                    err = "Non-finite sample in frames";
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            std::vector<juce::uint16> values;
+            if (! readPackedValues (bytes, size, header.headerBytes, F, N, header.flags, values, err))
+                return false;
+
+            const float scale = header.scale;
+            for (int f = 0; f < F; ++f)
+            {
+                const auto* q = values.data() + (size_t) f * (size_t) N;
+                auto* dst = wt->table.getWritePointer (f);
+                for (int i = 0; i < N; ++i)
+                    dst[i] = (float) (juce::int16) q[i] * scale;
+            }
+        }
+
+        if (! header.frameBandwidth.empty())
+        {
+            // Mips guardados en orden frame, nivel (parsePcmFramesHeader ya validó el tamaño)
+            wt->frameBandwidth = header.frameBandwidth;
+            wt->maxBandwidth = *std::max_element (wt->frameBandwidth.begin(), wt->frameBandwidth.end());
+            wt->mipLevels = Wavetable::getNumMipLevels (N);
+
+            const int L = wt->mipLevels;
+            wt->mipFrames.assign ((size_t) (F * L), nullptr);
+
+            const float scale = header.format == PcmFormat::float32 ? 1.0f : header.scale;
+            size_t off = header.mipsOffset;
+
+            for (int f = 0; f < F; ++f)
+            {
+                for (int m = 1; m < L; ++m)
+                {
+                    if (wt->frameBandwidth[(size_t) f] <= wt->getMipBandwidth (m))
+                        continue;
+
+                    Wavetable::SharedFrame::Ptr mip (new Wavetable::SharedFrame());
+                    mip->size = N >> m;
+                    mip->data.allocate ((size_t) mip->size, false);
+
+                    if (! readPcmSamples (bytes + off, header.format, scale, mip->size, mip->data.get()))
+                    {
+                        err = "Non-finite sample in frames";
+                        return false;
+                    }
+
+                    off += (size_t) mip->size * bytesPerSample;
+                    wt->mipFrames[(size_t) (f * L + m)] = mip;
+                }
+            }
+        }
+        else
+        {
+            // Sin mips: el sobremuestreo de la voz cubre los agudos
+            const int bound = getFramepackBandwidth (src, N, limits);
+            if (bound > 0)
+            {
+                wt->frameBandwidth.assign ((size_t) F, bound);
+                wt->maxBandwidth = bound;
+            }
+        }
+
+        wt->contentHash = hashTable (*wt);
+        wt->sourceHash = src.contentHash;
+
+        if (cancelled != nullptr && cancelled->load())
+        {
+            err = "Cancelled";
+            return false;
+        }
+
+        outWt = wt;
+        return true;
+    }
+
+    //==============================================================================
+    bool buildWavetableFromSource (const WtSource& src,
+                                   const DecodeLimits& limits,
+                                   Wavetable::Ptr& outWt,
+                                   juce::String& err,
+                                   const tasks::CancelFlag* cancelled)
+    {
+        outWt = nullptr;
+
+        // Frames precalculados: se usan tal cual (los datos espectrales quedan para edición)
+        if (src.frames.getSize() > 0)
+            return buildWavetableFromFrames (src, limits, outWt, err, cancelled);
+
+        if (src.data.getSize() == 0)
+        {
+            err = "No spectral data or frames";
+            return false;
+        }
+
+        const auto startMs = juce::Time::getMillisecondCounterHiRes();
+
+        auto* bytes = (const juce::uint8*) src.data.getData();
+        auto size = (size_t) src.data.getSize();
+
+        FramepackHeader header;
+        if (! parseFramepackHeader (bytes, size, limits, header, err))
+            return false;
+
+        // v2: se expande una vez al layout v1 y el resto del decode no cambia
+        juce::MemoryBlock expanded;
+        if (header.version == 2)
+        {
+            if (! expandFramepack (bytes, size, header, limits, expanded, err))
+                return false;
+
+            bytes = (const juce::uint8*) expanded.getData();
+            size = expanded.getSize();
+
+            if (! parseFramepackHeader (bytes, size, limits, header, err))
+                return false;
+        }
+
+        const int N = header.tableSize;
+        const int F = header.frames;
+
+        auto wt = Wavetable::Ptr (new Wavetable());
+        wt->tableSize = N;
+        wt->frames = F;
+        wt->name = src.name.isNotEmpty() ? src.name : "Wavetable";
+        wt->table.setSize (F, N);
+        wt->table.clear();
+
+        const FrameReconstruction rec (bytes, size, header, src.loBin, src.hiBin, src.phaseMode, limits, wt->table);
+
+        // Frames en streaming, de batched::lanes en batched::lanes
+        for (int f = 0; f < F; f += batched::lanes)
+        {
+            if (cancelled != nullptr && cancelled->load())
+            {
+                err = "Cancelled";
+                return false;
+            }
+
+            if (limits.maxDecodeSeconds > 0.0
+                 && (juce::Time::getMillisecondCounterHiRes() - startMs) > limits.maxDecodeSeconds * 1000.0)
+            {
+                err = "Decode time budget exceeded at frame " + juce::String (f);
+                return false;
+            }
+
+            if (! rec.process (f, juce::jmin (batched::lanes, F - f)))
+            {
+                err = "Frame reconstruction failed";
+                return false;
+            }
+        }
+
+        finaliseWavetable (*wt);
+        wt->sourceHash = src.contentHash;
+
+        outWt = wt;
+        return true;
+    }
+
+    //==============================================================================
+    struct FrameReconstruction::Impl
+    {
+        FrameReconstructor rec;
+
+        // Scratch reciclado entre llamadas (uno por llamada concurrente)
+        std::mutex scratchLock;
+        std::vector<std::unique_ptr<FrameReconstructor::Scratch>> scratchPool;
+    };
+
+    FrameReconstruction::FrameReconstruction (const juce::uint8* v1Bytes, size_t v1Size,
+                                              const FramepackHeader& v1Header,
+                                              int loBin, int hiBin, PhaseMode phaseMode,
+                                              const DecodeLimits& options,
+                                              juce::AudioBuffer<float>& table)
+        : impl (std::make_unique<Impl>())
+    {
+        const int N = v1Header.tableSize;
+        const int H = v1Header.harmonics;
+        const int B = v1Header.bands;
+        const int nBins = (N / 2) + 1;
+
+        if (hiBin <= 0)
+            hiBin = nBins - 1;
+        if (loBin <= 0)
+            loBin = juce::jlimit (0, nBins - 1, H + 1);
+
+        // Bandas fuera del espectro no aportan nada: acotar a [0, nBins)
+        hiBin = juce::jmin (hiBin, nBins - 1);
+        loBin = juce::jmin (loBin, hiBin);
+
+        // FFT por lotes compartido; el escalar (fft::Engine) vive en el Scratch, uno por hilo
+        auto& rec = impl->rec;
+        rec.bytes = v1Bytes;
+        rec.size = v1Size;
+        rec.header = v1Header;
+        rec.edges = linearBandEdges (loBin, hiBin, juce::jmax (1, B));
+        rec.phaseMode = phaseMode;
+        rec.backend = options.fftBackend;
+        rec.table = &table;
+        if (rec.phaseMode == PhaseMode::minimum && v1Header.frames > 1 && options.batchFrames)
+            rec.batchFft = std::make_unique<batched::FrameBatchFft> (log2OfPowerOfTwo (N));
+        if (rec.phaseMode == PhaseMode::fixed)
+            rec.phaseCosSin = makeSchroederPhases (nBins);
+    }
+
+    FrameReconstruction::~FrameReconstruction() = default;
+
+    bool FrameReconstruction::process (int firstFrame, int numFrames) const
+    {
+        std::unique_ptr<FrameReconstructor::Scratch> scratch;
+        {
+            const std::lock_guard<std::mutex> sl (impl->scratchLock);
+            if (! impl->scratchPool.empty())
+            {
+                scratch = std::move (impl->scratchPool.back());
+                impl->scratchPool.pop_back();
+            }
+        }
+
+        if (scratch == nullptr)
+            scratch = std::make_unique<FrameReconstructor::Scratch>();
+
+        bool ok = true;
+        for (int f = firstFrame; ok && f < firstFrame + numFrames; f += batched::lanes)
+            ok = impl->rec.process (f, juce::jmin (batched::lanes, firstFrame + numFrames - f), *scratch);
+
+        const std::lock_guard<std::mutex> sl (impl->scratchLock);
+        impl->scratchPool.push_back (std::move (scratch));
+        return ok;
+    }
+
+    void finaliseWavetable (Wavetable& wt)
+    {
+        const int N = wt.tableSize;
+        const int F = wt.frames;
+
+        // DC remove per frame
+        for (int f = 0; f < F; ++f)
+        {
+            auto* dst = wt.table.getWritePointer (f);
+            double sum = 0.0;
+            for (int i = 0; i < N; ++i)
+                sum += dst[i];
+            const float mean = (float) (sum / (double) N);
+            for (int i = 0; i < N; ++i)
+                dst[i] -= mean;
+        }
+
+        // Normalize global peak
+        float peak = 0.0f;
+        for (int f = 0; f < F; ++f)
+            peak = juce::jmax (peak, wt.table.getMagnitude (f, 0, N));
+
+        if (peak > 0.0f)
+            wt.table.applyGain (0.999f / peak);
+
+        wt.contentHash = hashTable (wt);
+        buildMipChain (wt);
+    }
+}
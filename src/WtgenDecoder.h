@@ -0,0 +1,267 @@
+#pragma once
+#include <JuceHeader.h>
+
+#include "PluginProcessor.h"
+#include "FftBackend.h"
+#include "TaskScheduler.h"
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+//==============================================================================
+// Decoder de .wtgen.json / .wtgen.bin (wtgen-1 / harm-noise-framepack-v1, v2)
+//
+// Todo lo que viene del fichero se valida contra DecodeLimits ANTES de reservar
+// memoria o empezar la reconstrucción, y los frames se procesan en streaming con
+// abort temprano si se excede el presupuesto de tiempo.
+namespace wtgen
+{
+    using Wavetable = BasicInstrumentAudioProcessor::Wavetable;
+    using WtSource  = BasicInstrumentAudioProcessor::WtSource;
+    using PhaseMode = BasicInstrumentAudioProcessor::PhaseMode;
+
+    //==============================================================================
+    // Límites de recursos (un preset corrupto o malicioso no debe colgar la carga
+    // de la sesión ni agotar la RAM)
+    struct DecodeLimits
+    {
+        size_t maxJsonBytes     = (size_t) 64 * 1024 * 1024; // texto .wtgen.json
+        size_t maxDataBytes     = (size_t) 32 * 1024 * 1024; // framepack ya sin base64
+        int    minTableSize     = 4;
+        int    maxTableSize     = 16384;
+        int    maxFrames        = 1024;
+        int    maxHarmonics     = 8192;
+        int    maxBands         = 1024;
+        size_t maxTableSamples  = (size_t) 8 * 1024 * 1024;  // frames * tableSize (32 MiB en float)
+        double maxFftWork       = 2.0e8;                     // sum(frames * N * log2 N), estimación de tiempo
+        double maxDecodeSeconds = 10.0;                      // presupuesto de reloj (<= 0: sin límite)
+
+        // Opciones de reconstrucción, por llamada (no son límites, pero viajan con ellos)
+        //   fftBackend:  el de fft::Engine (frame a frame)
+        //   batchFrames: fase mínima multi-frame por lotes (batched::minimumPhase, con
+        //                su propio FFT radix-2). Sustituye al FFT de JUCE; con otro
+        //                backend elegido en configure se respeta ese backend
+        fft::Backend fftBackend = fft::getDefaultBackend();
+        bool batchFrames        = fft::getDefaultBackend() == fft::Backend::juce;
+    };
+
+    //==============================================================================
+    // Codecs (p.codec)
+    //   v1: "HNFPv1\0" + N, F, H, B (u16) + F * (H*u16 + B*i16 + 3*u16)
+    //   v2: "HNFPv2\0" + N, F, H, B (u16) + flags (u8) + mismos valores, opcionalmente
+    //       como delta respecto al frame anterior (mod 2^16) y/o varint zigzag
+    static constexpr const char* codecFramepackV1 = "harm-noise-framepack-v1";
+    static constexpr const char* codecFramepackV2 = "harm-noise-framepack-v2";
+
+    enum FramepackFlags
+    {
+        framepackDelta  = 1, // valor[f] = valor[f-1] + d[f]
+        framepackVarint = 2  // d como int16 -> zigzag -> LEB128 (1-3 bytes)
+    };
+
+    //==============================================================================
+    // Header HNFPv1/v2 validado + tamaños exactos derivados
+    struct FramepackHeader
+    {
+        int version   = 1;
+        int flags     = 0; // solo v2
+        int tableSize = 0;
+        int frames    = 0;
+        int harmonics = 0;
+        int bands     = 0;
+
+        size_t headerBytes = 0; // magic + 4 * u16 (+ flags en v2)
+        size_t frameBytes  = 0; // H*u16 + B*i16 + 3*u16 (layout v1 expandido)
+        size_t totalBytes  = 0; // v1 / v2 sin varint: exacto; v2 varint: cota inferior
+
+        int getValuesPerFrame() const noexcept { return harmonics + bands + 3; }
+    };
+
+    // requirePayload = false: solo el header (payload aún llegando, loader en pipeline)
+    bool parseFramepackHeader (const juce::uint8* bytes, size_t size,
+                               const DecodeLimits& limits,
+                               FramepackHeader& outHeader,
+                               juce::String& err,
+                               bool requirePayload = true);
+
+    //==============================================================================
+    // Frames precalculados (nodo "timeFrames", codec "pcm-frames-v1"): la tabla final
+    // en el dominio del tiempo, sin reconstrucción espectral al cargar.
+    //   "PCMFv1\0" + N, F (u16) + format (u8) + flags (u8) + scale (f32)
+    //   + [pcmFramesMips] F * u16 ancho de banda + mips de los frames y niveles que
+    //     pasan de Wavetable::getMipBandwidth (orden frame, nivel; N >> m muestras LE
+    //     en el formato de la tabla, sin delta ni varint)
+    //   + F * N muestras LE (int16: sample = q * scale; float32: tal cual)
+    //   flags: framepackDelta / framepackVarint (solo int16, igual que HNFPv2),
+    //   pcmFramesMips
+    static constexpr const char* codecPcmFramesV1 = "pcm-frames-v1";
+
+    enum class PcmFormat
+    {
+        int16 = 0,
+        float32 = 1
+    };
+
+    enum PcmFramesFlags
+    {
+        pcmFramesMips = 4 // ancho de banda y mip chain precalculados (int16 y float32)
+    };
+
+    struct PcmFramesHeader
+    {
+        int tableSize = 0;
+        int frames    = 0;
+        PcmFormat format = PcmFormat::int16;
+        int flags     = 0;
+        float scale   = 1.0f;
+
+        std::vector<int> frameBandwidth; // vacío = sin pcmFramesMips
+        size_t mipsOffset = 0;           // primer mip (tras los anchos de banda)
+
+        size_t headerBytes = 0; // hasta las muestras (con anchos de banda y mips)
+        size_t totalBytes  = 0; // exacto sin varint; cota inferior con varint
+    };
+
+    bool parsePcmFramesHeader (const juce::uint8* bytes, size_t size,
+                               const DecodeLimits& limits,
+                               PcmFramesHeader& outHeader,
+                               juce::String& err);
+
+    // HNFPv2 -> layout v1 (decodificación de varint + prefix sum entre frames)
+    bool expandFramepack (const juce::uint8* bytes, size_t size,
+                          const FramepackHeader& header,
+                          const DecodeLimits& limits,
+                          juce::MemoryBlock& outV1,
+                          juce::String& err);
+
+    // Framepack v1/v2 que llega por partes: cada fila completa se copia (v1) o se
+    // expande (v2) a un buffer v1 de tamaño fijo, reservado al leer el header.
+    // Los frames ya listos se pueden reconstruir mientras siguen llegando bytes.
+    class FramepackStream
+    {
+    public:
+        // bytes: payload recibido hasta ahora (solo crece entre llamadas).
+        // false: corrupto o fuera de límites
+        bool advance (const juce::uint8* bytes, size_t available,
+                      const DecodeLimits& limits, juce::String& err);
+
+        bool hasHeader() const noexcept   { return headerReady; }
+        int getFramesReady() const noexcept { return framesReady; }
+        bool isComplete() const noexcept  { return headerReady && framesReady == header.frames; }
+
+        // Layout v1 (válido tras hasHeader(); los frames >= getFramesReady() aún a cero)
+        const FramepackHeader& getV1Header() const noexcept { return v1Header; }
+        const juce::uint8* getV1Bytes() const noexcept { return (const juce::uint8*) v1.getData(); }
+        size_t getV1Size() const noexcept { return v1.getSize(); }
+
+    private:
+        FramepackHeader header;   // del payload (v1 o v2)
+        FramepackHeader v1Header;
+        juce::MemoryBlock v1;
+        size_t offset = 0;        // siguiente fila en el payload
+        int framesReady = 0;
+        bool headerReady = false;
+        std::vector<juce::uint16> row, prevRow;
+    };
+
+    //==============================================================================
+    // JSON -> fuente compacta (sin reconstrucción)
+    bool parseWtgenJson (const juce::String& jsonText,
+                         const juce::String& nameHint,
+                         const DecodeLimits& limits,
+                         WtSource::Ptr& outSrc,
+                         juce::String& err);
+
+    // wtgen-1 ya parseado -> fuente. rawData / rawFrames: payloads ya separados del
+    // texto (contenedor binario, loader en pipeline); nullptr = base64 en p.data
+    bool parseWtgenProgram (const juce::var& root,
+                            const juce::String& nameHint,
+                            const DecodeLimits& limits,
+                            const juce::MemoryBlock* rawData,
+                            const juce::MemoryBlock* rawFrames,
+                            WtSource::Ptr& outSrc,
+                            juce::String& err);
+
+    // Contenedor binario (sin base64):
+    //   "WTGENBIN" + u32 metaBytes + meta (wtgen-1 JSON sin p.data) + u32 dataBytes + data
+    //   [+ u32 framesBytes + frames]   (payload del nodo timeFrames, si lo hay)
+    static constexpr juce::uint8 binaryMagic[8] = { 'W','T','G','E','N','B','I','N' };
+
+    bool isWtgenBinary (const void* data, size_t size);
+    bool parseWtgenBinary (const void* data, size_t size,
+                           const juce::String& nameHint,
+                           const DecodeLimits& limits,
+                           WtSource::Ptr& outSrc,
+                           juce::String& err);
+
+    // Fichero .wtgen.json / .wtgen.bin -> fuente, sin reconstrucción (para comparar
+    // contentHash antes de decodificar). phaseOverride: ver applyPhaseOverride
+    bool readWtgenFile (const juce::File& file,
+                        std::optional<PhaseMode> phaseOverride,
+                        const DecodeLimits& limits,
+                        WtSource::Ptr& outSrc,
+                        juce::String& err);
+
+    // Recalcula src.contentHash (tras modificar fase/banding a mano)
+    void updateSourceHash (WtSource& src);
+
+    // Opción de carga "fase": otra fase invalida los frames precalculados y se
+    // reconstruye desde el espectro. Sin datos espectrales el override se ignora.
+    void applyPhaseOverride (WtSource& src, std::optional<PhaseMode> phaseOverride);
+
+    // Nombre de la fase en p.phase ("minimum" | "zero" | "fixed")
+    juce::String getPhaseModeName (PhaseMode mode);
+    bool parsePhaseModeName (const juce::String& name, PhaseMode& outMode);
+
+    // Fuente -> wavetable (frames precalculados si los hay; si no, reconstrucción).
+    // cancelled: se consulta por lote de frames, como el presupuesto de tiempo
+    // (err = "Cancelled"), para que Scheduler::cancel no espere un decode entero
+    bool buildWavetableFromSource (const WtSource& src,
+                                   const DecodeLimits& limits,
+                                   Wavetable::Ptr& outWt,
+                                   juce::String& err,
+                                   const tasks::CancelFlag* cancelled = nullptr);
+
+    // Reconstrucción de un framepack v1 en memoria, por lotes de frames. Solo lee los
+    // frames pedidos, así que el buffer puede seguir llenándose (FramepackStream).
+    // process() admite llamadas concurrentes sobre rangos disjuntos (scratch por llamada).
+    class FrameReconstruction
+    {
+    public:
+        // loBin / hiBin / phaseMode: los de la fuente (0 = default del decoder).
+        // options: fftBackend / batchFrames (el resto de DecodeLimits no se usa aquí)
+        FrameReconstruction (const juce::uint8* v1Bytes, size_t v1Size,
+                             const FramepackHeader& v1Header,
+                             int loBin, int hiBin, PhaseMode phaseMode,
+                             const DecodeLimits& options,
+                             juce::AudioBuffer<float>& table);
+        ~FrameReconstruction();
+
+        // Frames [firstFrame, firstFrame + numFrames) -> table
+        bool process (int firstFrame, int numFrames) const;
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+
+        JUCE_DECLARE_NON_COPYABLE (FrameReconstruction)
+    };
+
+    // Tras reconstruir todos los frames: DC por frame, pico global, contentHash,
+    // ancho de banda por frame y mip chain dispersa
+    void finaliseWavetable (Wavetable& wt);
+
+    // Ancho de banda por frame (FFT) y mip chain dispersa de wt.table. Los payloads
+    // pcm-frames-v1 la llevan precalculada (encodePcmFrames), así que al cargarlos
+    // no se llama
+    void buildMipChain (Wavetable& wt);
+
+    //==============================================================================
+    // Band edges helper, compartido con WtgenEncoder (y el exporter externo)
+    std::vector<int> linearBandEdges (int loBin, int hiBin, int bands);
+
+    // FNV-1a 64-bit (content hashing, not crypto)
+    juce::uint64 hashBytes (const void* data, size_t numBytes,
+                            juce::uint64 h = 14695981039346656037ull);
+}
@@ -0,0 +1,571 @@
+/*
+  ==============================================================================
+
+    WtgenEncoder.cpp
+    - Audio cycles -> harm-noise-framepack-v1/v2 (same quantisation as the decoder)
+    - v2: inter-frame delta + zigzag varint, optional WTGENBIN container
+    - Per-frame analysis spread across the shared worker pool
+
+  ==============================================================================
+*/
+
+#include "WtgenEncoder.h"
+#include "FftBackend.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace
+{
+    static int orderOfPowerOfTwo (int n)
+    {
+        int order = 0;
+        while ((1 << order) < n)
+            ++order;
+        return order;
+    }
+
+    // 4-point Hermite sobre un ciclo periódico de longitud arbitraria
+    static float readPeriodicCubic (const float* cycle, int length, double pos)
+    {
+        const int i1 = (int) std::floor (pos);
+        const float f = (float) (pos - (double) i1);
+
+        const auto at = [cycle, length] (int i) { return cycle[((i % length) + length) % length]; };
+
+        const float y0 = at (i1 - 1);
+        const float y1 = at (i1);
+        const float y2 = at (i1 + 1);
+        const float y3 = at (i1 + 2);
+
+        const float c1 = 0.5f * (y2 - y0);
+        const float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+        const float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+        return ((c3 * f + c2) * f + c1) * f + y1;
+    }
+
+    // Inverso de readPackedValues del decoder: delta entre filas y/o varint zigzag
+    static void writePackedValues (juce::MemoryOutputStream& out,
+                                   const std::vector<juce::uint16>& values,
+                                   int rows, int width, int flags)
+    {
+        for (int r = 0; r < rows; ++r)
+        {
+            const auto* row = values.data() + (size_t) r * (size_t) width;
+
+            for (int i = 0; i < width; ++i)
+            {
+                auto v = row[i];
+                if ((flags & wtgen::framepackDelta) != 0 && r > 0)
+                    v = (juce::uint16) (v - row[i - width]);
+
+                if ((flags & wtgen::framepackVarint) == 0)
+                {
+                    out.writeShort ((short) v);
+                    continue;
+                }
+
+                // int16 -> zigzag -> LEB128 (1-3 bytes)
+                const auto d = (juce::int32) (juce::int16) v;
+                auto zz = (((juce::uint32) d << 1) ^ (juce::uint32) (d >> 31)) & 0xffffu;
+
+                while (zz >= 0x80)
+                {
+                    out.writeByte ((char) ((zz & 0x7f) | 0x80));
+                    zz >>= 7;
+                }
+                out.writeByte ((char) zz);
+            }
+        }
+    }
+
+    static void writeMagic (juce::MemoryOutputStream& out)
+    {
+        static constexpr char magic[7] = { 'H','N','F','P','v','1','\0' };
+        out.write (magic, sizeof (magic));
+    }
+}
+
+//==============================================================================
+namespace wtgen
+{
+    bool sliceCycles (const float* audio, int numSamples,
+                      int cycleLength, int tableSize, int maxFrames,
+                      juce::AudioBuffer<float>& outFrames,
+                      juce::String& err)
+    {
+        if (audio == nullptr || numSamples <= 0)
+        {
+            err = "Empty audio";
+            return false;
+        }
+        if (! juce::isPowerOfTwo (tableSize) || tableSize < 4)
+        {
+            err = "tableSize must be a power of two >= 4";
+            return false;
+        }
+
+        const int L = cycleLength > 0 ? cycleLength : numSamples;
+        const int available = numSamples / L;
+        if (available <= 0)
+        {
+            err = "Audio shorter than one cycle (" + juce::String (numSamples) + " < " + juce::String (L) + ")";
+            return false;
+        }
+
+        const int F = juce::jlimit (1, juce::jmax (1, maxFrames), available);
+        outFrames.setSize (F, tableSize);
+
+        for (int f = 0; f < F; ++f)
+        {
+            // F < available: ciclos repartidos uniformemente (primero y último incluidos)
+            const int cycle = F > 1 ? (int) ((juce::int64) f * (available - 1) / (F - 1)) : 0;
+            const float* src = audio + (size_t) cycle * (size_t) L;
+            auto* dst = outFrames.getWritePointer (f);
+
+            if (L == tableSize)
+            {
+                std::copy (src, src + L, dst);
+                continue;
+            }
+
+            const double step = (double) L / (double) tableSize;
+            for (int i = 0; i < tableSize; ++i)
+                dst[i] = readPeriodicCubic (src, L, (double) i * step);
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    bool analyseFrames (const juce::AudioBuffer<float>& frames,
+                        int numThreads,
+                        std::vector<float>& outMags,
+                        juce::String& err)
+    {
+        const int F = frames.getNumChannels();
+        const int N = frames.getNumSamples();
+
+        if (F <= 0 || N < 4 || ! juce::isPowerOfTwo (N))
+        {
+            err = "Frames must be a non-empty [frames][2^k] buffer";
+            return false;
+        }
+
+        const int nBins = N / 2 + 1;
+        const int order = orderOfPowerOfTwo (N);
+        const float ampScale = 2.0f / (float) N;
+
+        outMags.assign ((size_t) F * (size_t) nBins, 0.0f);
+        std::atomic<bool> failed { false };
+
+        // Pool compartido del proceso (en las herramientas de consola se crea aquí)
+        juce::SharedResourcePointer<tasks::Scheduler> scheduler;
+
+        scheduler->parallelFor (F, tasks::Priority::interactive, numThreads, [&] (int begin, int end, int)
+        {
+            // Engine y scratch por rango
+            auto engine = fft::create (order);
+            if (engine == nullptr)
+            {
+                failed = true;
+                return;
+            }
+
+            std::vector<fft::Complex> bins ((size_t) nBins);
+
+            for (int f = begin; f < end; ++f)
+            {
+                engine->forwardReal (frames.getReadPointer (f), bins.data());
+
+                float* mag = outMags.data() + (size_t) f * (size_t) nBins;
+                for (int k = 0; k < nBins; ++k)
+                    mag[k] = std::abs (bins[(size_t) k]) * ampScale;
+            }
+        });
+
+        if (failed)
+        {
+            err = "FFT backend unavailable";
+            return false;
+        }
+        return true;
+    }
+
+    //==============================================================================
+    bool encodeFrames (const juce::AudioBuffer<float>& frames,
+                       const EncodeSettings& settings,
+                       const juce::String& name,
+                       WtSource::Ptr& outSrc,
+                       juce::String& err)
+    {
+        outSrc = nullptr;
+
+        const int F = frames.getNumChannels();
+        const int N = frames.getNumSamples();
+        const DecodeLimits limits;
+
+        // Lo que el decoder no aceptaría no se escribe
+        if (F <= 0 || F > limits.maxFrames)
+        {
+            err = "Frame count out of range (" + juce::String (F) + ")";
+            return false;
+        }
+        if (! juce::isPowerOfTwo (N) || N < limits.minTableSize || N > limits.maxTableSize)
+        {
+            err = "tableSize out of range (" + juce::String (N) + ")";
+            return false;
+        }
+
+        const int nBins = N / 2 + 1;
+
+        const int H = settings.harmonics > 0 ? juce::jmin (settings.harmonics, nBins - 2) : nBins - 2;
+        const int hiBin = juce::jlimit (0, nBins - 1, settings.hiBin > 0 ? settings.hiBin : nBins - 1);
+        const int loBin = juce::jlimit (0, hiBin, settings.loBin > 0 ? settings.loBin : H + 1);
+        const int B = (hiBin > loBin) ? juce::jlimit (0, limits.maxBands, settings.bands) : 0;
+
+        if (H > limits.maxHarmonics)
+        {
+            err = "Too many harmonics (" + juce::String (H) + ")";
+            return false;
+        }
+
+        std::vector<float> mags;
+        if (! analyseFrames (frames, settings.numThreads, mags, err))
+            return false;
+
+        const auto edges = linearBandEdges (loBin, hiBin, juce::jmax (1, B));
+
+        auto src = WtSource::Ptr (new WtSource());
+        src->codec = codecFramepackV1;
+        src->name = name;
+        src->loBin = loBin;
+        src->hiBin = hiBin;
+        src->phaseMode = settings.phaseMode;
+
+        {
+            juce::MemoryOutputStream out (src->data, false);
+            out.preallocate (sizeof (juce::uint16) * 4 + 7
+                             + (size_t) F * ((size_t) H * 2 + (size_t) B * 2 + 3 * 2));
+
+            writeMagic (out);
+            out.writeShort ((short) N);
+            out.writeShort ((short) F);
+            out.writeShort ((short) H);
+            out.writeShort ((short) B);
+
+            for (int f = 0; f < F; ++f)
+            {
+                const float* mag = mags.data() + (size_t) f * (size_t) nBins;
+
+                // Harmonics: u16 = amplitud * 4096 (armónico h+1 en el bin h+1)
+                for (int h = 0; h < H; ++h)
+                {
+                    const auto q = juce::jlimit (0, 65535, juce::roundToInt (mag[1 + h] * 4096.0f));
+                    out.writeShort ((short) (juce::uint16) q);
+                }
+
+                // Noise bands: i16 = dB * 2 del RMS de la banda (mismo rango que acepta el decoder)
+                for (int b = 0; b < B; ++b)
+                {
+                    const int a = edges[(size_t) b];
+                    const int c = juce::jmin (edges[(size_t) b + 1], nBins);
+
+                    double sumSq = 0.0;
+                    for (int k = a; k < c; ++k)
+                        sumSq += (double) mag[k] * (double) mag[k];
+
+                    const double rms = c > a ? std::sqrt (sumSq / (double) (c - a)) : 0.0;
+                    const double db = 20.0 * std::log10 (juce::jmax (rms, 1.0e-12));
+                    const auto qdb = juce::jlimit (-480, 80, juce::roundToInt (db * 2.0));
+                    out.writeShort ((short) qdb);
+                }
+
+                // 3*u16 tilt params (sin uso todavía)
+                for (int t = 0; t < 3; ++t)
+                    out.writeShort (0);
+            }
+
+            out.flush();
+        }
+
+        // Validación final con el mismo parser que la carga
+        FramepackHeader header;
+        if (! parseFramepackHeader ((const juce::uint8*) src->data.getData(), src->data.getSize(),
+                                    limits, header, err))
+            return false;
+
+        if (settings.codecVersion == 2)
+            return transcodeSource (*src, 2, settings.v2Flags, outSrc, err);
+
+        updateSourceHash (*src);
+        outSrc = src;
+        return true;
+    }
+
+    //==============================================================================
+    bool compressFramepack (const juce::MemoryBlock& framepack, int flags,
+                            juce::MemoryBlock& outV2, juce::String& err)
+    {
+        const DecodeLimits limits;
+        const auto* bytes = (const juce::uint8*) framepack.getData();
+        auto size = framepack.getSize();
+
+        FramepackHeader header;
+        if (! parseFramepackHeader (bytes, size, limits, header, err))
+            return false;
+
+        juce::MemoryBlock expanded;
+        if (header.version == 2)
+        {
+            if (! expandFramepack (bytes, size, header, limits, expanded, err))
+                return false;
+
+            bytes = (const juce::uint8*) expanded.getData();
+            size = expanded.getSize();
+            if (! parseFramepackHeader (bytes, size, limits, header, err))
+                return false;
+        }
+
+        flags &= (framepackDelta | framepackVarint);
+
+        const int F = header.frames;
+        const int W = header.getValuesPerFrame();
+        const auto* raw = bytes + header.headerBytes; // F * W u16 LE
+        std::vector<juce::uint16> values ((size_t) F * (size_t) W);
+        for (size_t i = 0; i < values.size(); ++i)
+            values[i] = (juce::uint16) (raw[i * 2] | (raw[i * 2 + 1] << 8));
+
+        juce::MemoryOutputStream out (outV2, false);
+        out.preallocate (header.headerBytes + 1 + (size_t) F * header.frameBytes);
+
+        static constexpr char magic[7] = { 'H','N','F','P','v','2','\0' };
+        out.write (magic, sizeof (magic));
+        out.writeShort ((short) header.tableSize);
+        out.writeShort ((short) header.frames);
+        out.writeShort ((short) header.harmonics);
+        out.writeShort ((short) header.bands);
+        out.writeByte ((char) flags);
+
+        writePackedValues (out, values, F, W, flags);
+
+        out.flush();
+        return true;
+    }
+
+    bool transcodeSource (const WtSource& src, int codecVersion, int v2Flags,
+                          WtSource::Ptr& outSrc, juce::String& err)
+    {
+        outSrc = nullptr;
+
+        auto dst = WtSource::Ptr (new WtSource());
+        dst->name = src.name;
+        dst->loBin = src.loBin;
+        dst->hiBin = src.hiBin;
+        dst->phaseMode = src.phaseMode;
+        dst->framesCodec = src.framesCodec;
+        dst->frames = src.frames;
+
+        if (src.data.getSize() == 0)
+        {
+            // Solo frames precalculados: no hay framepack que convertir
+        }
+        else if (codecVersion == 2)
+        {
+            dst->codec = codecFramepackV2;
+            if (! compressFramepack (src.data, v2Flags, dst->data, err))
+                return false;
+        }
+        else
+        {
+            const DecodeLimits limits;
+            const auto* bytes = (const juce::uint8*) src.data.getData();
+
+            FramepackHeader header;
+            if (! parseFramepackHeader (bytes, src.data.getSize(), limits, header, err))
+                return false;
+
+            dst->codec = codecFramepackV1;
+            if (header.version == 2)
+            {
+                if (! expandFramepack (bytes, src.data.getSize(), header, limits, dst->data, err))
+                    return false;
+            }
+            else
+            {
+                dst->data = src.data;
+            }
+        }
+
+        updateSourceHash (*dst);
+        outSrc = dst;
+        return true;
+    }
+
+    bool writeWtgenBinary (const WtSource& src, juce::OutputStream& out)
+    {
+        const auto meta = juce::JSON::toString (src.toVar (false), true);
+        const auto metaBytes = meta.getNumBytesAsUTF8();
+
+        const bool ok = out.write (binaryMagic, sizeof (binaryMagic))
+                     && out.writeInt ((int) metaBytes)
+                     && out.write (meta.toRawUTF8(), metaBytes)
+                     && out.writeInt ((int) src.data.getSize())
+                     && out.write (src.data.getData(), src.data.getSize());
+
+        if (! ok || src.frames.getSize() == 0)
+            return ok;
+
+        return out.writeInt ((int) src.frames.getSize())
+            && out.write (src.frames.getData(), src.frames.getSize());
+    }
+
+    //==============================================================================
+    bool encodePcmFrames (const Wavetable& wt, PcmFormat format, int flags,
+                          juce::MemoryBlock& out, juce::String& err)
+    {
+        const int N = wt.tableSize;
+        const int F = wt.frames;
+        const DecodeLimits limits;
+
+        if (F <= 0 || F > limits.maxFrames || ! juce::isPowerOfTwo (N)
+             || N < limits.minTableSize || N > limits.maxTableSize)
+        {
+            err = "Table out of range for pcm-frames-v1";
+            return false;
+        }
+
+        flags = (format == PcmFormat::int16) ? (flags & (framepackDelta | framepackVarint)) : 0;
+
+        // Ancho de banda y mips de la tabla (buildMipChain): la carga no hace FFT.
+        // Solo si están todos los que el decoder espera de esos anchos de banda
+        const int L = Wavetable::getNumMipLevels (N);
+        bool withMips = wt.mipLevels == L
+                     && wt.frameBandwidth.size() == (size_t) F
+                     && wt.mipFrames.size() == (size_t) (F * L);
+
+        for (int f = 0; withMips && f < F; ++f)
+            for (int m = 1; m < L; ++m)
+                if (wt.frameBandwidth[(size_t) f] > wt.getMipBandwidth (m)
+                     && wt.mipFrames[(size_t) (f * L + m)] == nullptr)
+                    withMips = false;
+
+        if (withMips)
+            flags |= pcmFramesMips;
+
+        float peak = 0.0f;
+        for (int f = 0; f < F; ++f)
+            peak = juce::jmax (peak, wt.table.getMagnitude (f, 0, N));
+
+        // Los mips pueden pasar un poco del pico (Gibbs al truncar): misma escala para todo
+        if (withMips)
+            for (auto& mip : wt.mipFrames)
+                if (mip != nullptr)
+                    peak = juce::jmax (peak, juce::FloatVectorOperations::findMaximum (mip->data.get(), mip->size),
+                                       -juce::FloatVectorOperations::findMinimum (mip->data.get(), mip->size));
+
+        const float scale = juce::jmax (peak, 1.0e-9f) / 32767.0f;
+
+        juce::MemoryOutputStream mo (out, false);
+        mo.preallocate (18 + (size_t) F * (size_t) N * (format == PcmFormat::float32 ? 4 : 2));
+
+        static constexpr char magic[7] = { 'P','C','M','F','v','1','\0' };
+        mo.write (magic, sizeof (magic));
+        mo.writeShort ((short) N);
+        mo.writeShort ((short) F);
+        mo.writeByte ((char) format);
+        mo.writeByte ((char) flags);
+        mo.writeFloat (format == PcmFormat::int16 ? scale : 1.0f);
+
+        const float invScale = 1.0f / scale;
+        auto quantise = [invScale] (float x)
+        {
+            return (juce::uint16) (juce::int16) juce::jlimit (-32767, 32767, juce::roundToInt (x * invScale));
+        };
+
+        if (withMips)
+        {
+            for (int f = 0; f < F; ++f)
+                mo.writeShort ((short) wt.frameBandwidth[(size_t) f]);
+
+            // Mismo orden que lee el decoder: frame, nivel; los que caben se omiten
+            for (int f = 0; f < F; ++f)
+            {
+                for (int m = 1; m < L; ++m)
+                {
+                    if (wt.frameBandwidth[(size_t) f] <= wt.getMipBandwidth (m))
+                        continue;
+
+                    const auto& mip = *wt.mipFrames[(size_t) (f * L + m)];
+                    for (int i = 0; i < mip.size; ++i)
+                    {
+                        if (format == PcmFormat::float32)
+                            mo.writeFloat (mip.data[i]);
+                        else
+                            mo.writeShort ((short) quantise (mip.data[i]));
+                    }
+                }
+            }
+        }
+
+        if (format == PcmFormat::float32)
+        {
+            for (int f = 0; f < F; ++f)
+            {
+                const auto* p = wt.table.getReadPointer (f);
+                for (int i = 0; i < N; ++i)
+                    mo.writeFloat (p[i]);
+            }
+        }
+        else
+        {
+            std::vector<juce::uint16> values ((size_t) F * (size_t) N);
+
+            for (int f = 0; f < F; ++f)
+            {
+                const auto* p = wt.table.getReadPointer (f);
+                auto* q = values.data() + (size_t) f * (size_t) N;
+                for (int i = 0; i < N; ++i)
+                    q[i] = quantise (p[i]);
+            }
+
+            writePackedValues (mo, values, F, N, flags);
+        }
+
+        mo.flush();
+        return true;
+    }
+
+    bool attachTimeFrames (WtSource& src, PcmFormat format, int flags, juce::String& err)
+    {
+        // Siempre desde el espectro (si lo hay), nunca desde frames viejos
+        auto spectral = WtSource::Ptr (new WtSource());
+        spectral->codec = src.codec;
+        spectral->data = src.data;
+        spectral->loBin = src.loBin;
+        spectral->hiBin = src.hiBin;
+        spectral->phaseMode = src.phaseMode;
+        spectral->name = src.name;
+
+        const bool hasSpectral = src.data.getSize() > 0;
+
+        Wavetable::Ptr wt;
+        if (! buildWavetableFromSource (hasSpectral ? *spectral : src, {}, wt, err))
+            return false;
+
+        // Frames viejos sin pcmFramesMips: se miden aquí para que el payload nuevo los lleve
+        if (wt->mipLevels == 0)
+            buildMipChain (*wt);
+
+        juce::MemoryBlock frames;
+        if (! encodePcmFrames (*wt, format, flags, frames, err))
+            return false;
+
+        src.framesCodec = codecPcmFramesV1;
+        src.frames = std::move (frames);
+        updateSourceHash (src);
+        return true;
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <JuceHeader.h>
+
+#include "WtgenDecoder.h"
+
+#include <vector>
+
+//==============================================================================
+// Encoder HNFPv1/v2 (inverso de WtgenDecoder)
+//
+// Frames de un ciclo -> armónicos (u16, amplitud * 4096) + bandas de ruido
+// (i16, dB * 2) con los mismos band edges que el decoder (linearBandEdges).
+// La fase se descarta: el decoder la reconstruye según p.phase.
+namespace wtgen
+{
+    struct EncodeSettings
+    {
+        int harmonics  = 0;  // 0: todos los que caben (N/2 - 1)
+        int bands      = 0;  // bandas de ruido sobre los armónicos
+        int loBin      = 0;  // 0: harmonics + 1 (default del decoder)
+        int hiBin      = 0;  // 0: N/2
+        PhaseMode phaseMode = PhaseMode::minimum;
+        int numThreads = 0;  // 0: núcleos disponibles
+
+        int codecVersion = 1;                                  // 1: HNFPv1, 2: HNFPv2
+        int v2Flags      = framepackDelta | framepackVarint;   // solo v2
+    };
+
+    //==============================================================================
+    // Audio -> frames [frames][tableSize] (un ciclo por frame)
+    //   cycleLength <= 0: todo el audio es un solo ciclo
+    //   cycleLength  > 0: ciclos consecutivos de cycleLength muestras; si hay más de
+    //                     maxFrames se eligen maxFrames repartidos uniformemente
+    // Cada ciclo se remuestrea (periódico, Hermite) a tableSize.
+    bool sliceCycles (const float* audio, int numSamples,
+                      int cycleLength, int tableSize, int maxFrames,
+                      juce::AudioBuffer<float>& outFrames,
+                      juce::String& err);
+
+    // Magnitudes de cada frame, escaladas como amplitud de seno (|X[k]| * 2/N).
+    // outMags: frames * (N/2 + 1). El análisis se reparte entre hilos por frames.
+    bool analyseFrames (const juce::AudioBuffer<float>& frames,
+                        int numThreads,
+                        std::vector<float>& outMags,
+                        juce::String& err);
+
+    // Frames -> fuente HNFPv1/v2 lista para buildWavetableFromSource / toJson
+    bool encodeFrames (const juce::AudioBuffer<float>& frames,
+                       const EncodeSettings& settings,
+                       const juce::String& name,
+                       WtSource::Ptr& outSrc,
+                       juce::String& err);
+
+    //==============================================================================
+    // Framepack v1/v2 -> HNFPv2 con los flags pedidos (sin pérdidas)
+    bool compressFramepack (const juce::MemoryBlock& framepack, int flags,
+                            juce::MemoryBlock& outV2, juce::String& err);
+
+    // Fuente -> misma fuente en codecVersion 1 o 2 (conversión de librerías existentes)
+    bool transcodeSource (const WtSource& src, int codecVersion, int v2Flags,
+                          WtSource::Ptr& outSrc, juce::String& err);
+
+    // Contenedor binario .wtgen.bin (ver parseWtgenBinary)
+    bool writeWtgenBinary (const WtSource& src, juce::OutputStream& out);
+
+    //==============================================================================
+    // Tabla final -> payload pcm-frames-v1 (int16 escalado al pico, o float32 sin pérdidas).
+    // flags (solo int16): framepackDelta / framepackVarint. Si la tabla tiene su mip
+    // chain (buildMipChain) se guarda con pcmFramesMips
+    bool encodePcmFrames (const Wavetable& wt, PcmFormat format, int flags,
+                          juce::MemoryBlock& out, juce::String& err);
+
+    // Reconstruye la tabla de src y la adjunta como nodo timeFrames (los datos
+    // espectrales se conservan para edición)
+    bool attachTimeFrames (WtSource& src, PcmFormat format, int flags, juce::String& err);
+}
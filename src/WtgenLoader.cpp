@@ -0,0 +1,1003 @@
+/*
+  ==============================================================================
+
+    WtgenLoader.cpp
+    - Pipelined .wtgen.json / .wtgen.bin loading: chunked read, incremental
+      base64, streamed framepack rows, batched reconstruction on the shared pool
+    - Speculative phase/banding, verified against the final parse
+
+  ==============================================================================
+*/
+
+#include "WtgenLoader.h"
+#include "BatchedFft.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using wtgen::PhaseMode;
+
+    static constexpr size_t chunkBytes = (size_t) 64 * 1024;
+    static constexpr int maxPayloads = 4; // p.data capturados en un JSON (el resto va en el meta)
+
+    static double nowMs()
+    {
+        return juce::Time::getMillisecondCounterHiRes();
+    }
+
+    //==============================================================================
+    // base64 incremental, mismo alfabeto que juce::Base64 (RFC 4648). Solo acepta lo
+    // que juce::Base64::convertFromBase64 decodifica igual: grupos completos de 4
+    // símbolos, '=' solo en el último ("xx==" / "xxx="), sin espacios. Si un símbolo
+    // no encaja, getText() devuelve un texto equivalente a lo ya consumido.
+    class Base64Stream
+    {
+    public:
+        bool push (char ch, std::vector<juce::uint8>& out)
+        {
+            const auto c = (juce::uint8) ch;
+            int v = 0;
+
+            if (padded)
+                return false;
+
+            if (c == '=')
+            {
+                if (count < 2)
+                    return false;
+                ++pads;
+            }
+            else if ((v = valueOf (c)) < 0 || pads > 0)
+            {
+                return false;
+            }
+
+            group[count++] = (char) c;
+            acc = (acc << 6) | (juce::uint32) v;
+
+            if (count == 4)
+            {
+                out.push_back ((juce::uint8) (acc >> 16));
+                if (pads < 2) out.push_back ((juce::uint8) (acc >> 8));
+                if (pads < 1) out.push_back ((juce::uint8) acc);
+
+                acc = 0;
+                padded = pads > 0;
+                if (! padded)
+                    count = 0; // con padding el grupo se conserva para getText()
+            }
+            return true;
+        }
+
+        // Fin de la cadena: solo grupos completos (como juce::Base64)
+        bool isComplete() const noexcept
+        {
+            return count == 0 || padded;
+        }
+
+        // Grupos completos: base64 canónico de out (decodifica a los mismos bytes);
+        // grupo con padding y grupo a medias: los símbolos tal cual
+        std::string getText (const std::vector<juce::uint8>& out) const
+        {
+            const size_t full = out.size() - (padded ? (size_t) (3 - pads) : 0);
+            auto text = juce::Base64::toBase64 (out.data(), full).toStdString();
+            text.append (group, (size_t) count);
+            return text;
+        }
+
+        void reset() noexcept
+        {
+            acc = 0;
+            count = pads = 0;
+            padded = false;
+        }
+
+    private:
+        static int valueOf (juce::uint8 c) noexcept
+        {
+            if (c >= 'A' && c <= 'Z') return c - 'A';
+            if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+            if (c >= '0' && c <= '9') return c - '0' + 52;
+            if (c == '+') return 62;
+            if (c == '/') return 63;
+            return -1;
+        }
+
+        juce::uint32 acc = 0;
+        char group[4] = {};
+        int count = 0, pads = 0;
+        bool padded = false;
+    };
+
+    //==============================================================================
+    // Parámetros de reconstrucción sacados del meta visto hasta ahora
+    struct SpecParams
+    {
+        PhaseMode phaseMode = PhaseMode::minimum;
+        int loBin = 0;
+        int hiBin = 0;
+    };
+
+    static std::string readJsonScalarAfter (const std::string& text, size_t from, const char* key)
+    {
+        auto k = text.find (key, from);
+        if (k == std::string::npos)
+            return {};
+
+        k += std::strlen (key);
+        while (k < text.size() && (text[k] == ' ' || text[k] == ':' || text[k] == '\n'
+                                    || text[k] == '\r' || text[k] == '\t'))
+            ++k;
+
+        if (k < text.size() && text[k] == '"')
+        {
+            const auto end = text.find ('"', k + 1);
+            return end == std::string::npos ? std::string() : text.substr (k + 1, end - k - 1);
+        }
+
+        auto end = k;
+        while (end < text.size() && (text[end] == '-' || (text[end] >= '0' && text[end] <= '9')))
+            ++end;
+        return text.substr (k, end - k);
+    }
+
+    static SpecParams speculateParams (const std::string& meta, std::optional<PhaseMode> phaseOverride)
+    {
+        SpecParams p;
+
+        const auto at = meta.rfind ("\"spectralData\"");
+        if (at != std::string::npos)
+        {
+            if (! wtgen::parsePhaseModeName (juce::String (readJsonScalarAfter (meta, at, "\"phase\"")), p.phaseMode))
+                p.phaseMode = PhaseMode::minimum;
+
+            p.loBin = juce::String (readJsonScalarAfter (meta, at, "\"loBin\"")).getIntValue();
+            p.hiBin = juce::String (readJsonScalarAfter (meta, at, "\"hiBin\"")).getIntValue();
+        }
+
+        if (phaseOverride.has_value())
+            p.phaseMode = *phaseOverride;
+
+        return p;
+    }
+
+    //==============================================================================
+    // Cola acotada lector -> pool. Los helpers solo tocan rec tras sacar un lote,
+    // y el lector no vuelve hasta que la cola está vacía y sin lotes en curso.
+    struct Batches
+    {
+        std::mutex lock;
+        std::condition_variable idle;
+        std::deque<std::pair<int, int>> pending;
+        int inFlight = 0;
+        bool failed = false;
+
+        const wtgen::FrameReconstruction* rec = nullptr;
+        const tasks::CancelFlag* cancelled = nullptr;
+        double startMs = 0.0;
+        double firstDoneMs = -1.0;
+
+        bool runOne()
+        {
+            std::pair<int, int> range;
+            {
+                const std::lock_guard<std::mutex> sl (lock);
+                if (cancelled != nullptr && cancelled->load())
+                    pending.clear(); // el resto de lotes no hace falta: el lector ya sale
+
+                if (pending.empty())
+                    return false;
+
+                range = pending.front();
+                pending.pop_front();
+                ++inFlight;
+            }
+
+            const bool ok = rec->process (range.first, range.second);
+
+            {
+                const std::lock_guard<std::mutex> sl (lock);
+                --inFlight;
+                failed = failed || ! ok;
+                if (firstDoneMs < 0.0)
+                    firstDoneMs = nowMs() - startMs;
+            }
+
+            idle.notify_all();
+            return true;
+        }
+
+        void drop()
+        {
+            const std::lock_guard<std::mutex> sl (lock);
+            pending.clear();
+        }
+
+        void waitIdle()
+        {
+            while (runOne()) {}
+
+            std::unique_lock<std::mutex> sl (lock);
+            idle.wait (sl, [this] { return pending.empty() && inFlight == 0; });
+        }
+    };
+
+    //==============================================================================
+    class PipelineLoader
+    {
+    public:
+        PipelineLoader (const wtgen::DecodeLimits& limitsIn, tasks::Scheduler& schedulerIn,
+                        tasks::Priority priorityIn, std::optional<PhaseMode> phaseOverrideIn,
+                        const tasks::CancelFlag* cancelledIn)
+            : limits (limitsIn), scheduler (schedulerIn), priority (priorityIn),
+              phaseOverride (phaseOverrideIn), cancelled (cancelledIn), startMs (nowMs())
+        {
+        }
+
+        ~PipelineLoader()
+        {
+            // Ningún helper puede seguir usando rec / la tabla especulativa
+            if (batches != nullptr)
+            {
+                batches->drop();
+                batches->waitIdle();
+            }
+        }
+
+        //==============================================================================
+        bool feed (const juce::uint8* data, size_t size, juce::String& err)
+        {
+            if (mode == Mode::unknown)
+            {
+                // El magic del binario puede partirse entre bloques (no con 64 KiB, pero igual)
+                prefix.insert (prefix.end(), data, data + size);
+                if (prefix.size() < sizeof (wtgen::binaryMagic) && prefix.front() != '{')
+                    return true;
+
+                mode = wtgen::isWtgenBinary (prefix.data(), prefix.size()) ? Mode::binary : Mode::json;
+
+                std::vector<juce::uint8> first;
+                first.swap (prefix);
+
+                if (mode == Mode::binary)
+                    return feedBinary (first.data(), first.size(), err);
+
+                // BOM UTF-8 delante del JSON
+                const size_t skip = (first.size() >= 3 && first[0] == 0xef && first[1] == 0xbb && first[2] == 0xbf) ? 3 : 0;
+                return feedJson ((const char*) first.data() + skip, first.size() - skip, err);
+            }
+
+            return mode == Mode::binary ? feedBinary (data, size, err)
+                                        : feedJson ((const char*) data, size, err);
+        }
+
+        bool finish (const juce::String& nameHint, wtgen::WtSource::Ptr& outSrc,
+                     wtgen::Wavetable::Ptr& outWt, juce::String& err, wtgen::LoadStats* stats)
+        {
+            if (batches != nullptr)
+                batches->waitIdle();
+
+            if (cancelled != nullptr && cancelled->load())
+            {
+                err = "Cancelled";
+                return false;
+            }
+
+            const juce::MemoryBlock* rawData = nullptr;
+            const juce::MemoryBlock* rawFrames = nullptr;
+            std::vector<juce::MemoryBlock> blocks;
+            int spectralPayload = -1;
+            juce::var root;
+
+            if (mode == Mode::binary)
+            {
+                // Mismas reglas que parseWtgenBinary
+                if (binStage < BinStage::framesLen || (binStage == BinStage::framesLen && binFieldUsed > 0)
+                     || binStage == BinStage::frames)
+                {
+                    err = binStage < BinStage::dataLen ? "Corrupt container (meta)"
+                        : binStage < BinStage::framesLen ? "Corrupt container (data)"
+                        : "Corrupt container (frames)";
+                    return false;
+                }
+
+                blocks.resize (2);
+                for (size_t i = 0; i < payloads.size() && i < 2; ++i)
+                    blocks[i].append (payloads[i].bytes.data(), payloads[i].bytes.size());
+
+                rawData = &blocks[0];
+                rawFrames = &blocks[1];
+                spectralPayload = 0;
+
+                if (! parseMeta (root, err))
+                    return false;
+            }
+            else if (mode == Mode::json)
+            {
+                if (capturing || inString)
+                {
+                    err = "JSON parse failed: unterminated string";
+                    return false;
+                }
+
+                // Una cadena del propio fichero podría parecer un marcador: se
+                // vuelven a poner los payloads como base64 y se parsea entero
+                if (forgeableMarkers)
+                    expandMarkers();
+
+                if (! parseMeta (root, err))
+                    return false;
+
+                // Cada p.data capturado quedó como "#blobK": payload K ya decodificado
+                blocks.resize (payloads.size());
+                const auto nodes = root.getProperty ("program", {}).getProperty ("nodes", {});
+                for (int i = 0; i < 2 && ! forgeableMarkers; ++i)
+                {
+                    const auto node = nodes.isArray() && i < nodes.size() ? nodes[i] : juce::var();
+                    const auto op = node.getProperty ("op", {}).toString();
+                    const auto marker = node.getProperty ("p", {}).getProperty ("data", {}).toString();
+
+                    if (! marker.startsWith (blobMarker))
+                        continue;
+
+                    const int k = marker.fromFirstOccurrenceOf (blobMarker, false, false).getIntValue();
+                    if (! juce::isPositiveAndBelow (k, (int) payloads.size()) || ! payloads[(size_t) k].valid)
+                        continue;
+
+                    blocks[(size_t) k].append (payloads[(size_t) k].bytes.data(), payloads[(size_t) k].bytes.size());
+
+                    if (op == "spectralData" && rawData == nullptr)
+                    {
+                        rawData = &blocks[(size_t) k];
+                        spectralPayload = k;
+                    }
+                    else if (op == "timeFrames" && rawFrames == nullptr)
+                        rawFrames = &blocks[(size_t) k];
+                }
+            }
+            else
+            {
+                err = "Failed to read file";
+                return false;
+            }
+
+            payloads.clear();
+
+            wtgen::WtSource::Ptr src;
+            if (! wtgen::parseWtgenProgram (root, nameHint, limits, rawData, rawFrames, src, err))
+                return false;
+
+            wtgen::applyPhaseOverride (*src, phaseOverride);
+
+            // La especulación vale si reconstruyó este mismo payload con estos parámetros
+            const bool useSpeculative = rec != nullptr && ! streamFailed && stream.isComplete()
+                                     && ! batches->failed
+                                     && src->frames.getSize() == 0
+                                     && streamPayload == spectralPayload
+                                     && src->phaseMode == spec.phaseMode
+                                     && src->loBin == spec.loBin && src->hiBin == spec.hiBin;
+
+            wtgen::Wavetable::Ptr wt;
+            if (useSpeculative)
+            {
+                wt = specWt;
+                wt->name = src->name.isNotEmpty() ? src->name : "Wavetable";
+                wtgen::finaliseWavetable (*wt);
+                wt->sourceHash = src->contentHash;
+            }
+            else if (! wtgen::buildWavetableFromSource (*src, limits, wt, err, cancelled))
+            {
+                return false;
+            }
+
+            if (stats != nullptr)
+            {
+                stats->overlapped = useSpeculative;
+                stats->firstFramesMs = useSpeculative ? batches->firstDoneMs : -1.0;
+                stats->totalMs = nowMs() - startMs;
+            }
+
+            outSrc = src;
+            outWt = wt;
+            return true;
+        }
+
+        void cancel()
+        {
+            if (batches != nullptr)
+                batches->drop();
+        }
+
+    private:
+        enum class Mode { unknown, json, binary };
+        enum class BinStage { magic, metaLen, meta, dataLen, data, framesLen, frames, done };
+
+        struct Payload
+        {
+            std::vector<juce::uint8> bytes;
+            size_t markerAt = 0;    // posición del marcador en meta
+            bool valid = true;      // false: el texto volvió al meta (lo decodifica el parse)
+        };
+
+        static constexpr const char* blobMarker = "#blob";
+
+        // Posición en el documento: solo program.nodes[0|1].p.data se captura, que es
+        // lo único que parseWtgenProgram lee
+        enum class Key { other, program, nodes, p, data };
+
+        struct Level
+        {
+            bool object = false;
+            bool expectKey = false;
+            Key key = Key::other;   // objeto: clave cuyo valor se está leyendo
+            int index = 0;          // array: elemento actual
+        };
+
+        static constexpr int pathDepth = 5;
+
+        //==============================================================================
+        bool feedJson (const char* text, size_t size, juce::String& err)
+        {
+            size_t i = 0;
+            while (i < size)
+            {
+                if (capturing)
+                {
+                    i = captureRun (text, i, size);
+                    if (! onPayloadData (err))
+                        return false;
+                    continue;
+                }
+
+                const char c = text[i++];
+                meta += c;
+
+                if (inString)
+                {
+                    // Un valor que empieza por '#' (o por un escape) podría imitar un marcador
+                    if (stringStart && ! inKey && (c == '#' || c == '\\'))
+                        forgeableMarkers = true;
+                    stringStart = false;
+
+                    if (escape)
+                    {
+                        escape = false;
+                    }
+                    else if (c == '\\')
+                    {
+                        escape = true;
+                        token = "\\"; // una clave con escapes no se reconoce: su valor no se captura
+                    }
+                    else if (c == '"')
+                    {
+                        inString = false;
+                        if (auto* level = top(); level != nullptr && inKey)
+                            level->key = classifyKey (token);
+                    }
+                    else if (inKey && token.size() <= 7)
+                    {
+                        token += c;
+                    }
+                    continue;
+                }
+
+                auto* level = top();
+
+                if (c == '"')
+                {
+                    inKey = level != nullptr && level->object && level->expectKey;
+
+                    if (! inKey && atPayloadValue() && (int) payloads.size() < maxPayloads)
+                    {
+                        payloads.emplace_back();
+                        base64.reset();
+                        capturing = true;
+                        continue;
+                    }
+
+                    inString = true;
+                    stringStart = true;
+                    token.clear();
+                }
+                else if (c == '{' || c == '[')
+                {
+                    if (depth < pathDepth)
+                    {
+                        path[depth] = {};
+                        path[depth].object = c == '{';
+                        path[depth].expectKey = c == '{';
+                    }
+                    ++depth;
+                }
+                else if (c == '}' || c == ']')
+                {
+                    depth = juce::jmax (0, depth - 1);
+                }
+                else if (c == ',' && level != nullptr)
+                {
+                    if (level->object)
+                    {
+                        level->expectKey = true;
+                        level->key = Key::other;
+                    }
+                    else
+                    {
+                        ++level->index;
+                    }
+                }
+                else if (c == ':' && level != nullptr && level->object)
+                {
+                    level->expectKey = false;
+                }
+            }
+
+            return true;
+        }
+
+        // Tramo de p.data: base64 -> payload. Devuelve dónde sigue el texto
+        size_t captureRun (const char* text, size_t i, size_t size)
+        {
+            auto& payload = currentPayload();
+
+            for (; i < size; ++i)
+            {
+                const char c = text[i];
+
+                if (escape)
+                {
+                    // "\/" es '/' escapado; cualquier otro escape lo resuelve el parse final
+                    escape = false;
+                    if (c == '/' && base64.push (c, payload.bytes))
+                        continue;
+
+                    restoreCapture();
+                    meta += '\\';
+                    meta += c;
+                    inString = true;
+                    inKey = stringStart = false;
+                    return i + 1;
+                }
+
+                if (c == '\\')
+                {
+                    escape = true;
+                    continue;
+                }
+
+                if (c == '"')
+                {
+                    // Fin de p.data: el meta queda con el marcador. Vacío o grupo a medias:
+                    // la cadena vuelve al meta y el parse final da el error exacto
+                    if (payload.bytes.empty() || ! base64.isComplete())
+                    {
+                        restoreCapture();
+                        meta += '"';
+                    }
+                    else
+                    {
+                        payload.markerAt = meta.size();
+                        meta += blobMarker + std::to_string (payloads.size() - 1) + "\"";
+                        capturing = false;
+                    }
+                    return i + 1;
+                }
+
+                if (! base64.push (c, payload.bytes))
+                {
+                    restoreCapture();
+                    meta += c;
+                    inString = true;
+                    inKey = stringStart = false;
+                    return i + 1;
+                }
+            }
+
+            return i;
+        }
+
+        // La cadena capturada no es base64 que juce::Base64 acepte igual: vuelve al meta
+        // como texto y parseWtgenProgram la decodifica (o da su error). Los bytes se
+        // quedan hasta finish(): la reconstrucción especulativa puede estar leyéndolos.
+        void restoreCapture()
+        {
+            auto& payload = currentPayload();
+            const auto text = base64.getText (payload.bytes);
+
+            // Vacío: la cadena empieza por lo que no era base64 ('#', un escape...)
+            if (text.empty())
+                forgeableMarkers = true;
+
+            meta += text;
+            payload.valid = false;
+            capturing = false;
+
+            if ((int) payloads.size() - 1 == streamPayload)
+                streamFailed = true;
+        }
+
+        // Marcadores -> base64 canónico de cada payload (mismos bytes al decodificar)
+        void expandMarkers()
+        {
+            std::string expanded;
+            size_t from = 0;
+
+            for (size_t k = 0; k < payloads.size(); ++k)
+            {
+                const auto& payload = payloads[k];
+                if (! payload.valid)
+                    continue;
+
+                const auto marker = blobMarker + std::to_string (k);
+                expanded.append (meta, from, payload.markerAt - from);
+                expanded += juce::Base64::toBase64 (payload.bytes.data(), payload.bytes.size()).toStdString();
+                from = payload.markerAt + marker.size();
+            }
+
+            expanded.append (meta, from, std::string::npos);
+            meta.swap (expanded);
+
+            for (auto& payload : payloads)
+                payload.valid = false;
+        }
+
+        Level* top() noexcept
+        {
+            return depth > 0 && depth <= pathDepth ? &path[depth - 1] : nullptr;
+        }
+
+        bool atPayloadValue() const noexcept
+        {
+            return depth == pathDepth
+                && path[0].object && path[0].key == Key::program
+                && path[1].object && path[1].key == Key::nodes
+                && ! path[2].object && path[2].index < 2
+                && path[3].object && path[3].key == Key::p
+                && path[4].object && path[4].key == Key::data && ! path[4].expectKey;
+        }
+
+        static Key classifyKey (const std::string& key)
+        {
+            if (key == "program") return Key::program;
+            if (key == "nodes")   return Key::nodes;
+            if (key == "p")       return Key::p;
+            if (key == "data")    return Key::data;
+            return Key::other;
+        }
+
+        Payload& currentPayload() { return payloads.back(); }
+
+        //==============================================================================
+        bool feedBinary (const juce::uint8* data, size_t size, juce::String& err)
+        {
+            size_t i = 0;
+            while (i < size)
+            {
+                switch (binStage)
+                {
+                    case BinStage::magic:
+                    case BinStage::metaLen:
+                    case BinStage::dataLen:
+                    case BinStage::framesLen:
+                    {
+                        const size_t need = binStage == BinStage::magic ? sizeof (wtgen::binaryMagic) : 4;
+                        const size_t n = juce::jmin (need - binFieldUsed, size - i);
+                        std::memcpy (binField + binFieldUsed, data + i, n);
+                        binFieldUsed += n;
+                        i += n;
+
+                        if (binFieldUsed < need)
+                            break;
+
+                        binFieldUsed = 0;
+                        const auto value = (size_t) juce::ByteOrder::littleEndianInt (binField);
+
+                        if (binStage == BinStage::magic)
+                        {
+                            binStage = BinStage::metaLen;
+                        }
+                        else if (binStage == BinStage::metaLen)
+                        {
+                            if (value > limits.maxJsonBytes)
+                            {
+                                err = "Corrupt container (meta)";
+                                return false;
+                            }
+                            binRemaining = value;
+                            binStage = BinStage::meta;
+                        }
+                        else if (binStage == BinStage::dataLen)
+                        {
+                            if (value > limits.maxDataBytes)
+                            {
+                                err = "Framepack too large";
+                                return false;
+                            }
+                            binRemaining = value;
+                            binStage = BinStage::data;
+                            payloads.emplace_back();
+                        }
+                        else
+                        {
+                            binRemaining = value;
+                            binStage = BinStage::frames;
+                            payloads.emplace_back();
+                        }
+                        break;
+                    }
+
+                    case BinStage::meta:
+                    {
+                        const size_t n = juce::jmin (binRemaining, size - i);
+                        meta.append ((const char*) data + i, n);
+                        i += n;
+                        binRemaining -= n;
+                        break;
+                    }
+
+                    case BinStage::data:
+                    case BinStage::frames:
+                    {
+                        const size_t n = juce::jmin (binRemaining, size - i);
+                        auto& bytes = currentPayload().bytes;
+                        bytes.insert (bytes.end(), data + i, data + i + n);
+                        i += n;
+                        binRemaining -= n;
+
+                        if (binStage == BinStage::data && ! onPayloadData (err))
+                            return false;
+                        break;
+                    }
+
+                    case BinStage::done:
+                        return true; // bytes sobrantes: se ignoran, como en parseWtgenBinary
+                }
+
+                // Un tramo de longitud 0 también avanza de etapa
+                if (binRemaining == 0)
+                {
+                    if (binStage == BinStage::meta)        binStage = BinStage::dataLen;
+                    else if (binStage == BinStage::data)   binStage = BinStage::framesLen;
+                    else if (binStage == BinStage::frames) binStage = BinStage::done;
+                }
+            }
+
+            return true;
+        }
+
+        //==============================================================================
+        // Payload nuevo / más bytes: si es un framepack, filas nuevas -> lotes
+        bool onPayloadData (juce::String& err)
+        {
+            if (payloads.empty() || streamFailed)
+                return true;
+
+            const int index = (int) payloads.size() - 1;
+            const auto& payload = payloads.back();
+
+            if (streamPayload < 0)
+            {
+                // Solo el primer framepack; con frames precalculados no se reconstruye nada
+                if (! payload.valid || payload.bytes.size() < 7
+                     || std::memcmp (payload.bytes.data(), "HNFPv", 5) != 0
+                     || meta.find ("\"timeFrames\"") != std::string::npos)
+                    return true;
+
+                streamPayload = index;
+                spec = speculateParams (meta, phaseOverride);
+            }
+
+            if (index != streamPayload)
+                return true;
+
+            // Un framepack corrupto no aborta aquí: el parse final da el error exacto
+            juce::String streamErr;
+            if (! payload.valid || ! stream.advance (payload.bytes.data(), payload.bytes.size(), limits, streamErr))
+            {
+                streamFailed = true;
+                return true;
+            }
+
+            if (! stream.hasHeader())
+                return true;
+
+            if (rec == nullptr)
+                startReconstruction();
+
+            queueReadyFrames();
+
+            if (limits.maxDecodeSeconds > 0.0 && nowMs() - startMs > limits.maxDecodeSeconds * 1000.0)
+            {
+                err = "Decode time budget exceeded";
+                return false;
+            }
+            return true;
+        }
+
+        void startReconstruction()
+        {
+            const auto& header = stream.getV1Header();
+
+            specWt = new wtgen::Wavetable();
+            specWt->tableSize = header.tableSize;
+            specWt->frames = header.frames;
+            specWt->table.setSize (header.frames, header.tableSize);
+            specWt->table.clear();
+
+            rec = std::make_unique<wtgen::FrameReconstruction> (stream.getV1Bytes(), stream.getV1Size(), header,
+                                                                spec.loBin, spec.hiBin, spec.phaseMode,
+                                                                limits, specWt->table);
+
+            batches = std::make_shared<Batches>();
+            batches->rec = rec.get();
+            batches->cancelled = cancelled;
+            batches->startMs = startMs;
+        }
+
+        void queueReadyFrames()
+        {
+            const int total = stream.getV1Header().frames;
+            const int ready = stream.getFramesReady();
+            const size_t maxQueued = (size_t) scheduler.getNumWorkers() * 2;
+
+            while (framesQueued < ready)
+            {
+                const int n = juce::jmin (batched::lanes, ready - framesQueued);
+                if (n < batched::lanes && ready < total)
+                    break; // lote incompleto: esperar a más filas
+
+                size_t queued = 0;
+                {
+                    const std::lock_guard<std::mutex> sl (batches->lock);
+                    batches->pending.emplace_back (framesQueued, n);
+                    queued = batches->pending.size();
+                }
+                framesQueued += n;
+
+                auto shared = batches;
+                scheduler.submit (nullptr, priority, [shared] (const tasks::CancelFlag&)
+                {
+                    while (shared->runOne()) {}
+                });
+
+                // Cola llena: el lector reconstruye un lote en vez de esperar
+                if (queued > maxQueued)
+                    batches->runOne();
+            }
+        }
+
+        bool parseMeta (juce::var& root, juce::String& err)
+        {
+            if (! juce::CharPointer_UTF8::isValidString (meta.data(), (int) meta.size()))
+            {
+                err = mode == Mode::binary ? "Corrupt container (meta is not UTF-8)"
+                                           : "JSON parse failed: invalid UTF-8";
+                return false;
+            }
+
+            const auto parseRes = juce::JSON::parse (juce::String::fromUTF8 (meta.data(), (int) meta.size()), root);
+            if (parseRes.failed())
+            {
+                err = "JSON parse failed: " + parseRes.getErrorMessage();
+                return false;
+            }
+            return true;
+        }
+
+        //==============================================================================
+        const wtgen::DecodeLimits limits;
+        tasks::Scheduler& scheduler;
+        const tasks::Priority priority;
+        const std::optional<PhaseMode> phaseOverride;
+        const tasks::CancelFlag* const cancelled;
+        const double startMs;
+
+        Mode mode = Mode::unknown;
+        std::vector<juce::uint8> prefix;
+        std::string meta;                 // JSON sin los payloads (marcadores en su lugar)
+        std::vector<Payload> payloads;
+
+        // JSON
+        Base64Stream base64;
+        std::string token;                // clave en curso (basta con las 7 primeras letras)
+        Level path[pathDepth];
+        int depth = 0;
+        bool inString = false, inKey = false, stringStart = false, escape = false, capturing = false;
+        bool forgeableMarkers = false;
+
+        // Binario
+        BinStage binStage = BinStage::magic;
+        juce::uint8 binField[8] = {};
+        size_t binFieldUsed = 0;
+        size_t binRemaining = 0;
+
+        // Reconstrucción especulativa
+        int streamPayload = -1;
+        bool streamFailed = false;
+        SpecParams spec;
+        wtgen::FramepackStream stream;
+        wtgen::Wavetable::Ptr specWt;
+        std::unique_ptr<wtgen::FrameReconstruction> rec;
+        std::shared_ptr<Batches> batches;
+        int framesQueued = 0;
+    };
+}
+
+//==============================================================================
+namespace wtgen
+{
+    bool loadWtgenPipelined (juce::InputStream& in,
+                             const juce::String& nameHint,
+                             const DecodeLimits& limits,
+                             tasks::Scheduler& scheduler,
+                             tasks::Priority priority,
+                             std::optional<PhaseMode> phaseOverride,
+                             WtSource::Ptr& outSrc,
+                             Wavetable::Ptr& outWt,
+                             juce::String& err,
+                             LoadStats* stats,
+                             const tasks::CancelFlag* cancelled)
+    {
+        outSrc = nullptr;
+        outWt = nullptr;
+
+        const auto totalLength = in.getTotalLength();
+        if (totalLength > (juce::int64) limits.maxJsonBytes)
+        {
+            err = "File too large";
+            return false;
+        }
+
+        PipelineLoader loader (limits, scheduler, priority, phaseOverride, cancelled);
+
+        std::vector<juce::uint8> chunk (chunkBytes);
+        size_t totalRead = 0;
+        int chunks = 0;
+
+        for (;;)
+        {
+            if (cancelled != nullptr && cancelled->load())
+            {
+                loader.cancel();
+                err = "Cancelled";
+                return false;
+            }
+
+            const int n = in.read (chunk.data(), (int) chunk.size());
+            if (n <= 0)
+                break;
+
+            totalRead += (size_t) n;
+            ++chunks;
+
+            if (totalRead > limits.maxJsonBytes)
+            {
+                err = "File too large";
+                return false;
+            }
+
+            if (! loader.feed (chunk.data(), (size_t) n, err))
+                return false;
+        }
+
+        if (totalRead == 0)
+        {
+            err = "Failed to read file";
+            return false;
+        }
+
+        if (! loader.finish (nameHint, outSrc, outWt, err, stats))
+            return false;
+
+        if (stats != nullptr)
+            stats->chunks = chunks;
+
+        return true;
+    }
+}
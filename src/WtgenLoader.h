@@ -0,0 +1,50 @@
+#pragma once
+#include <JuceHeader.h>
+
+#include "WtgenDecoder.h"
+#include "TaskScheduler.h"
+
+#include <optional>
+
+//==============================================================================
+// Carga en pipeline de .wtgen.json / .wtgen.bin
+//
+//   lectura por bloques -> base64 incremental (JSON) / bloques crudos (binario)
+//   -> FramepackStream (filas v1) -> reconstrucción por lotes en el pool
+//   -> parse del meta + finalise
+//
+// La reconstrucción de los primeros frames arranca mientras el resto del fichero
+// aún se está leyendo. Entre lectura y reconstrucción hay una cola acotada: si se
+// llena, el hilo lector reconstruye él mismo un lote (sin bloquearse).
+//
+// Fase y banding hacen falta antes del final del fichero: se toman del texto ya
+// visto (en el binario el meta va primero, así que son exactos; en JSON salen del
+// nodo spectralData antes de p.data). Si el parse final no coincide, la tabla se
+// reconstruye otra vez con los valores reales. En JSON solo se captura
+// program.nodes[0|1].p.data, y solo si es base64 que juce::Base64 decodifica igual;
+// si no, la cadena se queda en el meta y la decodifica el parse final. El resultado
+// es siempre el mismo que parse* + buildWavetableFromSource.
+namespace wtgen
+{
+    struct LoadStats
+    {
+        double firstFramesMs = -1.0;  // primer lote reconstruido (-1: sin solape)
+        double totalMs       = 0.0;
+        int    chunks        = 0;
+        bool   overlapped    = false; // la reconstrucción especulativa se usó tal cual
+    };
+
+    // phaseOverride: como la opción de carga del processor (solo con datos espectrales).
+    // cancelled: abandona la lectura (p.ej. la instancia se destruye)
+    bool loadWtgenPipelined (juce::InputStream& in,
+                             const juce::String& nameHint,
+                             const DecodeLimits& limits,
+                             tasks::Scheduler& scheduler,
+                             tasks::Priority priority,
+                             std::optional<PhaseMode> phaseOverride,
+                             WtSource::Ptr& outSrc,
+                             Wavetable::Ptr& outWt,
+                             juce::String& err,
+                             LoadStats* stats = nullptr,
+                             const tasks::CancelFlag* cancelled = nullptr);
+}
@@ -0,0 +1,600 @@
+/*
+  ==============================================================================
+
+    BenchMain.cpp
+    - Offline benchmarks for BasicInstrument (console app, no host/DAW)
+    - "instances": N processors in one process, rendered on M host-like threads
+    - "decode": wavetable decode cost per reconstruction mode and FFT backend,
+      plus the pipelined loader (read/reconstruction overlap). Multi-frame
+      minimum phase is timed once batched (backend-independent) and then per
+      backend with batching off, both chosen per decode via DecodeLimits
+
+    Uso:
+      BasicInstrumentBench instances [--instances N] [--threads M] [--seconds S]
+                                     [--rate SR] [--block B] [--density NPS]
+                                     [--distinct] [--playback] [--sync] [--pm] [--drive] [--vector] file1.wtgen.json [file2 ...]
+      BasicInstrumentBench decode [--repeat R] file1.wtgen.json [file2 ...]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "WtgenDecoder.h"
+#include "WtgenLoader.h"
+#include "FftBackend.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    static double secondsSince (Clock::time_point t0)
+    {
+        return std::chrono::duration<double> (Clock::now() - t0).count();
+    }
+
+    static juce::String formatBytes (double bytes)
+    {
+        if (bytes >= 1024.0 * 1024.0)
+            return juce::String (bytes / (1024.0 * 1024.0), 2) + " MiB";
+        if (bytes >= 1024.0)
+            return juce::String (bytes / 1024.0, 1) + " KiB";
+        return juce::String ((juce::int64) bytes) + " B";
+    }
+
+    static void print (const juce::String& s)
+    {
+        std::cout << s << std::endl;
+    }
+
+    //==============================================================================
+    struct InstancesOptions
+    {
+        int    instances      = 50;
+        int    threads        = juce::jmax (1, (int) std::thread::hardware_concurrency());
+        double seconds        = 10.0;
+        double sampleRate     = 48000.0;
+        int    blockSize      = 256;
+        double notesPerSecond = 4.0;   // typical MIDI density per instance
+        bool   distinct       = false; // each instance gets a rotated file->slot mapping
+        bool   playback       = false; // wt_mode = Playback (frames advance over time)
+        bool   sync           = false; // osc2 audible and hard-synced to osc1
+        bool   pm             = false; // osc2 modulates osc1's phase (oversampled voices)
+        bool   drive          = false; // per-voice ADAA waveshaper on
+        bool   vector         = false; // XY blend of the 4 slots with an LFO orbit
+        juce::Array<juce::File> files;
+    };
+
+    static bool parseInstancesOptions (const juce::StringArray& args, InstancesOptions& o, juce::String& err)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& a = args[i];
+            auto next = [&]() -> juce::String
+            {
+                if (i + 1 >= args.size())
+                {
+                    err = "Missing value for " + a;
+                    return {};
+                }
+                return args[++i];
+            };
+
+            if      (a == "--instances") o.instances      = next().getIntValue();
+            else if (a == "--threads")   o.threads        = next().getIntValue();
+            else if (a == "--seconds")   o.seconds        = next().getDoubleValue();
+            else if (a == "--rate")      o.sampleRate     = next().getDoubleValue();
+            else if (a == "--block")     o.blockSize      = next().getIntValue();
+            else if (a == "--density")   o.notesPerSecond = next().getDoubleValue();
+            else if (a == "--distinct")  o.distinct       = true;
+            else if (a == "--playback")  o.playback       = true;
+            else if (a == "--sync")      o.sync           = true;
+            else if (a == "--pm")        o.pm             = true;
+            else if (a == "--drive")     o.drive          = true;
+            else if (a == "--vector")    o.vector         = true;
+            else if (a.startsWith ("--"))
+            {
+                err = "Unknown option " + a;
+                return false;
+            }
+            else
+            {
+                const auto f = juce::File::getCurrentWorkingDirectory().getChildFile (a);
+                if (! f.existsAsFile())
+                {
+                    err = "File does not exist: " + a;
+                    return false;
+                }
+                o.files.add (f);
+            }
+
+            if (err.isNotEmpty())
+                return false;
+        }
+
+        if (o.instances <= 0 || o.threads <= 0 || o.seconds <= 0.0 || o.sampleRate <= 0.0 || o.blockSize <= 0)
+        {
+            err = "Invalid numeric option";
+            return false;
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    // Random but reproducible note stream (one per instance)
+    struct MidiPattern
+    {
+        explicit MidiPattern (unsigned int seed) : rng (seed) {}
+
+        void fill (juce::MidiBuffer& midi, juce::int64 blockStart, int numSamples, const InstancesOptions& o)
+        {
+            midi.clear();
+            const auto blockEnd = blockStart + numSamples;
+
+            for (auto it = active.begin(); it != active.end();)
+            {
+                if (it->offSample < blockEnd)
+                {
+                    midi.addEvent (juce::MidiMessage::noteOff (1, it->note),
+                                   (int) juce::jmax<juce::int64> (0, it->offSample - blockStart));
+                    it = active.erase (it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+
+            if (o.notesPerSecond <= 0.0)
+                return;
+
+            std::exponential_distribution<double> gap (o.notesPerSecond);
+            std::uniform_int_distribution<int> noteDist (36, 84);
+            std::uniform_real_distribution<double> lenDist (0.1, 1.5);
+            std::uniform_int_distribution<int> velDist (40, 120);
+
+            while (nextOn < blockEnd)
+            {
+                const auto pos = (int) juce::jmax<juce::int64> (0, nextOn - blockStart);
+                const int note = noteDist (rng);
+
+                midi.addEvent (juce::MidiMessage::noteOn (1, note, (juce::uint8) velDist (rng)), pos);
+                active.push_back ({ note, nextOn + (juce::int64) (lenDist (rng) * o.sampleRate) });
+
+                nextOn += juce::jmax<juce::int64> (1, (juce::int64) (gap (rng) * o.sampleRate));
+            }
+        }
+
+        struct ActiveNote { int note; juce::int64 offSample; };
+
+        std::mt19937 rng;
+        std::vector<ActiveNote> active;
+        juce::int64 nextOn = 0;
+    };
+
+    //==============================================================================
+    static int runInstances (const juce::StringArray& args)
+    {
+        InstancesOptions o;
+        juce::String err;
+        if (! parseInstancesOptions (args, o, err))
+        {
+            print ("error: " + err);
+            return 1;
+        }
+
+        const int N = o.instances;
+        const int M = juce::jmin (o.threads, N);
+
+        print ("instances=" + juce::String (N) + " threads=" + juce::String (M)
+               + " seconds=" + juce::String (o.seconds) + " rate=" + juce::String (o.sampleRate)
+               + " block=" + juce::String (o.blockSize) + " density=" + juce::String (o.notesPerSecond) + "/s"
+               + " files=" + juce::String (o.files.size()) + (o.distinct ? " (distinct)" : " (same)")
+               + (o.playback ? " playback" : "") + (o.sync ? " sync" : "")
+               + (o.pm ? " pm" : "") + (o.drive ? " drive" : "")
+               + (o.vector ? " vector" : ""));
+
+        std::vector<std::unique_ptr<BasicInstrumentAudioProcessor>> procs;
+        procs.reserve ((size_t) N);
+
+        const auto tCreate = Clock::now();
+        for (int i = 0; i < N; ++i)
+        {
+            procs.push_back (std::make_unique<BasicInstrumentAudioProcessor>());
+            procs.back()->prepareToPlay (o.sampleRate, o.blockSize);
+
+            if (o.playback)
+                if (auto* mode = procs.back()->apvts.getParameter ("wt_mode"))
+                    mode->setValueNotifyingHost (1.0f);
+
+            if (o.sync)
+            {
+                for (auto* id : { "osc2_sync", "osc2_level" })
+                    if (auto* p = procs.back()->apvts.getParameter (id))
+                        p->setValueNotifyingHost (1.0f);
+            }
+
+            if (o.pm)
+                if (auto* p = procs.back()->apvts.getParameter ("pm_2_1"))
+                    p->setValueNotifyingHost (0.5f);
+
+            if (o.drive)
+                if (auto* p = procs.back()->apvts.getParameter ("drive"))
+                    p->setValueNotifyingHost (0.5f);
+
+            if (o.vector)
+            {
+                for (auto* id : { "vector_mode", "vector_lfo_depth" })
+                    if (auto* p = procs.back()->apvts.getParameter (id))
+                        p->setValueNotifyingHost (1.0f);
+            }
+        }
+        const double createSeconds = secondsSince (tCreate);
+
+        // --- Load slots on M threads (like a parallel session restore)
+        std::atomic<int> loadFailures { 0 };
+        std::vector<double> loadSeconds ((size_t) N, 0.0);
+
+        const auto tLoad = Clock::now();
+        {
+            std::vector<std::thread> loaders;
+            for (int t = 0; t < M; ++t)
+            {
+                loaders.emplace_back ([&, t]
+                {
+                    for (int i = t; i < N; i += M)
+                    {
+                        const auto t0 = Clock::now();
+                        // Como un cambio de preset: todos los slots en una transacción
+                        const int numSlots = juce::jmin (4, o.files.size());
+                        std::vector<BasicInstrumentAudioProcessor::SlotLoad> loads;
+                        for (int s = 0; s < numSlots; ++s)
+                        {
+                            const int fileIndex = o.distinct ? (i + s) % o.files.size() : s;
+                            loads.push_back ({ s, o.files[fileIndex], std::nullopt });
+                        }
+
+                        juce::String loadErr;
+                        if (! procs[(size_t) i]->loadWtgenSlots (loads, loadErr))
+                            ++loadFailures;
+                        loadSeconds[(size_t) i] = secondsSince (t0);
+                    }
+                });
+            }
+            for (auto& th : loaders)
+                th.join();
+        }
+        const double loadWall = secondsSince (tLoad);
+
+        // --- Render on M threads, each owning a fixed subset of instances
+        const auto totalSamples = (juce::int64) (o.seconds * o.sampleRate);
+        const double blockBudget = (double) o.blockSize / o.sampleRate;
+
+        std::vector<MidiPattern> patterns;
+        patterns.reserve ((size_t) N);
+        for (int i = 0; i < N; ++i)
+            patterns.emplace_back ((unsigned int) (1234 + i));
+
+        std::vector<double> threadBusy ((size_t) M, 0.0);
+        std::vector<double> threadWorstBlock ((size_t) M, 0.0);
+        std::vector<int> threadLateBlocks ((size_t) M, 0);
+
+        const auto tRender = Clock::now();
+        {
+            std::vector<std::thread> workers;
+            for (int t = 0; t < M; ++t)
+            {
+                workers.emplace_back ([&, t]
+                {
+                    juce::AudioBuffer<float> buffer (2, o.blockSize);
+                    juce::MidiBuffer midi;
+
+                    for (juce::int64 pos = 0; pos < totalSamples; pos += o.blockSize)
+                    {
+                        const int n = (int) juce::jmin<juce::int64> (o.blockSize, totalSamples - pos);
+                        buffer.setSize (2, n, false, false, true);
+
+                        const auto t0 = Clock::now();
+                        for (int i = t; i < N; i += M)
+                        {
+                            patterns[(size_t) i].fill (midi, pos, n, o);
+                            procs[(size_t) i]->processBlock (buffer, midi);
+                        }
+                        const double dt = secondsSince (t0);
+
+                        threadBusy[(size_t) t] += dt;
+                        threadWorstBlock[(size_t) t] = juce::jmax (threadWorstBlock[(size_t) t], dt);
+                        if (dt > blockBudget * (double) n / (double) o.blockSize)
+                            ++threadLateBlocks[(size_t) t];
+                    }
+                });
+            }
+            for (auto& th : workers)
+                th.join();
+        }
+        const double renderWall = secondsSince (tRender);
+
+        // --- Report
+        double busy = 0.0, worst = 0.0;
+        int late = 0;
+        for (int t = 0; t < M; ++t)
+        {
+            busy += threadBusy[(size_t) t];
+            worst = juce::jmax (worst, threadWorstBlock[(size_t) t]);
+            late += threadLateBlocks[(size_t) t];
+        }
+
+        const double audioSeconds = (double) totalSamples / o.sampleRate;
+        print ("");
+        print ("[render]");
+        print ("  realtime factor (session)   : " + juce::String (audioSeconds / renderWall, 2) + "x");
+        print ("  realtime factor (per inst.) : " + juce::String (audioSeconds * N / juce::jmax (busy, 1.0e-9), 2) + "x of one core");
+        print ("  worst block / budget        : " + juce::String (worst * 1000.0, 3) + " ms / "
+               + juce::String (blockBudget * 1000.0, 3) + " ms");
+        print ("  late blocks                 : " + juce::String (late));
+
+        double loadSum = 0.0, loadMax = 0.0;
+        for (auto s : loadSeconds)
+        {
+            loadSum += s;
+            loadMax = juce::jmax (loadMax, s);
+        }
+
+        print ("");
+        print ("[load]");
+        print ("  create " + juce::String (N) + " instances  : " + juce::String (createSeconds * 1000.0, 1) + " ms");
+        print ("  load wall time              : " + juce::String (loadWall * 1000.0, 1) + " ms");
+        print ("  per instance avg / max      : " + juce::String (loadSum * 1000.0 / N, 2) + " ms / "
+               + juce::String (loadMax * 1000.0, 2) + " ms");
+        print ("  failures                    : " + juce::String (loadFailures.load()));
+
+        // --- Memory + sharing
+        BasicInstrumentAudioProcessor::MemoryStats sum;
+        for (auto& p : procs)
+        {
+            const auto st = p->getMemoryStats();
+            sum.wavetableBytes += st.wavetableBytes;
+            sum.sourceBytes    += st.sourceBytes;
+            sum.stateBytes     += st.stateBytes;
+            sum.voiceBytes     += st.voiceBytes;
+            sum.wavetables     += st.wavetables;
+        }
+
+        const auto proc = BasicInstrumentAudioProcessor::getProcessMemoryStats();
+
+        print ("");
+        print ("[memory per instance]");
+        print ("  wavetables                  : " + formatBytes ((double) sum.wavetableBytes / N));
+        print ("  retained slot source        : " + formatBytes ((double) sum.sourceBytes / N));
+        print ("  state                       : " + formatBytes ((double) sum.stateBytes / N));
+        print ("  voices                      : " + formatBytes ((double) sum.voiceBytes / N));
+
+        print ("");
+        print ("[memory process-wide]");
+        print ("  total                       : " + formatBytes ((double) proc.getTotalBytes()));
+        print ("  shared caches               : " + formatBytes ((double) proc.cacheBytes));
+        print ("  duplicate retention         : " + formatBytes ((double) proc.duplicateBytes));
+
+        const int hits = sum.wavetables - proc.wavetables;
+        print ("");
+        print ("[shared resources]");
+        print ("  wavetable slot refs / unique: " + juce::String (sum.wavetables) + " / " + juce::String (proc.wavetables));
+        print ("  wavetable share hit rate    : "
+               + juce::String (sum.wavetables > 0 ? 100.0 * hits / sum.wavetables : 0.0, 1) + "%");
+        print ("  unique table bytes          : " + formatBytes ((double) proc.wavetableBytes)
+               + " (of " + formatBytes ((double) sum.wavetableBytes) + ")");
+
+        return loadFailures.load() == 0 ? 0 : 2;
+    }
+
+    //==============================================================================
+    static int runDecode (const juce::StringArray& args)
+    {
+        int repeat = 5;
+        juce::Array<juce::File> files;
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            if (args[i] == "--repeat" && i + 1 < args.size())
+                repeat = juce::jmax (1, args[++i].getIntValue());
+            else
+                files.add (juce::File::getCurrentWorkingDirectory().getChildFile (args[i]));
+        }
+
+        if (files.isEmpty())
+        {
+            print ("error: no input files");
+            return 1;
+        }
+
+        using PhaseMode = BasicInstrumentAudioProcessor::PhaseMode;
+        const PhaseMode modes[] = { PhaseMode::minimum, PhaseMode::zero, PhaseMode::fixed };
+        const wtgen::DecodeLimits limits;
+
+        for (const auto& f : files)
+        {
+            const auto t0 = Clock::now();
+            juce::MemoryBlock contents;
+            f.loadFileAsData (contents);
+
+            wtgen::WtSource::Ptr src;
+            juce::String err;
+            const auto name = f.getFileNameWithoutExtension();
+            const bool parsed = wtgen::isWtgenBinary (contents.getData(), contents.getSize())
+                                  ? wtgen::parseWtgenBinary (contents.getData(), contents.getSize(), name, limits, src, err)
+                                  : wtgen::parseWtgenJson (contents.toString(), name, limits, src, err);
+            if (! parsed)
+            {
+                print (f.getFileName() + ": " + err);
+                return 1;
+            }
+            const double parseMs = secondsSince (t0) * 1000.0;
+
+            wtgen::FramepackHeader header;
+            wtgen::parseFramepackHeader ((const juce::uint8*) src->data.getData(), src->data.getSize(),
+                                         limits, header, err);
+
+            print ("");
+            print (f.getFileName() + "  N=" + juce::String (header.tableSize) + " F=" + juce::String (header.frames)
+                   + " H=" + juce::String (header.harmonics) + " B=" + juce::String (header.bands)
+                   + "  " + src->codec + " " + juce::String ((juce::int64) contents.getSize()) + " bytes"
+                   + "  read+parse " + juce::String (parseMs, 2) + " ms");
+
+            // Pipeline (lectura + reconstrucción solapadas) con la fase del fichero
+            {
+                juce::SharedResourcePointer<tasks::Scheduler> scheduler;
+                double best = 1.0e30;
+                wtgen::LoadStats bestStats;
+
+                for (int r = 0; r < repeat; ++r)
+                {
+                    juce::FileInputStream in (f);
+                    wtgen::WtSource::Ptr pipeSrc;
+                    wtgen::Wavetable::Ptr pipeWt;
+                    wtgen::LoadStats stats;
+
+                    if (! in.openedOk()
+                        || ! wtgen::loadWtgenPipelined (in, name, limits, *scheduler, tasks::Priority::interactive,
+                                                        std::nullopt, pipeSrc, pipeWt, err, &stats))
+                    {
+                        print ("  pipelined: " + err);
+                        return 1;
+                    }
+
+                    if (stats.totalMs < best)
+                    {
+                        best = stats.totalMs;
+                        bestStats = stats;
+                    }
+                }
+
+                print ("  pipelined (" + wtgen::getPhaseModeName (src->phaseMode) + ", "
+                       + juce::String (scheduler->getNumWorkers()) + " workers)  "
+                       + juce::String (best, 3) + " ms total  first frames "
+                       + (bestStats.firstFramesMs >= 0.0 ? juce::String (bestStats.firstFramesMs, 3) + " ms" : juce::String ("n/a"))
+                       + "  " + juce::String (bestStats.chunks) + " chunks"
+                       + (bestStats.overlapped ? "" : "  (no overlap)"));
+            }
+
+            double minimumMs = 0.0;
+            const auto backends = fft::getAvailableBackends();
+
+            // Backend y lotes van en las opciones de cada decode (nada global)
+            auto timeBuild = [&] (fft::Backend backend, bool batchFrames, double& outMs)
+            {
+                auto options = limits;
+                options.fftBackend = backend;
+                options.batchFrames = batchFrames;
+
+                outMs = 1.0e30;
+                for (int r = 0; r < repeat; ++r)
+                {
+                    wtgen::Wavetable::Ptr wt;
+                    const auto tb = Clock::now();
+                    if (! wtgen::buildWavetableFromSource (*src, options, wt, err))
+                        return false;
+                    outMs = juce::jmin (outMs, secondsSince (tb) * 1000.0);
+                }
+                return true;
+            };
+
+            auto printRow = [&] (PhaseMode mode, const juce::String& label, double ms, double baselineMs,
+                                 const juce::String& baselineName)
+            {
+                print ("  " + wtgen::getPhaseModeName (mode).paddedRight (' ', 8)
+                       + label.paddedRight (' ', 10)
+                       + juce::String (ms, 3) + " ms/table  "
+                       + juce::String (ms * 1000.0 / juce::jmax (1, header.frames), 1) + " us/frame  "
+                       + juce::String (minimumMs / juce::jmax (ms, 1.0e-9), 2) + "x vs minimum  "
+                       + juce::String (baselineMs / juce::jmax (ms, 1.0e-9), 2) + "x vs " + baselineName);
+            };
+
+            for (auto mode : modes)
+            {
+                src->phaseMode = mode;
+
+                // Fase mínima por lotes: con su propio FFT (no usa fft::Engine), así que se
+                // mide una vez y es la referencia "vs minimum". Las filas por backend se
+                // miden sin lotes, frame a frame.
+                if (mode == PhaseMode::minimum && header.frames > 1)
+                {
+                    if (! timeBuild (fft::getDefaultBackend(), true, minimumMs))
+                    {
+                        print ("  " + wtgen::getPhaseModeName (mode) + ": " + err);
+                        return 1;
+                    }
+                    printRow (mode, "batched", minimumMs, minimumMs, "batched");
+                    print ("  " + juce::String().paddedRight (' ', 8) + "(batched minimum phase is backend-independent;"
+                           " rows below are per frame through fft::Engine)");
+                }
+
+                double baselineMs = 0.0;
+
+                for (auto backend : backends)
+                {
+                    double best = 0.0;
+                    if (! timeBuild (backend, false, best))
+                    {
+                        print ("  " + wtgen::getPhaseModeName (mode) + ": " + err);
+                        return 1;
+                    }
+
+                    if (mode == PhaseMode::minimum && backend == backends.getFirst() && minimumMs <= 0.0)
+                        minimumMs = best;
+                    if (backend == backends.getFirst())
+                        baselineMs = best;
+
+                    printRow (mode, fft::getBackendName (backend), best, baselineMs,
+                              fft::getBackendName (backends.getFirst()));
+                }
+            }
+        }
+
+        return 0;
+    }
+
+    static void printUsage()
+    {
+        print ("usage: BasicInstrumentBench instances [--instances N] [--threads M] [--seconds S]");
+        print ("                                      [--rate SR] [--block B] [--density NPS]");
+        print ("                                      [--distinct] [--playback] [--sync] [--pm] [--drive] [--vector] file1.wtgen.json [file2 ...]");
+        print ("       BasicInstrumentBench decode [--repeat R] file1.wtgen.json [file2 ...]");
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add (juce::CharPointer_UTF8 (argv[i]));
+
+    if (args.isEmpty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    const auto mode = args[0];
+    args.remove (0);
+
+    if (mode == "instances")
+        return runInstances (args);
+
+    if (mode == "decode")
+        return runDecode (args);
+
+    printUsage();
+    return 1;
+}
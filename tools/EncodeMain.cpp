@@ -0,0 +1,348 @@
+/*
+  ==============================================================================
+
+    EncodeMain.cpp
+    - Audio (WAV/AIFF/FLAC) -> .wtgen.json (harm-noise-framepack-v1)
+    - .wtgen.json / .wtgen.bin -> same content in another codec or container
+    - --verify: decodes the result and reports the harmonic magnitude error
+                (conversions: checks the decoded table is bit-identical)
+
+    Uso:
+      WtgenEncode [--table N] [--cycle L] [--frames F] [--harmonics H]
+                  [--bands B] [--lo-bin K] [--hi-bin K] [--phase minimum|zero|fixed]
+                  [--v1|--v2] [--no-delta] [--no-varint] [--binary]
+                  [--pcm int16|float] [--pcm-only] [--threads T] [--verify] input output
+
+    --cycle L: muestras por ciclo (0 = todo el fichero es un ciclo).
+    Multicanal: se usa la media de los canales.
+    --v2: harm-noise-framepack-v2 (delta + varint salvo --no-delta / --no-varint).
+    --binary (o salida *.wtgen.bin): contenedor WTGENBIN, sin base64.
+    --pcm int16|float: añade un nodo timeFrames con la tabla final (carga sin FFT);
+                       --pcm-only descarta los datos espectrales.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "WtgenDecoder.h"
+#include "WtgenEncoder.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    static void print (const juce::String& s)
+    {
+        std::cout << s.toStdString() << std::endl;
+    }
+
+    static double msSince (Clock::time_point t0)
+    {
+        return std::chrono::duration<double, std::milli> (Clock::now() - t0).count();
+    }
+
+    static bool readMonoAudio (const juce::File& file, juce::AudioBuffer<float>& mono, juce::String& err)
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (file));
+        if (reader == nullptr)
+        {
+            err = "Cannot read audio file " + file.getFullPathName();
+            return false;
+        }
+
+        const auto length = (int) juce::jmin<juce::int64> (reader->lengthInSamples, 1 << 26);
+        const int channels = juce::jmax (1, (int) reader->numChannels);
+
+        juce::AudioBuffer<float> buffer (channels, length);
+        reader->read (&buffer, 0, length, 0, true, true);
+
+        mono.setSize (1, length);
+        mono.clear();
+        for (int ch = 0; ch < channels; ++ch)
+            mono.addFrom (0, 0, buffer, ch, 0, length, 1.0f / (float) channels);
+
+        return true;
+    }
+
+    // Error máximo (dB) de los armónicos audibles tras alinear la ganancia global
+    // (el decoder normaliza el pico de la tabla)
+    static double measureHarmonicErrorDb (const std::vector<float>& ref, const std::vector<float>& dec,
+                                          int frames, int nBins, int harmonics)
+    {
+        double num = 0.0, den = 0.0, peak = 0.0;
+        for (int f = 0; f < frames; ++f)
+            for (int h = 1; h <= harmonics; ++h)
+            {
+                const auto i = (size_t) f * (size_t) nBins + (size_t) h;
+                num += (double) ref[i] * (double) dec[i];
+                den += (double) dec[i] * (double) dec[i];
+                peak = juce::jmax (peak, (double) ref[i]);
+            }
+
+        const double gain = den > 0.0 ? num / den : 1.0;
+        const double floor = peak * 1.0e-2; // -40 dB bajo el armónico más fuerte (paso u16 = 1/4096)
+
+        double worst = 0.0;
+        for (int f = 0; f < frames; ++f)
+            for (int h = 1; h <= harmonics; ++h)
+            {
+                const auto i = (size_t) f * (size_t) nBins + (size_t) h;
+                if (ref[i] < floor)
+                    continue;
+
+                const double e = 20.0 * std::log10 (juce::jmax (1.0e-12, gain * (double) dec[i]) / (double) ref[i]);
+                worst = juce::jmax (worst, std::abs (e));
+            }
+        return worst;
+    }
+
+    static void printUsage()
+    {
+        print ("usage: WtgenEncode [--table N] [--cycle L] [--frames F] [--harmonics H]");
+        print ("                   [--bands B] [--lo-bin K] [--hi-bin K] [--phase minimum|zero|fixed]");
+        print ("                   [--v1|--v2] [--no-delta] [--no-varint] [--binary]");
+        print ("                   [--pcm int16|float] [--pcm-only]");
+        print ("                   [--threads T] [--verify] input.wav|input.wtgen.json|input.wtgen.bin output");
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add (juce::CharPointer_UTF8 (argv[i]));
+
+    int tableSize = 2048, cycle = 0, maxFrames = 256;
+    bool verify = false, binary = false, pcmOnly = false;
+    int pcmFormat = -1; // -1: sin nodo timeFrames
+    wtgen::EncodeSettings settings;
+    juce::StringArray files;
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        const auto& a = args[i];
+        const bool hasValue = i + 1 < args.size();
+
+        if      (a == "--table" && hasValue)     tableSize = args[++i].getIntValue();
+        else if (a == "--cycle" && hasValue)     cycle = args[++i].getIntValue();
+        else if (a == "--frames" && hasValue)    maxFrames = args[++i].getIntValue();
+        else if (a == "--harmonics" && hasValue) settings.harmonics = args[++i].getIntValue();
+        else if (a == "--bands" && hasValue)     settings.bands = args[++i].getIntValue();
+        else if (a == "--lo-bin" && hasValue)    settings.loBin = args[++i].getIntValue();
+        else if (a == "--hi-bin" && hasValue)    settings.hiBin = args[++i].getIntValue();
+        else if (a == "--threads" && hasValue)   settings.numThreads = args[++i].getIntValue();
+        else if (a == "--verify")                verify = true;
+        else if (a == "--v2")                    settings.codecVersion = 2;
+        else if (a == "--v1")                    settings.codecVersion = 1;
+        else if (a == "--no-delta")              settings.v2Flags &= ~wtgen::framepackDelta;
+        else if (a == "--no-varint")             settings.v2Flags &= ~wtgen::framepackVarint;
+        else if (a == "--binary")                binary = true;
+        else if (a == "--pcm-only")              pcmOnly = true;
+        else if (a == "--pcm" && hasValue)
+        {
+            const auto fmt = args[++i];
+            if      (fmt == "int16") pcmFormat = (int) wtgen::PcmFormat::int16;
+            else if (fmt == "float") pcmFormat = (int) wtgen::PcmFormat::float32;
+            else
+            {
+                print ("error: unknown pcm format " + fmt);
+                return 1;
+            }
+        }
+        else if (a == "--phase" && hasValue)
+        {
+            if (! wtgen::parsePhaseModeName (args[++i], settings.phaseMode))
+            {
+                print ("error: unknown phase mode " + args[i]);
+                return 1;
+            }
+        }
+        else
+            files.add (a);
+    }
+
+    if (files.size() != 2)
+    {
+        printUsage();
+        return 1;
+    }
+
+    const auto cwd = juce::File::getCurrentWorkingDirectory();
+    const auto input = cwd.getChildFile (files[0]);
+    const auto output = cwd.getChildFile (files[1]);
+
+    if (output.getFileName().endsWithIgnoreCase (".wtgen.bin"))
+        binary = true;
+
+    juce::String err;
+    juce::AudioBuffer<float> frames;
+    wtgen::WtSource::Ptr original, src;
+
+    const auto t0 = Clock::now();
+
+    if (input.hasFileExtension ("json;bin"))
+    {
+        // Conversión de un .wtgen.json / .wtgen.bin existente (v1 <-> v2, JSON <-> binario)
+        juce::MemoryBlock contents;
+        const wtgen::DecodeLimits limits;
+        const auto name = input.getFileNameWithoutExtension();
+
+        const bool parsed = input.loadFileAsData (contents)
+            && (wtgen::isWtgenBinary (contents.getData(), contents.getSize())
+                   ? wtgen::parseWtgenBinary (contents.getData(), contents.getSize(), name, limits, original, err)
+                   : wtgen::parseWtgenJson (contents.toString(), name, limits, original, err));
+
+        if (! parsed || ! wtgen::transcodeSource (*original, settings.codecVersion, settings.v2Flags, src, err))
+        {
+            print ("error: " + (err.isNotEmpty() ? err : "cannot read " + input.getFullPathName()));
+            return 1;
+        }
+    }
+    else
+    {
+        juce::AudioBuffer<float> audio;
+
+        if (! readMonoAudio (input, audio, err)
+             || ! wtgen::sliceCycles (audio.getReadPointer (0), audio.getNumSamples(),
+                                      cycle, tableSize, maxFrames, frames, err)
+             || ! wtgen::encodeFrames (frames, settings, input.getFileNameWithoutExtension(), src, err))
+        {
+            print ("error: " + err);
+            return 1;
+        }
+    }
+
+    // Frames precalculados (nodo timeFrames): la carga no reconstruye nada
+    if (pcmOnly && pcmFormat < 0)
+        pcmFormat = (int) wtgen::PcmFormat::int16;
+
+    if (pcmFormat >= 0)
+    {
+        if (! wtgen::attachTimeFrames (*src, (wtgen::PcmFormat) pcmFormat, settings.v2Flags, err))
+        {
+            print ("error: " + err);
+            return 1;
+        }
+
+        if (pcmOnly)
+        {
+            src->codec.clear();
+            src->data.reset();
+            wtgen::updateSourceHash (*src);
+        }
+    }
+
+    const double encodeMs = msSince (t0);
+
+    bool written = false;
+    if (binary)
+    {
+        output.deleteFile();
+        juce::FileOutputStream out (output);
+        written = out.openedOk() && wtgen::writeWtgenBinary (*src, out);
+    }
+    else
+    {
+        written = output.replaceWithText (src->toJson());
+    }
+
+    if (! written)
+    {
+        print ("error: cannot write " + output.getFullPathName());
+        return 1;
+    }
+
+    wtgen::FramepackHeader header;
+    if (src->data.getSize() > 0)
+        wtgen::parseFramepackHeader ((const juce::uint8*) src->data.getData(), src->data.getSize(),
+                                     {}, header, err);
+
+    print (output.getFileName() + "  " + src->codec + "  N=" + juce::String (header.tableSize)
+           + " F=" + juce::String (header.frames)
+           + " H=" + juce::String (header.harmonics) + " B=" + juce::String (header.bands)
+           + "  bins " + juce::String (src->loBin) + ".." + juce::String (src->hiBin)
+           + "  data " + juce::String ((juce::int64) src->data.getSize()) + " bytes"
+           + (src->frames.getSize() > 0 ? ", " + src->framesCodec + " "
+                                            + juce::String ((juce::int64) src->frames.getSize()) + " bytes"
+                                        : juce::String())
+           + ", file " + juce::String (output.getSize()) + " bytes  "
+           + juce::String (encodeMs, 2) + " ms");
+
+    if (! verify)
+        return 0;
+
+    wtgen::Wavetable::Ptr wt;
+    if (! wtgen::buildWavetableFromSource (*src, {}, wt, err))
+    {
+        print ("verify: " + err);
+        return 2;
+    }
+
+    // Conversión: sin pérdidas, la tabla decodificada debe ser idéntica
+    // (frames int16: error de cuantización por debajo de 1e-4)
+    if (original != nullptr)
+    {
+        wtgen::Wavetable::Ptr ref;
+        if (! wtgen::buildWavetableFromSource (*original, {}, ref, err))
+        {
+            print ("verify: " + err);
+            return 2;
+        }
+
+        if (ref->contentHash == wt->contentHash)
+        {
+            print ("verify: decoded tables identical");
+            return 0;
+        }
+
+        float worst = ref->frames == wt->frames && ref->tableSize == wt->tableSize ? 0.0f : 1.0f;
+        for (int f = 0; f < juce::jmin (ref->frames, wt->frames) && worst < 1.0f; ++f)
+            for (int i = 0; i < wt->tableSize; ++i)
+                worst = juce::jmax (worst, std::abs (ref->table.getSample (f, i) - wt->table.getSample (f, i)));
+
+        const bool ok = pcmFormat == (int) wtgen::PcmFormat::int16 && worst < 1.0e-4f;
+        print ("verify: max sample difference " + juce::String (worst, 6) + (ok ? "" : "  DIFFER"));
+        return ok ? 0 : 2;
+    }
+
+    // Round trip: decode + re-análisis; la fase cambia, las magnitudes no deberían
+    std::vector<float> ref, dec;
+    if (! wtgen::analyseFrames (frames, settings.numThreads, ref, err)
+         || ! wtgen::analyseFrames (wt->table, settings.numThreads, dec, err))
+    {
+        print ("verify: " + err);
+        return 2;
+    }
+
+    // Dimensiones de los frames cortados (con --pcm-only no hay framepack ni header);
+    // armónicos: los del header, o los de settings (0 = todos) si solo quedan frames
+    const int numFrames = frames.getNumChannels();
+    const int nBins = frames.getNumSamples() / 2 + 1;
+    const int harmonics = header.harmonics > 0 ? header.harmonics
+                        : settings.harmonics > 0 ? juce::jmin (settings.harmonics, nBins - 2)
+                                                 : nBins - 2;
+
+    if (numFrames <= 0 || harmonics <= 0 || dec.size() != ref.size())
+    {
+        print ("verify: decoded table does not match the encoded frames ("
+               + juce::String (wt->frames) + "x" + juce::String (wt->tableSize) + " vs "
+               + juce::String (numFrames) + "x" + juce::String (frames.getNumSamples()) + ")");
+        return 2;
+    }
+
+    const double worstDb = measureHarmonicErrorDb (ref, dec, numFrames, nBins, harmonics);
+    print ("verify: max harmonic error " + juce::String (worstDb, 3) + " dB");
+    return worstDb < 1.0 ? 0 : 2;
+}
@@ -0,0 +1,192 @@
+/*
+  ==============================================================================
+
+    FramepackFuzzer.cpp
+    - libFuzzer target over the wtgen-1 JSON / binary front ends + HNFPv1/v2 decoder
+    - Flags crashes AND inputs whose decode time / memory exceed thresholds
+
+    Entrada:
+      WTGENBIN...  -> contenedor binario (parseWtgenBinary + buildWavetableFromSource)
+      '{'    ...  -> texto .wtgen.json (parseWtgenJson + buildWavetableFromSource)
+      PCMFv1\0 ... -> payload pcm-frames-v1 crudo (sin datos espectrales)
+      'B' lo hi ...-> framepack crudo con banding (2 * u16 LE) delante
+      otro         -> framepack crudo, banding por defecto
+
+    JSON y binario pasan además por loadWtgenPipelined: si ambos caminos aceptan
+    el input, la tabla debe ser idéntica (mismo contentHash).
+
+    Umbrales (env):
+      WTGEN_FUZZ_MAX_MS       (default 500)  tiempo máximo por input
+      WTGEN_FUZZ_MAX_MB       (default 64)   memoria retenida máxima por input
+      WTGEN_FUZZ_WORK_PER_MS  (default 2e4)  unidades de maxFftWork por ms que se
+                                             asumen (build con sanitizers)
+
+    DecodeLimits::maxFftWork se escala a MAX_MS * WORK_PER_MS: lo que el decoder
+    acepta a propósito cabe en el umbral de tiempo, y un input lento es una
+    regresión (el límite no se aplica o el coste real no sigue la estimación).
+
+    Uso:
+      FramepackFuzzer tools/fuzz/corpus -max_total_time=60
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "WtgenDecoder.h"
+#include "WtgenLoader.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    struct Thresholds
+    {
+        double maxMs     = 500.0;
+        size_t maxBytes  = (size_t) 64 * 1024 * 1024;
+        double workPerMs = 2.0e4;
+    };
+
+    static Thresholds readThresholds()
+    {
+        Thresholds t;
+
+        if (const char* ms = std::getenv ("WTGEN_FUZZ_MAX_MS"))
+            t.maxMs = juce::jmax (1.0, std::atof (ms));
+
+        if (const char* mb = std::getenv ("WTGEN_FUZZ_MAX_MB"))
+            t.maxBytes = (size_t) juce::jmax (1.0, std::atof (mb)) * 1024 * 1024;
+
+        if (const char* w = std::getenv ("WTGEN_FUZZ_WORK_PER_MS"))
+            t.workPerMs = juce::jmax (1.0, std::atof (w));
+
+        return t;
+    }
+
+    [[noreturn]] static void reportAndAbort (const char* what, double value, double limit)
+    {
+        std::fprintf (stderr, "==wtgen-fuzz== %s: %.3f > %.3f\n", what, value, limit);
+        std::abort();
+    }
+
+    // Mismo input por el loader en pipeline (lectura por bloques + reconstrucción solapada)
+    static void checkPipelined (const uint8_t* data, size_t size, const wtgen::DecodeLimits& limits,
+                                const wtgen::Wavetable::Ptr& reference)
+    {
+        static juce::SharedResourcePointer<tasks::Scheduler> scheduler;
+
+        juce::MemoryInputStream in (data, size, false);
+        wtgen::WtSource::Ptr src;
+        wtgen::Wavetable::Ptr wt;
+        juce::String err;
+
+        const bool ok = wtgen::loadWtgenPipelined (in, "fuzz", limits, *scheduler, tasks::Priority::interactive,
+                                                   std::nullopt, src, wt, err);
+
+        if (ok && reference != nullptr && wt->contentHash != reference->contentHash)
+            reportAndAbort ("pipelined loader: table differs", 0.0, 0.0);
+
+        if (! ok && reference != nullptr)
+            reportAndAbort ("pipelined loader: rejected accepted input", 0.0, 0.0);
+    }
+
+    static juce::uint16 readU16 (const uint8_t* p)
+    {
+        return (juce::uint16) (p[0] | (p[1] << 8));
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput (const uint8_t* data, size_t size)
+{
+    static const Thresholds th = readThresholds();
+
+    // El harness mide el tiempo; el presupuesto del decoder no debe enmascarar inputs
+    // lentos. La estimación de trabajo sí se escala al umbral, para no marcar como
+    // lentos inputs que el decoder acepta a propósito
+    wtgen::DecodeLimits limits;
+    limits.maxDecodeSeconds = 0.0;
+    limits.maxFftWork = juce::jmin (limits.maxFftWork, th.maxMs * th.workPerMs);
+
+    const auto t0 = std::chrono::steady_clock::now();
+
+    wtgen::WtSource::Ptr src;
+    juce::String err;
+    bool container = false;
+
+    if (wtgen::isWtgenBinary (data, size))
+    {
+        container = true;
+        if (! wtgen::parseWtgenBinary (data, size, "fuzz", limits, src, err))
+            src = nullptr;
+    }
+    else if (size > 0 && data[0] == '{')
+    {
+        if (! juce::CharPointer_UTF8::isValidString ((const char*) data, (int) size))
+            return 0;
+
+        container = true;
+        const auto text = juce::String::fromUTF8 ((const char*) data, (int) size);
+        if (! wtgen::parseWtgenJson (text, "fuzz", limits, src, err))
+            src = nullptr;
+    }
+    else if (size >= 7 && std::memcmp (data, "PCMFv1\0", 7) == 0)
+    {
+        src = new wtgen::WtSource();
+        src->framesCodec = wtgen::codecPcmFramesV1;
+        src->frames.append (data, size);
+    }
+    else
+    {
+        src = new wtgen::WtSource();
+        src->codec = wtgen::codecFramepackV1; // el decoder sigue al magic (v1/v2)
+
+        if (size >= 5 && data[0] == 'B')
+        {
+            src->loBin = (int) readU16 (data + 1);
+            src->hiBin = (int) readU16 (data + 3);
+            data += 5;
+            size -= 5;
+        }
+
+        src->data.append (data, size);
+    }
+
+    wtgen::Wavetable::Ptr wt;
+    if (src != nullptr)
+        wtgen::buildWavetableFromSource (*src, limits, wt, err);
+
+    const double ms = std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now() - t0).count();
+    if (ms > th.maxMs)
+        reportAndAbort ("slow decode (ms)", ms, th.maxMs);
+
+    const size_t bytes = (src != nullptr ? src->getMemoryBytes() : 0)
+                       + (wt  != nullptr ? wt->getMemoryBytes()  : 0);
+    if (bytes > th.maxBytes)
+        reportAndAbort ("retained memory (bytes)", (double) bytes, (double) th.maxBytes);
+
+    // Una tabla aceptada debe ser coherente con su header
+    if (wt != nullptr)
+    {
+        if (wt->tableSize <= 0 || wt->frames <= 0
+             || wt->table.getNumChannels() != wt->frames
+             || wt->table.getNumSamples() != wt->tableSize)
+            reportAndAbort ("inconsistent wavetable", 0.0, 0.0);
+
+        for (int f = 0; f < wt->frames; ++f)
+        {
+            const auto* p = wt->table.getReadPointer (f);
+            for (int i = 0; i < wt->tableSize; ++i)
+                if (! std::isfinite (p[i]))
+                    reportAndAbort ("non-finite sample at frame", (double) f, 0.0);
+        }
+    }
+
+    // Después de los umbrales: el pipeline no cuenta para el tiempo del decoder
+    if (container)
+        checkPipelined (data, size, limits, wt);
+
+    return 0;
+}